@@ -1,676 +1,1046 @@
-#include <unistd.h>
-#include <time.h>
-#include <stdio.h>
-#include <string.h>
-#include <errno.h>
-#include <stdbool.h>
-#include <stdlib.h>
-#include <sys/resource.h>
-#include <sys/wait.h>
-#include <signal.h>
-
-#include "stringUtils.h"
-#include "printUsers.h"
-#include "printSystem.h"
-#include "parseArguments.h"
-#include "parseCpuStats.h"
-#include "parseMemoryStats.h"
-
-/**
- * Used for development purposes. If set to true, output additional text.
-*/
-#define IN_DEBUG_MODE false
-
-/**
- * Signal to indicate that user wants to terminate the program.
-*/
-#define CALLED_TERMINATE SIGUSR1
-
-/**
- * Signal to indicate that user wants to continue the program.
-*/
-#define CALLED_CONTINUE SIGUSR2
-
-/**
- * Index of file descriptors used for communication with memory utilization process.
-*/
-#define MEM_FDS 0
-
-/**
- * Index of file descriptors used for communication with user process.
-*/
-#define USER_FDS 1
-
-/**
- * Index of file descriptors used for communication with CPU utilization process.
-*/
-#define CPU_FDS 2
-
-/**
- * Begin process of terminating children and parent processes.
- * @param writeToChildFds File descriptors of pipes used to communicate to children
- * @param readFromChildFds File descriptors of pipes used to communicate from children
- * @param incomingDataPipe Additional file descriptors of pipes used to communicate from children
-*/
-void terminateChildProcesses(int writeToChildFds[3][2], int readFromChildFds[3][2], int incomingDataPipe[2])
-{
-    // TODO: Clean up and free memory if termination
-
-    // tell children to exit
-    int temp = -1;
-    for (int i = 0; i < 3; i++)
-    {
-        write(writeToChildFds[i][FD_WRITE], &temp, sizeof(int));
-    }
-
-    // wait on children to exit
-    for (int i = 0; i < 3; i++)
-    {
-        int status;
-        pid_t w = wait(&status);
-        if (IN_DEBUG_MODE) {
-            // write(STDOUT_FILENO, chldMsg, sizeof(char) * (strnlen(chldMsg, 256) + 1));
-            if (WIFEXITED(status))
-                printf("Child %d terminated with status %d\n", w, WEXITSTATUS(status));
-            else if (WIFSIGNALED(status))
-                printf("Child %d terminated with signal %d\n", w, WTERMSIG(status));
-        }
-    }
-
-    // close all fds
-    for (int i = 0; i < 3; i++)
-    {
-        close(writeToChildFds[i][FD_READ]);
-        close(writeToChildFds[i][FD_WRITE]);
-        close(readFromChildFds[i][FD_READ]);
-        close(readFromChildFds[i][FD_WRITE]);
-    }
-    close(incomingDataPipe[FD_WRITE]);
-    close(incomingDataPipe[FD_READ]);
-}
-
-/**
- * Configure signal mask on child processes made from forking.
-*/
-void configureChildSignals()
-{
-    sigset_t blocker;
-    sigemptyset(&blocker);
-    // Make child ignore the following signals
-    sigaddset(&blocker, SIGINT);
-    sigaddset(&blocker, SIGTSTP);
-    sigaddset(&blocker, CALLED_TERMINATE);
-    sigaddset(&blocker, CALLED_CONTINUE);
-    sigprocmask(SIG_BLOCK, &blocker, NULL);
-}
-
-/**
- * Signal handler for Ctrl-C signal (SIGINT) on the parent process.
- */
-void askQuitMainProcess(int signum, siginfo_t *info, void *context)
-{
-    char *msg = "\nAre you sure you want to exit the program? (y/n)\n";
-    write(STDOUT_FILENO, msg, sizeof(char) * (strnlen(msg, 256) + 1));
-    char response;
-    while (read(STDIN_FILENO, &response, sizeof(char)))
-    {
-        if (response == 'y' || response == 'Y')
-        {
-            // terminate the program
-            char *terminationStartMsg = "Terminating processes ...\n";
-            write(STDOUT_FILENO, terminationStartMsg, sizeof(char) * (strnlen(terminationStartMsg, 256) + 1));
-            kill(getpid(), CALLED_TERMINATE); // send user signal to terminate execution
-            break;
-        }
-        else if (response == 'n' || response == 'N')
-        {
-            // continue the program
-            char *continueMsg = "Continuing process ...\n";
-            write(STDOUT_FILENO, continueMsg, sizeof(char) * (strnlen(continueMsg, 256) + 1));
-            kill(getpid(), CALLED_CONTINUE); // send user signal to continue execution
-            break;
-        }
-        else
-        {
-            // unknown input from user
-            char *promptAgain = "Response not recognized. Please try again.\n\n";
-            write(STDOUT_FILENO, promptAgain, sizeof(char) * (strnlen(promptAgain, 256) + 1));
-            write(STDOUT_FILENO, msg, sizeof(char) * (strnlen(msg, 256) + 1));
-        }
-    }
-}
-
-/**
- * Sleep for the time delay between samples
- * @param sampleDelay The number of seconds to wait for
- * @param writeToChildFds File descriptors of pipes used to communicate to children
- * @param readFromChildFds File descriptors of pipes used to communicate from children
- * @param incomingDataPipe Additional file descriptors of pipes used to communicate from children
- * @return Returns CALLED_CONTINUE if execution is to continue as usual, and will not return otherwise.
-*/
-int sleepForSampleDelay(int sampleDelay, int writeToChildFds[3][2], int readFromChildFds[3][2], int incomingDataPipe[2])
-{
-    struct timespec req, rem;
-    req.tv_sec = sampleDelay;
-    req.tv_nsec = 0;
-    rem.tv_nsec = 0;
-    rem.tv_sec = 0;
-    while (req.tv_nsec > 0 || req.tv_sec > 0) {
-        if (nanosleep(&req, &rem) == -1)
-        {
-            // handle when sleep interrupted by signal or error
-            if (IN_DEBUG_MODE) {
-                perror("nanosleep");
-            }
-            // check if CALLED_TERMINATE or CALLED_CONTINUE signals pending
-            sigset_t blocked;
-            sigpending(&blocked);
-            if (sigismember(&blocked, CALLED_TERMINATE))
-            {
-                if (IN_DEBUG_MODE)
-                    printf("Detected interrupt CALLED_TERMINATE\n");
-                terminateChildProcesses(writeToChildFds, readFromChildFds, incomingDataPipe);
-                exit(EXIT_SUCCESS);
-            }
-            else if (sigismember(&blocked, CALLED_CONTINUE))
-            {
-                if (IN_DEBUG_MODE)
-                    printf("Detected interrupt CALLED_CONTINUE %ld, %ld\n", rem.tv_nsec, rem.tv_sec);
-                req.tv_nsec = rem.tv_nsec;
-                req.tv_sec = rem.tv_sec;
-            } 
-            else {
-                printf("Unknown input given. Terminating program.\n");
-                return CALLED_CONTINUE;
-            }
-        } 
-        else {
-            req.tv_nsec = 0;
-            req.tv_sec = 0;
-        }
-        // printf("Waiting another %lds, %ldns\n", req.tv_sec, req.tv_nsec);
-    }
-    return CALLED_CONTINUE;
-}
-
-int main(int argc, char **argv)
-{
-    struct sigaction ignoreSig;
-    ignoreSig.sa_flags = 0;
-    ignoreSig.sa_handler = SIG_IGN;
-    sigemptyset(&ignoreSig.sa_mask);
-    if (sigaction(SIGTSTP, &ignoreSig, NULL) == -1)
-    {
-        perror("Sigaction: SIGTSTP");
-        exit(EXIT_FAILURE);
-    }
-
-    struct sigaction sig;
-    sig.sa_flags = SA_SIGINFO;
-    sig.sa_sigaction = &askQuitMainProcess;
-    sigemptyset(&sig.sa_mask);
-    if (sigaction(SIGINT, &sig, NULL) == -1)
-    {
-        perror("Sigaction: SIGINT");
-        exit(EXIT_FAILURE);
-    }
-
-    sigset_t alwaysIgnored;
-    sigemptyset(&alwaysIgnored);
-    sigaddset(&alwaysIgnored, SIGTSTP);
-    sigaddset(&alwaysIgnored, CALLED_TERMINATE);
-    sigaddset(&alwaysIgnored, CALLED_CONTINUE);
-    sigprocmask(SIG_BLOCK, &alwaysIgnored, NULL);
-
-    sigset_t criticalCodeBlocker;
-    sigemptyset(&criticalCodeBlocker);
-    sigaddset(&criticalCodeBlocker, SIGINT);
-
-    sigprocmask(SIG_BLOCK, &criticalCodeBlocker, NULL);
-
-    /**
-     * Show only the system usage? (--system)
-     */
-    bool showSystem = false;
-    /**
-     * Show only the user's usage? (--user)
-     */
-    bool showUser = false;
-    /**
-     * Show graphical output for memory and CPU utilization? (--graphics)
-     */
-    bool showGraphics = false;
-    /**
-     * Output information sequentially without refreshing screen? (--sequential)
-     */
-    bool showSequential = false;
-    /**
-     * The number of times that the usage statistics will be sampled. (--samples). Default = 10;
-     */
-    long numSamples = 10;
-    /**
-     *  The time between consecutive samples of the usage statistics, in seconds (--tdelay). Default = 1
-     */
-    long sampleDelay = 1;
-
-    /**
-     * Fds of pipes used to read data from children.
-     */
-    int readFromChildFds[3][2];
-
-    /**
-     * Pipe for notifying parent of incoming data.
-     */
-    int incomingDataPipe[2];
-
-    /**
-     * Fds of pipes used to write data to children
-     */
-    int writeToChildFds[3][2];
-
-    // parse command line arguments
-    if (parseArguments(argc, argv, &showSystem, &showUser, &showGraphics, &showSequential, &numSamples, &sampleDelay) != 0)
-    {
-        return 1;
-    }
-    printf("\033[2J\033[3J");
-
-    printf("\033[2J\033[H\n");
-
-    // printf("Parsed arguments: --system %d --user %d --graphics %d --sequential %d numSamples %ld samplesDelay %ld\n",
-    //        showSystem, showUser, showGraphics, showSequential, numSamples, sampleDelay);
-
-    // store previously calculated output
-    char *memoryOutput[numSamples + 1];
-    char *cpuOutput[numSamples + 1];
-    for (int i = 0; i <= numSamples; i++)
-    {
-        memoryOutput[i] = NULL;
-        cpuOutput[i] = NULL;
-    }
-    char *userInfo[MAX_USERS];
-    int numUsers = 0;
-    for (int i = 0; i < MAX_USERS; i++)
-    {
-        userInfo[i] = NULL;
-    }
-
-    int processorCount;
-    int coreCount;
-    char *averageCpuUsage = NULL;
-
-    pipe(incomingDataPipe);
-
-    // create child processes
-    if (showSystem || !showUser)
-    {                                    // Show memory utilization
-        pipe(writeToChildFds[MEM_FDS]);  // create pipe for parent -> child
-        pipe(readFromChildFds[MEM_FDS]); // pipe for child -> parent
-        pid_t memoryPid = fork();        // memory usage process
-        if (memoryPid == 0)
-        { // child process
-            configureChildSignals();
-            close(writeToChildFds[MEM_FDS][FD_WRITE]);
-            close(readFromChildFds[MEM_FDS][FD_READ]); // prevent child from reading data meant for parent
-            close(incomingDataPipe[FD_READ]);
-            displayMemory(numSamples, showGraphics, writeToChildFds[MEM_FDS], readFromChildFds[MEM_FDS], incomingDataPipe);
-            exit(0);
-        }
-        else if (memoryPid == -1) 
-        {
-            perror('fork (memory)');
-            terminateChildProcesses(writeToChildFds, readFromChildFds, incomingDataPipe);
-            exit(EXIT_FAILURE);
-        }
-        else
-        {
-            close(writeToChildFds[MEM_FDS][FD_READ]);
-            close(readFromChildFds[MEM_FDS][FD_WRITE]);
-        }
-
-        pipe(writeToChildFds[CPU_FDS]);  // create pipe for parent -> child
-        pipe(readFromChildFds[CPU_FDS]); // pipe for child -> parent
-        pid_t cpuPid = fork();
-        if (cpuPid == 0)
-        {
-            configureChildSignals();
-            close(writeToChildFds[CPU_FDS][FD_WRITE]);
-            close(readFromChildFds[CPU_FDS][FD_READ]);
-            close(incomingDataPipe[FD_READ]);
-            displayCpu(numSamples, showGraphics, writeToChildFds[CPU_FDS], readFromChildFds[CPU_FDS], incomingDataPipe);
-            exit(0);
-        }
-        else if (cpuPid == -1) 
-        {
-            perror('fork (CPU)');
-            terminateChildProcesses(writeToChildFds, readFromChildFds, incomingDataPipe);
-            exit(EXIT_FAILURE);
-        }
-        else
-        {
-            close(writeToChildFds[CPU_FDS][FD_READ]);
-            close(readFromChildFds[CPU_FDS][FD_WRITE]);
-        }
-    }
-
-    if (!showSystem || showUser)
-    {
-        pipe(writeToChildFds[USER_FDS]);  // create pipe for parent -> child
-        pipe(readFromChildFds[USER_FDS]); // pipe for child -> parent
-        pid_t userPid = fork();
-        if (userPid == 0)
-        {
-            configureChildSignals();
-            close(writeToChildFds[USER_FDS][FD_WRITE]);
-            close(readFromChildFds[USER_FDS][FD_READ]);
-            close(incomingDataPipe[FD_READ]);
-            printUsers(writeToChildFds[USER_FDS], readFromChildFds[USER_FDS], incomingDataPipe);
-            exit(0);
-        }
-        else if (userPid == -1) 
-        {
-            perror('fork (user)');
-            terminateChildProcesses(writeToChildFds, readFromChildFds, incomingDataPipe);
-            exit(EXIT_FAILURE);
-        }
-        else
-        {
-            close(writeToChildFds[USER_FDS][FD_READ]);
-            close(readFromChildFds[USER_FDS][FD_WRITE]);
-        }
-    }
-
-    if (signal(SIGPIPE, SIG_IGN) == SIG_ERR)
-    {
-        perror("Signal SIGPIPE");
-        terminateChildProcesses(writeToChildFds, readFromChildFds, incomingDataPipe);
-        exit(EXIT_FAILURE);
-    }
-
-    close(incomingDataPipe[FD_WRITE]);
-
-    if (sigprocmask(SIG_UNBLOCK, &criticalCodeBlocker, NULL) == -1) {
-        perror("sigprocmask");
-        terminateChildProcesses(writeToChildFds, readFromChildFds, incomingDataPipe);
-        exit(EXIT_FAILURE);
-    }
-
-    for (int thisSample = 0; thisSample <= numSamples; thisSample++)
-    {
-        if (sigprocmask(SIG_BLOCK, &criticalCodeBlocker, NULL) == -1) {
-            perror("sigprocmask");
-            terminateChildProcesses(writeToChildFds, readFromChildFds, incomingDataPipe);
-            exit(EXIT_FAILURE);
-        }
-
-        // ensure this iteration's info is empty
-        memoryOutput[thisSample] = NULL;
-        cpuOutput[thisSample] = NULL;
-        for (int i = 0; i < numUsers; i++)
-        {
-            if (userInfo[i] != NULL)
-            {
-                free(userInfo[i]);
-                userInfo[i] = NULL;
-            }
-        }
-        numUsers = 0;
-
-        if (averageCpuUsage != NULL)
-        {
-            free(averageCpuUsage);
-            averageCpuUsage = NULL;
-        }
-
-        // PASS DATA TO PROCESSES
-
-        if (showSystem || !showUser)
-        {
-
-            // MEMORY USAGE (system information)
-            int temp = MEM_START_FLAG;
-            write(writeToChildFds[MEM_FDS][FD_WRITE], &temp, sizeof(int));
-            write(writeToChildFds[MEM_FDS][FD_WRITE], &thisSample, sizeof(int));
-
-            // CPU USAGE
-            temp = CPU_START_FLAG;
-            write(writeToChildFds[CPU_FDS][FD_WRITE], &temp, sizeof(int));
-            write(writeToChildFds[CPU_FDS][FD_WRITE], &thisSample, sizeof(int));
-        }
-
-        if (showUser || !showSystem)
-        {
-            // USERS
-            int temp = USER_START_FLAG;
-            write(writeToChildFds[USER_FDS][FD_WRITE], &temp, sizeof(int));
-            write(writeToChildFds[USER_FDS][FD_WRITE], &thisSample, sizeof(int));
-        }
-
-        if (IN_DEBUG_MODE)
-            printf("Passed data\n");
-
-        if (thisSample == 0) // skip printing on first iteration
-        { 
-            // temporarily unblock SIGINT to allow interrupt during sleep
-            sigprocmask(SIG_UNBLOCK, &criticalCodeBlocker, NULL);
-            // sleep
-            sleepForSampleDelay(sampleDelay, writeToChildFds, readFromChildFds, incomingDataPipe);
-            continue;
-        }
-
-        bool errored = false;
-        // read output from children
-        while (!errored)
-        {
-            int processFunction = 0, strLen = 0;
-            int readInp = read(incomingDataPipe[FD_READ], &processFunction, sizeof(int));
-            int stringLenRead = 0;
-            if (readInp == 0)
-                continue;
-            if (readInp == -1)
-            {
-                perror("read: incomingDataPipe");
-                terminateChildProcesses(writeToChildFds, readFromChildFds, incomingDataPipe);
-                return EXIT_FAILURE;
-            }
-            if (IN_DEBUG_MODE)
-                printf("Received info of type %d\n", processFunction);
-            switch (processFunction)
-            {
-            case MEM_DATA_ID:
-                stringLenRead = read(readFromChildFds[MEM_FDS][FD_READ], &strLen, sizeof(int));
-                if (stringLenRead <= 0) {
-                    break;
-                }
-                memoryOutput[thisSample] = (char *)malloc(sizeof(char) * (strLen + 1));
-                read(readFromChildFds[MEM_FDS][FD_READ], memoryOutput[thisSample], sizeof(char) * (strLen + 1));
-                break;
-
-            case CPU_DATA_ID:
-                read(readFromChildFds[CPU_FDS][FD_READ], &processorCount, sizeof(int));
-                read(readFromChildFds[CPU_FDS][FD_READ], &coreCount, sizeof(int));
-
-                // read average CPU usage line
-                read(readFromChildFds[CPU_FDS][FD_READ], &strLen, sizeof(int));
-                averageCpuUsage = (char *)malloc(sizeof(char) * (strLen + 1));
-                read(readFromChildFds[CPU_FDS][FD_READ], averageCpuUsage, sizeof(char) * (strLen + 1));
-
-                // read timepoint CPU utilization
-                read(readFromChildFds[CPU_FDS][FD_READ], &strLen, sizeof(int));
-                cpuOutput[thisSample] = (char *)malloc(sizeof(char) * (strLen + 1));
-                read(readFromChildFds[CPU_FDS][FD_READ], cpuOutput[thisSample], sizeof(char) * (strLen + 1));
-                break;
-
-            case USER_DATA_ID:
-                while (read(readFromChildFds[USER_FDS][FD_READ], &strLen, sizeof(int)) > 0)
-                {
-                    if (strLen == 0)
-                        break;
-                    if (numUsers < MAX_USERS)
-                    {
-                        userInfo[numUsers] = (char *)malloc(sizeof(char) * (strLen + 1));
-                        read(readFromChildFds[USER_FDS][FD_READ], userInfo[numUsers], sizeof(char) * (strLen + 1));
-                        numUsers++;
-                    }
-                    else
-                    {
-                        char *overflowBin = (char *)malloc(sizeof(char) * (strLen + 1));
-                        read(readFromChildFds[USER_FDS][FD_READ], overflowBin, sizeof(char) * (strLen + 1));
-                        free(overflowBin);
-                    }
-                }
-                break;
-
-            default:
-                errored = true;
-                break;
-            }
-
-            // check if information is complete
-            if (showSystem || !showUser)
-            {
-                if (memoryOutput[thisSample] == NULL || cpuOutput[thisSample] == NULL || userInfo == NULL)
-                {
-                    continue;
-                }
-            }
-            if (showUser || !showSystem)
-            {
-                if (userInfo == NULL)
-                {
-                    continue;
-                }
-            }
-            break;
-        }
-
-        if (IN_DEBUG_MODE)
-            printf("Read data\n");
-
-        if (!showSequential)
-        {
-            // use escape characters to make it appear that screen is refreshing
-            // \033[3J erases saved lines
-            // \033[H repositions cursor to start
-            // \033[2J erases entire screen
-            printf("\033[2J\033[3J\033[2J\033[H\n");
-        }
-
-        printf("\n||| Sample #%d |||\n", thisSample);
-        printDivider();
-        printf("Nbr of samples: %ld -- every %ld secs\n", numSamples, sampleDelay);
-
-        struct rusage rUsageData;
-        if (getrusage(RUSAGE_SELF, &rUsageData) == -1) {
-            perror("getrusage");
-            terminateChildProcesses(writeToChildFds, readFromChildFds, incomingDataPipe);
-            exit(EXIT_FAILURE); 
-        }
-        printf("Memory usage: %ld kilobytes\n", rUsageData.ru_maxrss);
-
-        printDivider();
-
-        if (showSystem || !showUser)
-        {
-            if (showGraphics)
-            {
-                printf("### Memory ### (Phys.Used/Tot -- Virtual Used/Tot, Memory Graphic)\n");
-            }
-            else
-            {
-                printf("### Memory ### (Phys.Used/Tot -- Virtual Used/Tot)\n");
-            }
-            for (int i = 1; i <= numSamples; i++)
-            {
-                if (memoryOutput[i] == NULL)
-                    printf("\n");
-                else
-                    printf("%s", memoryOutput[i]);
-            }
-            printDivider();
-        }
-
-        // USER CONNECTIONS (user information)
-        if (showUser || !showSystem)
-        {
-            printf("### Sessions/users ###\n");
-            for (int i = 0; i < numUsers; i++)
-            {
-                printf("%s", userInfo[i]);
-            }
-            printDivider();
-        }
-
-        if (showSystem || !showUser)
-        {
-            printf("Number of processors: %d\n", processorCount);
-            printf("Total number of cores: %d\n", coreCount);
-            // Print the average CPU utilization from beginning to current sample
-            printf("%s", averageCpuUsage);
-
-            printDivider();
-
-            if (showGraphics)
-            {
-                printf("CPU Utilization (%% Use, Relative Abs. Change, %% Use Graphic)\n");
-            }
-            else
-            {
-                printf("CPU Utilization (%% Use, Relative Abs. Change)\n");
-            }
-
-            for (int i = 1; i <= numSamples; i++)
-            {
-                if (cpuOutput[i] == NULL)
-                    printf("\n");
-                else
-                    printf("%s", cpuOutput[i]);
-            }
-
-            printDivider();
-        }
-
-        printf("||| End of Sample #%d |||\n", thisSample);
-
-        // temporarily unblock SIGINT to allow interrupt during sleep
-        if (sigprocmask(SIG_UNBLOCK, &criticalCodeBlocker, NULL) == -1) {
-            perror("sigprocmask");
-            terminateChildProcesses(writeToChildFds, readFromChildFds, incomingDataPipe);
-            exit(EXIT_FAILURE); 
-        }
-        if (thisSample != numSamples) {
-            sleepForSampleDelay(sampleDelay, writeToChildFds, readFromChildFds, incomingDataPipe);
-        }
-
-        printf("\n\n");
-    }
-
-    printDivider();
-    if (printSystemInfo() != 0)
-    {
-        return 1;
-    }
-    printDivider();
-
-    if (averageCpuUsage != NULL)
-    {
-        free(averageCpuUsage);
-    }
-
-    for (int thisSample = 0; thisSample < numSamples; thisSample++)
-    {
-        if (memoryOutput[thisSample] != NULL)
-            free(memoryOutput[thisSample]);
-        if (cpuOutput[thisSample] != NULL)
-            free(cpuOutput[thisSample]);
-    }
-    for (int i = 0; i < numUsers; i++)
-    {
-        if (userInfo[i] != NULL)
-            free(userInfo[i]);
-    }
-
-    terminateChildProcesses(writeToChildFds, readFromChildFds, incomingDataPipe);
-
-    return EXIT_SUCCESS;
-}
+#include <unistd.h>
+#include <time.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <sys/prctl.h>
+#include <signal.h>
+#include <poll.h>
+#include <pthread.h>
+
+#include "stringUtils.h"
+#include "printSystem.h"
+#include "sampleTimer.h"
+#include "ringBuffer.h"
+#include "arena.h"
+#include "collectorLink.h"
+#include "sessionStore.h"
+#include "parseArguments.h"
+#include "psiStats.h"
+#include "sampleRecord.h"
+#include "sampleRenderer.h"
+#include "collectorRegistry.h"
+#include "lowImpact.h"
+#include "selfStats.h"
+#include "screenModel.h"
+#include "heapCounter.h"
+#include "sampleExport.h"
+
+/**
+ * Used for development purposes. If set to true, output additional text.
+*/
+#define IN_DEBUG_MODE false
+
+/**
+ * Signal to indicate that user wants to terminate the program.
+*/
+#define CALLED_TERMINATE SIGUSR1
+
+/**
+ * Signal to indicate that user wants to continue the program.
+*/
+#define CALLED_CONTINUE SIGUSR2
+
+/**
+ * Max length of a line of memory or CPU utilization output kept in the history
+*/
+#define HISTORY_LINE_LENGTH 1024
+
+/**
+ * Share of the sample delay, in percent, the collectors have to send their records before the sample is printed without them
+*/
+#define COLLECTOR_DEADLINE_PERCENT 80
+
+/**
+ * Initial size of the arena holding the output received from children during a sample, grown if a sample needs more
+*/
+#define SAMPLE_ARENA_SIZE 65536
+
+/**
+ * What a collector thread runs, kept alive for as long as the thread
+*/
+typedef struct collectorStart
+{
+    const CollectorDefinition *definition;
+    const MonitorOptions *options;
+    CollectorLink *link;
+} CollectorStart;
+
+/**
+ * Total the CPU time and context switches of the render loop and of every collector, as of their latest records.
+ * @param collectorUsage Usage of each collector carried by its latest record
+ * @param total Where to store the total
+*/
+void totalMonitorUsage(const ThreadUsage collectorUsage[COLLECTOR_COUNT], ThreadUsage *total)
+{
+    if (getThreadUsage(total) != 0)
+    {
+        memset(total, 0, sizeof(ThreadUsage));
+    }
+    for (int i = 0; i < COLLECTOR_COUNT; i++)
+    {
+        total->cpuSeconds += collectorUsage[i].cpuSeconds;
+        total->contextSwitches += collectorUsage[i].contextSwitches;
+        total->heapAllocations += collectorUsage[i].heapAllocations;
+    }
+}
+
+/**
+ * Begin process of terminating collectors and parent processes.
+ * @param links Links to every collector, of which only the started ones are stopped
+ * @param notifier Notifier shared by every collector
+*/
+void terminateChildProcesses(CollectorLink links[COLLECTOR_COUNT], CollectorNotifier *notifier)
+{
+    // TODO: Clean up and free memory if termination
+
+    // child processes are killed rather than asked to stop, as a late one may be stalled or blocked sending a record
+    // that does not fit in its ring, and draining it could hold up the exit for as long as it takes
+    int temp = COLLECTOR_STOP_FLAG;
+    bool threadsLeft = false;
+    for (int i = 0; i < COLLECTOR_COUNT; i++)
+    {
+        if (!links[i].active)
+            continue;
+        if (!links[i].threaded)
+            kill(links[i].pid, SIGKILL);
+        else if (links[i].pendingSample == NO_PENDING_SAMPLE)
+            writeToCollector(links + i, &temp, sizeof(int));
+        else
+        {
+            // a thread cannot be killed on its own, so a late one is left to end with the process, along with the
+            // rings it may still be using
+            pthread_detach(links[i].thread);
+            links[i].active = false;
+            threadsLeft = true;
+        }
+    }
+
+    // wait on collectors to exit
+    for (int i = 0; i < COLLECTOR_COUNT; i++)
+    {
+        if (!links[i].active)
+            continue;
+        if (links[i].threaded)
+        {
+            pthread_join(links[i].thread, NULL);
+            continue;
+        }
+        int status;
+        pid_t w = waitpid(links[i].pid, &status, 0);
+        if (IN_DEBUG_MODE) {
+            // write(STDOUT_FILENO, chldMsg, sizeof(char) * (strnlen(chldMsg, 256) + 1));
+            if (WIFEXITED(status))
+                printf("Child %d terminated with status %d\n", w, WEXITSTATUS(status));
+            else if (WIFSIGNALED(status))
+                printf("Child %d terminated with signal %d\n", w, WTERMSIG(status));
+        }
+    }
+
+    // close all pipes and rings
+    if (threadsLeft)
+        return;
+    for (int i = 0; i < COLLECTOR_COUNT; i++)
+    {
+        closeCollectorLink(links + i);
+    }
+    closeCollectorNotifier(notifier);
+}
+
+/**
+ * Configure signal mask on child processes made from forking.
+*/
+void configureChildSignals()
+{
+    sigset_t blocker;
+    sigemptyset(&blocker);
+    // Make child ignore the following signals
+    sigaddset(&blocker, SIGINT);
+    sigaddset(&blocker, SIGTSTP);
+    sigaddset(&blocker, CALLED_TERMINATE);
+    sigaddset(&blocker, CALLED_CONTINUE);
+    sigprocmask(SIG_BLOCK, &blocker, NULL);
+}
+
+/**
+ * Run a collector on a thread of the parent process. A collector that fails only ends its own thread, and the render
+ * loop learns that it is gone as it would from the pidfd of a child process.
+ * @param argument The CollectorStart of the collector
+ * @returns NULL once the collector has stopped
+*/
+void *runCollectorThread(void *argument)
+{
+    CollectorStart *start = (CollectorStart *)argument;
+    if (runCollector(start->definition, start->options, start->link) != 0)
+        notifyParentOfExit(start->link);
+    return NULL;
+}
+
+/**
+ * Start a collector, either in a forked child process that exits once the collector stops, or on a new thread.
+ * Threads inherit the signal mask of the parent at this point, so signals keep being handled by the render loop.
+ * @param link Link to the collector, set up by initCollectorLink()
+ * @param start What the collector runs, which must stay alive while it runs
+ * @returns 0 if operation was successful, 1 otherwise
+*/
+int startCollector(CollectorLink *link, CollectorStart *start)
+{
+    const char *name = start->definition->name;
+    start->link = link;
+    if (link->threaded)
+    {
+        int error = pthread_create(&link->thread, NULL, runCollectorThread, start);
+        if (error != 0)
+        {
+            fprintf(stderr, "pthread_create (%s): %s\n", name, strerror(error));
+            return 1;
+        }
+        link->active = true;
+        return 0;
+    }
+
+    // a child would otherwise write out its copy of whatever output is still buffered when it exits
+    fflush(stdout);
+    pid_t parentPid = getpid();
+    pid_t pid = fork();
+    if (pid == 0)
+    { // child process
+        configureChildSignals();
+        // the collector waits on shared memory rather than a pipe, so nothing else would tell it that the parent is gone
+        if (prctl(PR_SET_PDEATHSIG, SIGKILL) == -1 || getppid() != parentPid)
+        {
+            exit(1);
+        }
+        closeParentEnds(link);
+        exit(runCollector(start->definition, start->options, link));
+    }
+    else if (pid == -1)
+    {
+        fprintf(stderr, "fork (%s): %s\n", name, strerror(errno));
+        return 1;
+    }
+    link->pid = pid;
+    link->active = true;
+    return watchCollector(link);
+}
+
+/**
+ * Signal handler for Ctrl-C signal (SIGINT) on the parent process.
+ */
+void askQuitMainProcess(int signum, siginfo_t *info, void *context)
+{
+    char *msg = "\nAre you sure you want to exit the program? (y/n)\n";
+    write(STDOUT_FILENO, msg, sizeof(char) * (strnlen(msg, 256) + 1));
+    char response;
+    while (read(STDIN_FILENO, &response, sizeof(char)))
+    {
+        if (response == 'y' || response == 'Y')
+        {
+            // terminate the program
+            char *terminationStartMsg = "Terminating processes ...\n";
+            write(STDOUT_FILENO, terminationStartMsg, sizeof(char) * (strnlen(terminationStartMsg, 256) + 1));
+            kill(getpid(), CALLED_TERMINATE); // send user signal to terminate execution
+            break;
+        }
+        else if (response == 'n' || response == 'N')
+        {
+            // continue the program
+            char *continueMsg = "Continuing process ...\n";
+            write(STDOUT_FILENO, continueMsg, sizeof(char) * (strnlen(continueMsg, 256) + 1));
+            kill(getpid(), CALLED_CONTINUE); // send user signal to continue execution
+            break;
+        }
+        else
+        {
+            // unknown input from user
+            char *promptAgain = "Response not recognized. Please try again.\n\n";
+            write(STDOUT_FILENO, promptAgain, sizeof(char) * (strnlen(promptAgain, 256) + 1));
+            write(STDOUT_FILENO, msg, sizeof(char) * (strnlen(msg, 256) + 1));
+        }
+    }
+}
+
+/**
+ * Signal handler for Ctrl-C signal (SIGINT) on the parent process when samples are written in a format read by other
+ * programs, which exits without asking so that nothing but samples is ever written to stdout.
+ */
+void quitMainProcess(int signum, siginfo_t *info, void *context)
+{
+    kill(getpid(), CALLED_TERMINATE); // send user signal to terminate execution
+}
+
+/**
+ * Check whether any collector has yet to send the record of a sample it was asked for.
+ * @param links Links to every collector
+ * @returns true if a record is outstanding, false otherwise
+*/
+bool collectorsPending(const CollectorLink links[COLLECTOR_COUNT])
+{
+    for (int i = 0; i < COLLECTOR_COUNT; i++)
+    {
+        if (links[i].active && links[i].pendingSample != NO_PENDING_SAMPLE)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * Print a notice in a section whose collector did not send the record of this sample before its deadline.
+ * The section shows whatever arrived from earlier samples instead.
+ * @param out Stream the frame is written to
+ * @param name Name of the collector
+*/
+void printStaleNotice(FILE *out, const char *name)
+{
+    fprintf(out, "(stale: no %s data arrived before the deadline of this sample)\n", name);
+}
+
+/**
+ * Print the lines of output kept for the most recent samples, oldest first.
+ * While a fixed number of samples is being taken, blank lines are printed for the samples yet to come.
+ * @param out Stream the frame is written to
+ * @param history Ring buffer of output lines, each stored in a slot of HISTORY_LINE_LENGTH bytes
+ * @param numSamples The number of samples that will be taken, or CONTINUOUS_SAMPLES
+*/
+void printHistory(FILE *out, const RingBuffer *history, long numSamples)
+{
+    for (long i = 0; i < history->count; i++)
+    {
+        fputs((char *)getRingBufferFromOldest(history, i), out);
+    }
+    long rows = history->count;
+    if (numSamples != CONTINUOUS_SAMPLES)
+        rows = numSamples < history->capacity ? numSamples : history->capacity;
+    for (long i = history->count; i < rows; i++)
+    {
+        fputc('\n', out);
+    }
+}
+
+/**
+ * Block until the next deadline of the timer passes. PSI triggers that fire in the meantime are reported as soon as
+ * they do, rather than waiting for the next sample.
+ * @param timer The timer keeping the schedule of samples
+ * @param triggers Registered PSI triggers, or NULL if there are none
+ * @param screen The screen the frames are drawn on, redrawn in full once an event was printed below the frame
+ * @returns 0 once a deadline has passed, or -1 if the wait failed or was interrupted by a signal, with errno set
+*/
+int waitForDeadlineOrPressure(SampleTimer *timer, PsiTriggers *triggers, ScreenModel *screen)
+{
+    if (triggers == NULL)
+    {
+        return waitForSampleTimer(timer);
+    }
+
+    struct pollfd pollFds[PSI_RESOURCE_COUNT + 1];
+    while (true)
+    {
+        preparePsiPoll(triggers, pollFds);
+        pollFds[PSI_RESOURCE_COUNT].fd = timer->fd;
+        pollFds[PSI_RESOURCE_COUNT].events = POLLIN;
+        pollFds[PSI_RESOURCE_COUNT].revents = 0;
+        if (poll(pollFds, PSI_RESOURCE_COUNT + 1, -1) == -1)
+        {
+            return -1;
+        }
+        // an event line may scroll the frame, which is then no longer where the screen model has it
+        if (handlePsiEvents(triggers, pollFds) > 0)
+            invalidateScreenModel(screen);
+        if (pollFds[PSI_RESOURCE_COUNT].revents & POLLIN)
+        {
+            // the deadline has passed, so this returns without blocking
+            return waitForSampleTimer(timer);
+        }
+    }
+}
+
+/**
+ * Exit if the user asked to terminate the program, which may have happened while SIGINT was blocked and so outside
+ * of the sleep it interrupts.
+ * @param links Links to every collector
+ * @param notifier Notifier shared by every collector
+ * @param selfStats Latencies of the monitor dumped before exiting, or NULL if they are not shown
+ */
+void exitIfTerminateCalled(CollectorLink links[COLLECTOR_COUNT], CollectorNotifier *notifier, const SelfStats *selfStats)
+{
+    sigset_t blocked;
+    sigpending(&blocked);
+    if (sigismember(&blocked, CALLED_TERMINATE))
+    {
+        if (IN_DEBUG_MODE)
+            printf("Detected interrupt CALLED_TERMINATE\n");
+        terminateChildProcesses(links, notifier);
+        if (selfStats != NULL)
+            dumpSelfStats(selfStats);
+        exit(EXIT_SUCCESS);
+    }
+}
+
+/**
+ * Sleep until the deadline of the next sample. Deadlines are absolute, so time spent collecting and printing
+ * the current sample is not added to the delay between samples.
+ * @param timer The timer keeping the schedule of samples
+ * @param triggers Registered PSI triggers reported while sleeping, or NULL if there are none
+ * @param links Links to every collector
+ * @param notifier Notifier shared by every collector
+ * @param selfStats Latencies of the monitor dumped if the user asks to exit, or NULL if they are not shown
+ * @param screen The screen the frames are drawn on, redrawn in full after the user was asked whether to exit or a
+ * pressure event was printed
+ * @return Returns CALLED_CONTINUE if execution is to continue as usual, and will not return otherwise.
+*/
+int sleepForSampleDelay(SampleTimer *timer, PsiTriggers *triggers, CollectorLink links[COLLECTOR_COUNT], CollectorNotifier *notifier,
+                        const SelfStats *selfStats, ScreenModel *screen)
+{
+    exitIfTerminateCalled(links, notifier, selfStats);
+    while (waitForDeadlineOrPressure(timer, triggers, screen) == -1)
+    {
+        if (errno != EINTR)
+        {
+            perror("read: timerfd");
+            terminateChildProcesses(links, notifier);
+            exit(EXIT_FAILURE);
+        }
+        // handle when sleep interrupted by signal
+        if (IN_DEBUG_MODE) {
+            perror("timerfd");
+        }
+        // check if CALLED_TERMINATE or CALLED_CONTINUE signals pending
+        exitIfTerminateCalled(links, notifier, selfStats);
+        sigset_t blocked;
+        sigpending(&blocked);
+        if (sigismember(&blocked, CALLED_CONTINUE))
+        {
+            // the deadline is unchanged, so simply wait on it again
+            invalidateScreenModel(screen);
+            if (IN_DEBUG_MODE)
+                printf("Detected interrupt CALLED_CONTINUE\n");
+        }
+        else {
+            printf("Unknown input given. Terminating program.\n");
+            return CALLED_CONTINUE;
+        }
+    }
+    return CALLED_CONTINUE;
+}
+
+int main(int argc, char **argv)
+{
+    struct sigaction ignoreSig;
+    ignoreSig.sa_flags = 0;
+    ignoreSig.sa_handler = SIG_IGN;
+    sigemptyset(&ignoreSig.sa_mask);
+    if (sigaction(SIGTSTP, &ignoreSig, NULL) == -1)
+    {
+        perror("Sigaction: SIGTSTP");
+        exit(EXIT_FAILURE);
+    }
+
+    struct sigaction sig;
+    sig.sa_flags = SA_SIGINFO;
+    sig.sa_sigaction = &askQuitMainProcess;
+    sigemptyset(&sig.sa_mask);
+    if (sigaction(SIGINT, &sig, NULL) == -1)
+    {
+        perror("Sigaction: SIGINT");
+        exit(EXIT_FAILURE);
+    }
+
+    sigset_t alwaysIgnored;
+    sigemptyset(&alwaysIgnored);
+    sigaddset(&alwaysIgnored, SIGTSTP);
+    sigaddset(&alwaysIgnored, CALLED_TERMINATE);
+    sigaddset(&alwaysIgnored, CALLED_CONTINUE);
+    sigprocmask(SIG_BLOCK, &alwaysIgnored, NULL);
+
+    sigset_t criticalCodeBlocker;
+    sigemptyset(&criticalCodeBlocker);
+    sigaddset(&criticalCodeBlocker, SIGINT);
+
+    sigprocmask(SIG_BLOCK, &criticalCodeBlocker, NULL);
+
+    /**
+     * Settings given by command line arguments
+     */
+    MonitorOptions options;
+
+    /**
+     * Timer firing at the absolute deadline of each sample
+     */
+    SampleTimer sampleTimer;
+
+    /**
+     * Connections to the collectors, indexed like collectorRegistry
+     */
+    CollectorLink links[COLLECTOR_COUNT];
+
+    /**
+     * How collectors tell the render loop that their data is ready
+     */
+    CollectorNotifier notifierStorage;
+    CollectorNotifier *notifier = &notifierStorage;
+
+    /**
+     * What each collector runs, kept alive for as long as collector threads may use it
+     */
+    CollectorStart starts[COLLECTOR_COUNT];
+
+    // parse command line arguments
+    if (parseArguments(argc, argv, &options) != 0)
+    {
+        return 1;
+    }
+
+    // samples written for other programs are never interleaved with a prompt
+    bool exporting = options.outputFormat != OUTPUT_FORMAT_TEXT;
+    if (exporting)
+    {
+        sig.sa_sigaction = &quitMainProcess;
+        if (sigaction(SIGINT, &sig, NULL) == -1)
+        {
+            perror("Sigaction: SIGINT");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // pin the monitor and lower its priority before any collector starts, so that they inherit both
+    LowImpactState lowImpact;
+    if (applyLowImpactMode(&options, &lowImpact) != 0)
+    {
+        exit(EXIT_FAILURE);
+    }
+
+    // mark every link as unused until its collector is started
+    if (initCollectorNotifier(notifier) != 0)
+    {
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < COLLECTOR_COUNT; i++)
+    {
+        starts[i] = (CollectorStart){collectorRegistry + i, &options, NULL};
+        if (initCollectorLink(links + i, i, notifier, options.useThreads) != 0)
+        {
+            exit(EXIT_FAILURE);
+        }
+    }
+    bool showGraphics = options.showGraphics;
+    bool showSequential = options.showSequential;
+    bool showCores = options.showCores;
+    bool showMemory = collectorRegistry[MEMORY_COLLECTOR].isEnabled(&options);
+    bool showUsers = collectorRegistry[USER_COLLECTOR].isEnabled(&options);
+    bool showCpu = collectorRegistry[CPU_COLLECTOR].isEnabled(&options);
+    bool showProcesses = collectorRegistry[PROCESS_COLLECTOR].isEnabled(&options);
+    bool showPressure = collectorRegistry[PRESSURE_COLLECTOR].isEnabled(&options);
+    long numSamples = options.numSamples;
+    long sampleDelayMs = options.sampleDelayMs;
+    if (!exporting)
+    {
+        printf("\033[2J\033[3J");
+
+        printf("\033[2J\033[H\n");
+    }
+
+    // printf("Parsed arguments: --system %d --user %d --graphics %d --sequential %d numSamples %ld samplesDelay %ld\n",
+    //        showSystem, showUser, showGraphics, showSequential, numSamples, sampleDelayMs);
+
+    // store previously calculated output of the most recent samples
+    RingBuffer memoryOutput, cpuOutput;
+    if (initRingBuffer(&memoryOutput, options.historyLength, sizeof(char) * HISTORY_LINE_LENGTH) != 0 ||
+        initRingBuffer(&cpuOutput, options.historyLength, sizeof(char) * HISTORY_LINE_LENGTH) != 0)
+    {
+        exit(EXIT_FAILURE);
+    }
+    // all other output received from the children only lives for one sample, so it is kept in an arena that is reset
+    // at the start of every sample rather than allocated and freed string by string
+    Arena sampleArena;
+    if (initArena(&sampleArena, SAMPLE_ARENA_SIZE) != 0)
+    {
+        exit(EXIT_FAILURE);
+    }
+    // sessions are kept between samples, since the user child only sends the ones that were added or removed
+    UserSessionStore userSessions;
+    if (initUserSessionStore(&userSessions) != 0)
+    {
+        exit(EXIT_FAILURE);
+    }
+
+    // records received from the children are rendered into text that lives in the sample arena
+    SampleRenderer renderer;
+    initSampleRenderer(&renderer, &options, &memoryOutput, &cpuOutput, &userSessions);
+    RenderedSample rendered;
+    memset(&rendered, 0, sizeof(rendered));
+    RecordHeader header;
+    void *payload;
+
+    // footprint of the monitor itself, from the usage each collector reports with its records
+    ThreadUsage collectorUsage[COLLECTOR_COUNT];
+    memset(collectorUsage, 0, sizeof(collectorUsage));
+    ThreadUsage previousUsage = {0}, currentUsage;
+    uint64_t previousRenderAllocations = 0;
+
+    // latencies of each stage, kept for the whole run
+    SelfStats selfStats;
+    memset(&selfStats, 0, sizeof(selfStats));
+    const SelfStats *shownSelfStats = options.showSelfStats && !exporting ? &selfStats : NULL;
+
+    // each frame is composed in a buffer that is reused for every sample and written with a single write(), and drawn
+    // on a terminal by updating only the rows that changed
+    char *frameText = NULL;
+    size_t frameLength = 0;
+    FILE *frame = open_memstream(&frameText, &frameLength);
+    if (frame == NULL)
+    {
+        perror("open_memstream");
+        exit(EXIT_FAILURE);
+    }
+    ScreenModel screen;
+    initScreenModel(&screen, isatty(STDOUT_FILENO));
+
+    // start the collectors enabled by the settings
+    for (int i = 0; i < COLLECTOR_COUNT; i++)
+    {
+        if (collectorRegistry[i].isEnabled(&options) && startCollector(links + i, starts + i) != 0)
+        {
+            terminateChildProcesses(links, notifier);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (signal(SIGPIPE, SIG_IGN) == SIG_ERR)
+    {
+        perror("Signal SIGPIPE");
+        terminateChildProcesses(links, notifier);
+        exit(EXIT_FAILURE);
+    }
+
+    // the first sample is taken immediately, and each following sample one period after the previous deadline
+    if (startSampleTimer(&sampleTimer, sampleDelayMs) != 0)
+    {
+        terminateChildProcesses(links, notifier);
+        exit(EXIT_FAILURE);
+    }
+
+    // stalls beyond the threshold are reported while waiting for the next sample, as soon as the kernel signals them
+    PsiTriggers psiTriggers;
+    PsiTriggers *pressureTriggers = NULL;
+    if (showPressure && options.pressureTriggerMs > 0 && !exporting)
+    {
+        if (openPsiTriggers(&psiTriggers, options.pressureTriggerMs) != 0)
+        {
+            terminateChildProcesses(links, notifier);
+            exit(EXIT_FAILURE);
+        }
+        pressureTriggers = &psiTriggers;
+    }
+
+    if (sigprocmask(SIG_UNBLOCK, &criticalCodeBlocker, NULL) == -1) {
+        perror("sigprocmask");
+        terminateChildProcesses(links, notifier);
+        exit(EXIT_FAILURE);
+    }
+
+    for (long thisSample = 0; numSamples == CONTINUOUS_SAMPLES || thisSample <= numSamples; thisSample++)
+    {
+        if (sigprocmask(SIG_BLOCK, &criticalCodeBlocker, NULL) == -1) {
+            perror("sigprocmask");
+            terminateChildProcesses(links, notifier);
+            exit(EXIT_FAILURE);
+        }
+
+        // ensure this iteration's info is empty
+        bool fresh[COLLECTOR_COUNT] = {false};
+        // the records received for this sample, which live in the sample arena
+        const void *freshPayloads[COLLECTOR_COUNT] = {NULL};
+        if (resetArena(&sampleArena) != 0)
+        {
+            terminateChildProcesses(links, notifier);
+            exit(EXIT_FAILURE);
+        }
+        clearRenderedSample(&rendered);
+        double renderSeconds = 0;
+
+        // PASS DATA TO PROCESSES
+
+        double sampleStart = getMonotonicSeconds();
+        for (int i = 0; i < COLLECTOR_COUNT; i++)
+        {
+            // a collector still working on an earlier sample skips this one rather than falling further behind
+            if (!links[i].active || links[i].pendingSample != NO_PENDING_SAMPLE)
+                continue;
+            int startFlag = COLLECTOR_START_FLAG;
+            writeToCollector(links + i, &startFlag, sizeof(int));
+            writeToCollector(links + i, &thisSample, sizeof(long));
+            // the first sample only sets the baseline of the collectors, so no record of it is sent
+            if (thisSample > 0)
+                links[i].pendingSample = thisSample;
+        }
+
+        if (IN_DEBUG_MODE)
+            printf("Passed data\n");
+
+        if (thisSample == 0) // skip printing on first iteration
+        { 
+            // temporarily unblock SIGINT to allow interrupt during sleep
+            sigprocmask(SIG_UNBLOCK, &criticalCodeBlocker, NULL);
+            // sleep
+            sleepForSampleDelay(&sampleTimer, pressureTriggers, links, notifier, shownSelfStats, &screen);
+            continue;
+        }
+
+        // read output from children until every record is in or the deadline passes, so a stalled collector does not
+        // hold up the whole display
+        double deadline = sampleStart + sampleDelayMs / (double)MILLISECONDS_PER_SECOND * COLLECTOR_DEADLINE_PERCENT / 100;
+        while (collectorsPending(links))
+        {
+            int processFunction = 0;
+            int readInp = waitForCollector(notifier, deadline, &processFunction);
+            if (readInp == 0)
+                break;
+            if (readInp == -1)
+            {
+                bool exited = errno == ECHILD;
+                if (!exited)
+                    perror("waitForCollector");
+                if (exited && processFunction >= 0 && processFunction < COLLECTOR_COUNT)
+                {
+                    // the record of a collector that exited will never arrive
+                    fprintf(stderr, "The %s collector exited unexpectedly\n", collectorRegistry[processFunction].name);
+                    links[processFunction].pendingSample = NO_PENDING_SAMPLE;
+                }
+                terminateChildProcesses(links, notifier);
+                return EXIT_FAILURE;
+            }
+            if (IN_DEBUG_MODE)
+                printf("Received info of type %d\n", processFunction);
+            // the data id of a collector is its index in the registry
+            if (processFunction < 0 || processFunction >= COLLECTOR_COUNT)
+            {
+                fprintf(stderr, "Received data of unknown type %d\n", processFunction);
+                terminateChildProcesses(links, notifier);
+                exit(EXIT_FAILURE);
+            }
+            int linkIndex = processFunction;
+            const CollectorDefinition *definition = collectorRegistry + linkIndex;
+            errno = 0;
+            payload = readRecord(links + linkIndex, definition->recordType, &sampleArena, &header, deadline);
+            double readEnd = getMonotonicSeconds();
+            if (payload == NULL && errno == ECHILD)
+                fprintf(stderr, "The %s collector exited unexpectedly\n", definition->name);
+            // part of the record may have been taken already, so a record not finished in time cannot be resumed
+            if (payload == NULL && errno == ETIMEDOUT)
+                fprintf(stderr, "The %s collector did not finish its record before the deadline\n", definition->name);
+            bool renderFailed = payload == NULL ||
+                                definition->render(&renderer, &header, payload, &rendered, &sampleArena) != 0;
+            renderSeconds += getMonotonicSeconds() - readEnd;
+            // a collector that is gone or out of step cannot be resynchronized with
+            if (renderFailed || header.sample != links[linkIndex].pendingSample)
+            {
+                links[linkIndex].pendingSample = NO_PENDING_SAMPLE;
+                terminateChildProcesses(links, notifier);
+                exit(EXIT_FAILURE);
+            }
+            links[linkIndex].pendingSample = NO_PENDING_SAMPLE;
+            collectorUsage[linkIndex] = header.usage;
+            recordLatency(selfStats.collect + linkIndex, header.collectSeconds);
+            recordLatency(selfStats.transfer + linkIndex, readEnd - header.sentAt);
+
+            // a record of an earlier sample is still shown, as it may carry changes later records build on
+            if (header.sample < thisSample)
+                links[linkIndex].lateSamples++;
+            else
+            {
+                fresh[linkIndex] = true;
+                freshPayloads[linkIndex] = payload;
+            }
+        }
+        for (int i = 0; i < COLLECTOR_COUNT; i++)
+        {
+            if (links[i].active && !fresh[i])
+                links[i].missedSamples++;
+        }
+
+        if (IN_DEBUG_MODE)
+            printf("Read data\n");
+        double frameStart = getMonotonicSeconds();
+
+        // the frame is composed in memory, so that only what changed since the previous frame is written to a terminal,
+        // noting where the histories are so that their oldest lines can be left out on a screen too small for the frame
+        rewind(frame);
+        ScreenSpan historySpans[2];
+        int historySpanCount = 0;
+        if (exporting)
+        {
+            // each sample is a single line of raw values, preceded by the names of the columns in the first sample of CSV
+            if (thisSample == 1)
+                formatExportHeader(frame, options.outputFormat);
+            ExportedSample exported = {thisSample, sampleStart, (const MemoryRecord *)freshPayloads[MEMORY_COLLECTOR],
+                                       (const CpuRecord *)freshPayloads[CPU_COLLECTOR],
+                                       (const UsersRecord *)freshPayloads[USER_COLLECTOR]};
+            formatExportedSample(frame, options.outputFormat, &exported);
+        }
+        else
+        {
+            if (!showSequential)
+            {
+                fputc('\n', frame);
+            }
+
+            fprintf(frame, "\n||| Sample #%ld |||\n", thisSample);
+            fprintDivider(frame);
+            if (numSamples == CONTINUOUS_SAMPLES)
+                fprintf(frame, "Nbr of samples: continuous (last %ld kept)", options.historyLength);
+            else
+                fprintf(frame, "Nbr of samples: %ld", numSamples);
+            if (numSamples != CONTINUOUS_SAMPLES && options.historyLength < numSamples)
+                fprintf(frame, " (last %ld kept)", options.historyLength);
+            if (sampleDelayMs % MILLISECONDS_PER_SECOND == 0)
+                fprintf(frame, " -- every %ld secs\n", sampleDelayMs / MILLISECONDS_PER_SECOND);
+            else
+                fprintf(frame, " -- every %.3f secs\n", sampleDelayMs / (double)MILLISECONDS_PER_SECOND);
+            fprintf(frame, "Missed sample deadlines: %lu\n", sampleTimer.missedDeadlines);
+            fprintf(frame, "Late/missed collector samples:");
+            for (int i = 0; i < COLLECTOR_COUNT; i++)
+            {
+                if (links[i].active)
+                    fprintf(frame, " %s %lu/%lu", collectorRegistry[i].name, links[i].lateSamples, links[i].missedSamples);
+            }
+            fprintf(frame, "\n");
+
+            struct rusage rUsageData;
+            if (getrusage(RUSAGE_SELF, &rUsageData) == -1) {
+                perror("getrusage");
+                terminateChildProcesses(links, notifier);
+                exit(EXIT_FAILURE); 
+            }
+            fprintf(frame, "Memory usage: %ld kilobytes\n", rUsageData.ru_maxrss);
+            totalMonitorUsage(collectorUsage, &currentUsage);
+            fprintf(frame, "Monitor footprint since last sample: %.2f ms CPU, %llu context switches\n",
+                   (currentUsage.cpuSeconds - previousUsage.cpuSeconds) * MILLISECONDS_PER_SECOND,
+                   (unsigned long long)(currentUsage.contextSwitches - previousUsage.contextSwitches));
+            uint64_t sampleAllocations = currentUsage.heapAllocations - previousUsage.heapAllocations;
+            uint64_t renderAllocations = countHeapAllocations();
+            previousUsage = currentUsage;
+            if (lowImpact.active)
+            {
+                if (lowImpact.schedIdle)
+                    fprintf(frame, "Low impact mode: CPUs %s, SCHED_IDLE", options.lowImpactCpus);
+                else
+                    fprintf(frame, "Low impact mode: CPUs %s, nice %d", options.lowImpactCpus, LOW_IMPACT_NICE);
+                fprintf(frame, ", timer slack %.1f ms\n", lowImpact.timerSlackNs / (double)NANOSECONDS_PER_MILLISECOND);
+            }
+            fprintf(frame, "Heap allocations this sample: %llu (%llu by the render loop)\n",
+                   (unsigned long long)sampleAllocations, (unsigned long long)(renderAllocations - previousRenderAllocations));
+            previousRenderAllocations = renderAllocations;
+
+            fprintDivider(frame);
+
+            if (showMemory)
+            {
+                if (showGraphics)
+                {
+                    fprintf(frame, "### Memory ### (Phys.Used/Tot -- Virtual Used/Tot, Memory Graphic)\n");
+                }
+                else
+                {
+                    fprintf(frame, "### Memory ### (Phys.Used/Tot -- Virtual Used/Tot)\n");
+                }
+                historySpans[historySpanCount].start = ftell(frame);
+                printHistory(frame, &memoryOutput, numSamples);
+                historySpans[historySpanCount++].end = ftell(frame);
+                if (!fresh[MEMORY_COLLECTOR])
+                    printStaleNotice(frame, collectorRegistry[MEMORY_COLLECTOR].name);
+                if (rendered.memoryBreakdown != NULL)
+                {
+                    fprintf(frame, "%s", rendered.memoryBreakdown);
+                }
+                if (rendered.pagingRates != NULL)
+                {
+                    fprintf(frame, "%s", rendered.pagingRates);
+                }
+                if (rendered.numaMemory != NULL)
+                {
+                    fprintf(frame, "Per-node Memory (Used/Tot, Page Cache, numa_miss and numa_foreign pages/s)\n");
+                    fprintf(frame, "%s", rendered.numaMemory);
+                }
+                fprintDivider(frame);
+            }
+
+            // USER CONNECTIONS (user information)
+            if (showUsers)
+            {
+                fprintf(frame, "### Sessions/users ###\n");
+                if (!fresh[USER_COLLECTOR])
+                    printStaleNotice(frame, collectorRegistry[USER_COLLECTOR].name);
+                for (size_t i = 0; i < userSessions.count; i++)
+                {
+                    if (userSessions.sessions[i].line != NULL)
+                        fprintf(frame, "%s", userSessions.sessions[i].line);
+                }
+                if (rendered.userUsage != NULL && rendered.userUsage[0] != '\0')
+                {
+                    fprintf(frame, "Per-user Usage (CPU%%, Resident Memory, Processes)\n");
+                    fprintf(frame, "%s", rendered.userUsage);
+                }
+                fprintDivider(frame);
+            }
+
+            if (showCpu)
+            {
+                fprintf(frame, "Number of processors: %d\n", rendered.processorCount);
+                fprintf(frame, "Total number of cores: %d\n", rendered.coreCount);
+                fprintf(frame, "Physical cores: %d (%d thread(s) per core)\n", rendered.physicalCoreCount, rendered.physicalCoreCount > 0 ? rendered.coreCount / rendered.physicalCoreCount : 0);
+                // Print the average CPU utilization from beginning to current sample
+                if (rendered.averageCpuUsage != NULL)
+                    fprintf(frame, "%s", rendered.averageCpuUsage);
+
+                fprintDivider(frame);
+
+                if (showGraphics)
+                {
+                    fprintf(frame, "CPU Utilization (%% Use, Relative Abs. Change, %% Use Graphic)\n");
+                }
+                else
+                {
+                    fprintf(frame, "CPU Utilization (%% Use, Relative Abs. Change)\n");
+                }
+
+                historySpans[historySpanCount].start = ftell(frame);
+                printHistory(frame, &cpuOutput, numSamples);
+                historySpans[historySpanCount++].end = ftell(frame);
+                if (!fresh[CPU_COLLECTOR])
+                    printStaleNotice(frame, collectorRegistry[CPU_COLLECTOR].name);
+
+                if (showCores && rendered.coreCpuUsage != NULL)
+                {
+                    fprintDivider(frame);
+                    if (showGraphics)
+                    {
+                        fprintf(frame, "Per-core Utilization (%% Use Graphic, %% Use)\n");
+                    }
+                    else
+                    {
+                        fprintf(frame, "Per-core Utilization (%% Use)\n");
+                    }
+                    fprintf(frame, "%s", rendered.coreCpuUsage);
+                }
+
+                if (rendered.numaCpuUsage != NULL)
+                {
+                    fprintDivider(frame);
+                    fprintf(frame, "Per-node Utilization (%% Use averaged over the node's CPUs)\n");
+                    fprintf(frame, "%s", rendered.numaCpuUsage);
+                }
+
+                fprintDivider(frame);
+            }
+
+            if (showProcesses)
+            {
+                fprintf(frame, "### Top processes ### (PID, CPU%%, Resident Memory, Name)\n");
+                if (!fresh[PROCESS_COLLECTOR])
+                    printStaleNotice(frame, collectorRegistry[PROCESS_COLLECTOR].name);
+                if (rendered.topProcesses != NULL)
+                    fprintf(frame, "%s", rendered.topProcesses);
+                fprintDivider(frame);
+            }
+
+            if (showPressure)
+            {
+                fprintf(frame, "### Pressure ### (some/full: %% of time stalled over 10s, 60s, 300s, time stalled per sec)\n");
+                if (!fresh[PRESSURE_COLLECTOR])
+                    printStaleNotice(frame, collectorRegistry[PRESSURE_COLLECTOR].name);
+                if (rendered.pressureInfo != NULL)
+                    fprintf(frame, "%s", rendered.pressureInfo);
+                if (pressureTriggers != NULL)
+                {
+                    fprintf(frame, "Pressure events over %ld ms: cpu %lu, memory %lu, io %lu\n", pressureTriggers->thresholdMs,
+                           pressureTriggers->events[PSI_CPU], pressureTriggers->events[PSI_MEMORY], pressureTriggers->events[PSI_IO]);
+                    // the line printed when the event happened is cleared by the next frame on a terminal
+                    if (pressureTriggers->latestEvent[0] != '\0')
+                        fprintf(frame, "Latest pressure event: %s\n", pressureTriggers->latestEvent);
+                }
+                fprintDivider(frame);
+            }
+
+            if (options.showSelfStats)
+            {
+                printSelfStats(frame, &selfStats);
+                fprintDivider(frame);
+            }
+
+            fprintf(frame, "||| End of Sample #%ld |||\n", thisSample);
+            // sequential frames are separated in the frame itself, so that each one is a single write
+            if (showSequential)
+                fprintf(frame, "\n\n");
+        }
+        if (fflush(frame) != 0)
+        {
+            perror("fflush: frame");
+            terminateChildProcesses(links, notifier);
+            exit(EXIT_FAILURE);
+        }
+        size_t frameSize = ftell(frame);
+        int drawFailed;
+        if (showSequential || exporting)
+            drawFailed = writeFrameText(frameText, frameSize);
+        else
+            drawFailed = drawScreenFrame(&screen, frameText, frameSize, historySpans, historySpanCount);
+        if (drawFailed)
+        {
+            terminateChildProcesses(links, notifier);
+            exit(EXIT_FAILURE);
+        }
+        recordLatency(&selfStats.render, renderSeconds + getMonotonicSeconds() - frameStart);
+
+        // temporarily unblock SIGINT to allow interrupt during sleep
+        if (sigprocmask(SIG_UNBLOCK, &criticalCodeBlocker, NULL) == -1) {
+            perror("sigprocmask");
+            terminateChildProcesses(links, notifier);
+            exit(EXIT_FAILURE); 
+        }
+        if (thisSample != numSamples) {
+            sleepForSampleDelay(&sampleTimer, pressureTriggers, links, notifier, shownSelfStats, &screen);
+        }
+
+        // a terminal updated in place keeps the cursor below the frame between samples
+        if (!showSequential && !exporting && thisSample == numSamples)
+            printf("\n\n");
+    }
+
+    if (!exporting)
+    {
+        printDivider();
+        if (printSystemInfo() != 0)
+        {
+            return 1;
+        }
+        printDivider();
+        if (options.showSelfStats)
+        {
+            dumpSelfStats(&selfStats);
+            printDivider();
+        }
+    }
+
+    fclose(frame);
+    free(frameText);
+    freeScreenModel(&screen);
+    freeSampleRenderer(&renderer);
+    freeArena(&sampleArena);
+    freeUserSessionStore(&userSessions);
+    freeRingBuffer(&memoryOutput);
+    freeRingBuffer(&cpuOutput);
+
+    if (pressureTriggers != NULL)
+    {
+        closePsiTriggers(pressureTriggers);
+    }
+    stopSampleTimer(&sampleTimer);
+    terminateChildProcesses(links, notifier);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,151 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "heapCounter.h"
+#include "arena.h"
+
+/**
+ * Round a size up to the alignment of arena allocations.
+ * @param size Size in bytes
+ * @returns The rounded size
+ */
+static size_t alignArenaSize(size_t size)
+{
+    return (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+}
+
+/**
+ * Release the overflow blocks allocated since the last reset.
+ * @param arena An arena set up by initArena()
+ */
+static void freeArenaOverflow(Arena *arena)
+{
+    while (arena->overflow != NULL)
+    {
+        ArenaOverflow *next = arena->overflow->next;
+        free(arena->overflow);
+        arena->overflow = next;
+    }
+    arena->overflowBytes = 0;
+}
+
+/**
+ * Allocate the storage of an arena.
+ * @param arena The arena to initialize
+ * @param capacity Initial size of the storage in bytes
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+int initArena(Arena *arena, size_t capacity)
+{
+    arena->capacity = alignArenaSize(capacity);
+    arena->used = 0;
+    arena->overflow = NULL;
+    arena->overflowBytes = 0;
+    arena->data = (char *)aligned_alloc(ARENA_ALIGNMENT, arena->capacity);
+    if (arena->data == NULL)
+    {
+        perror("aligned_alloc");
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Hand out memory that stays valid until the next resetArena().
+ * @param arena An arena set up by initArena()
+ * @param size Number of bytes needed
+ * @returns Pointer to the memory, or NULL if the heap is exhausted
+ */
+void *allocateArena(Arena *arena, size_t size)
+{
+    size = alignArenaSize(size);
+    if (arena->capacity - arena->used >= size)
+    {
+        void *memory = arena->data + arena->used;
+        arena->used += size;
+        return memory;
+    }
+
+    // out of room, so take this allocation from the heap and remember how much was needed
+    size_t header = alignArenaSize(sizeof(ArenaOverflow));
+    noteHeapAllocation();
+    ArenaOverflow *block = (ArenaOverflow *)aligned_alloc(ARENA_ALIGNMENT, header + size);
+    if (block == NULL)
+    {
+        perror("aligned_alloc");
+        return NULL;
+    }
+    block->next = arena->overflow;
+    arena->overflow = block;
+    arena->overflowBytes += size;
+    return (char *)block + header;
+}
+
+/**
+ * Release everything handed out by the arena. If the previous sample overflowed, the storage is grown to fit it.
+ * @param arena An arena set up by initArena()
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+int resetArena(Arena *arena)
+{
+    if (arena->overflow != NULL)
+    {
+        size_t capacity = alignArenaSize((arena->used + arena->overflowBytes) * 2);
+        freeArenaOverflow(arena);
+        noteHeapAllocation();
+        char *larger = (char *)aligned_alloc(ARENA_ALIGNMENT, capacity);
+        if (larger == NULL)
+        {
+            perror("aligned_alloc");
+            return 1;
+        }
+        free(arena->data);
+        arena->data = larger;
+        arena->capacity = capacity;
+    }
+    arena->used = 0;
+    return 0;
+}
+
+/**
+ * Release everything handed out by the arena and make sure its storage holds at least the given number of bytes,
+ * for arenas whose contents are rebuilt at once rather than reset on every sample.
+ * @param arena An arena set up by initArena()
+ * @param capacity Number of bytes the storage must hold
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+int reserveArena(Arena *arena, size_t capacity)
+{
+    if (resetArena(arena) != 0)
+    {
+        return 1;
+    }
+    capacity = alignArenaSize(capacity);
+    if (capacity > arena->capacity)
+    {
+        noteHeapAllocation();
+        char *larger = (char *)aligned_alloc(ARENA_ALIGNMENT, capacity);
+        if (larger == NULL)
+        {
+            perror("aligned_alloc");
+            return 1;
+        }
+        free(arena->data);
+        arena->data = larger;
+        arena->capacity = capacity;
+    }
+    return 0;
+}
+
+/**
+ * Release the storage of an arena.
+ * @param arena An arena set up by initArena()
+ */
+void freeArena(Arena *arena)
+{
+    freeArenaOverflow(arena);
+    free(arena->data);
+    arena->data = NULL;
+    arena->capacity = 0;
+    arena->used = 0;
+}
@@ -0,0 +1,89 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/**
+ * Alignment of every allocation handed out by an arena, enough for any of the types stored in one
+ */
+#define ARENA_ALIGNMENT 16
+
+/**
+ * A block allocated from the heap when an arena runs out of room partway through a sample
+ */
+typedef struct arenaOverflow
+{
+    /**
+     * The next block allocated during the same sample, or NULL
+     */
+    struct arenaOverflow *next;
+} ArenaOverflow;
+
+/**
+ * Bump allocator for memory that lives for a single sample. Allocations are carved out of one block and released
+ * all at once by resetArena(), so a sample that fits in the block makes no heap allocations at all.
+ * If a sample does not fit, the extra memory comes from the heap and the block grows on the next reset to hold it.
+ */
+typedef struct arena
+{
+    /**
+     * Storage allocations are carved out of
+     */
+    char *data;
+    /**
+     * Size of data in bytes
+     */
+    size_t capacity;
+    /**
+     * Number of bytes of data handed out since the last reset
+     */
+    size_t used;
+    /**
+     * Blocks allocated from the heap since the last reset because data was full
+     */
+    ArenaOverflow *overflow;
+    /**
+     * Number of bytes allocated in overflow blocks since the last reset
+     */
+    size_t overflowBytes;
+} Arena;
+
+/**
+ * Allocate the storage of an arena.
+ * @param arena The arena to initialize
+ * @param capacity Initial size of the storage in bytes
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+extern int initArena(Arena *arena, size_t capacity);
+
+/**
+ * Hand out memory that stays valid until the next resetArena().
+ * @param arena An arena set up by initArena()
+ * @param size Number of bytes needed
+ * @returns Pointer to the memory, or NULL if the heap is exhausted
+ */
+extern void *allocateArena(Arena *arena, size_t size);
+
+/**
+ * Release everything handed out by the arena. If the previous sample overflowed, the storage is grown to fit it.
+ * @param arena An arena set up by initArena()
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+extern int resetArena(Arena *arena);
+
+/**
+ * Release everything handed out by the arena and make sure its storage holds at least the given number of bytes,
+ * for arenas whose contents are rebuilt at once rather than reset on every sample.
+ * @param arena An arena set up by initArena()
+ * @param capacity Number of bytes the storage must hold
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+extern int reserveArena(Arena *arena, size_t capacity);
+
+/**
+ * Release the storage of an arena.
+ * @param arena An arena set up by initArena()
+ */
+extern void freeArena(Arena *arena);
+
+#endif
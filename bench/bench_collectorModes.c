@@ -0,0 +1,137 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+#include "sampleTimer.h"
+
+/**
+ * Number of samples the monitor takes in each mode when no number is given
+ */
+#define DEFAULT_SAMPLE_COUNT 200
+
+/**
+ * Max number of arguments passed on to the monitor, on top of those the benchmark gives it
+ */
+#define MAX_EXTRA_ARGUMENTS 16
+
+/**
+ * What a run of the monitor cost, along with every collector process it forked
+ */
+typedef struct runCost
+{
+    double cpuSeconds;
+    long contextSwitches;
+    double wallSeconds;
+} RunCost;
+
+/**
+ * Run the monitor to completion with its output sent to /dev/null, and measure what it cost. The monitor waits for
+ * its collector processes before exiting, so their usage is part of the usage reported for it.
+ * @param monitor Path of the monitor
+ * @param sampleCount Number of samples to take
+ * @param threads Whether the collectors run as threads rather than processes
+ * @param extra Further arguments given to the monitor
+ * @param extraCount Number of further arguments
+ * @param cost Where to store the cost of the run
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+static int runMonitor(const char *monitor, long sampleCount, bool threads, char **extra, int extraCount, RunCost *cost)
+{
+    char samples[32];
+    snprintf(samples, sizeof(samples), "--samples=%ld", sampleCount);
+    char *arguments[MAX_EXTRA_ARGUMENTS + 6] = {(char *)monitor, samples, "--tdelay=0.01", "--sequential"};
+    int argumentCount = 4;
+    if (threads)
+        arguments[argumentCount++] = "--threads";
+    for (int i = 0; i < extraCount; i++)
+        arguments[argumentCount++] = extra[i];
+    arguments[argumentCount] = NULL;
+
+    double start = getMonotonicSeconds();
+    pid_t pid = fork();
+    if (pid == -1)
+    {
+        perror("fork");
+        return 1;
+    }
+    if (pid == 0)
+    {
+        int devNull = open("/dev/null", O_WRONLY);
+        if (devNull == -1 || dup2(devNull, STDOUT_FILENO) == -1)
+        {
+            perror("/dev/null");
+            _exit(127);
+        }
+        execv(monitor, arguments);
+        perror("execv");
+        _exit(127);
+    }
+
+    int status;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) == -1)
+    {
+        perror("wait4");
+        return 1;
+    }
+    cost->wallSeconds = getMonotonicSeconds() - start;
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+        fprintf(stderr, "%s did not exit successfully\n", monitor);
+        return 1;
+    }
+    cost->cpuSeconds = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+    cost->contextSwitches = usage.ru_nvcsw + usage.ru_nivcsw;
+    return 0;
+}
+
+/**
+ * Print what each sample of a run cost on average.
+ * @param name Name of the mode
+ * @param sampleCount Number of samples of the run
+ * @param cost Cost of the run
+ */
+static void reportRun(const char *name, long sampleCount, const RunCost *cost)
+{
+    printf("%-33s %10.1f us CPU/sample %8.2f context switches/sample %8.2f s wall\n", name,
+           cost->cpuSeconds / sampleCount * 1e6, (double)cost->contextSwitches / sampleCount, cost->wallSeconds);
+}
+
+/**
+ * Compare the per-sample overhead of running the collectors as forked processes and as threads, both of which publish
+ * their records into shared rings, by running the monitor in each mode for the same number of samples and measuring
+ * the CPU time and context switches of the monitor and its collectors.
+ * Usage: bench_collectorModes MONITOR [SAMPLES] [MONITOR ARGUMENTS...]
+ */
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: %s MONITOR [SAMPLES] [MONITOR ARGUMENTS...]\n", argv[0]);
+        return 1;
+    }
+    long sampleCount = argc > 2 ? atol(argv[2]) : DEFAULT_SAMPLE_COUNT;
+    int extraCount = argc > 3 ? argc - 3 : 0;
+    if (sampleCount <= 0 || extraCount > MAX_EXTRA_ARGUMENTS)
+    {
+        fprintf(stderr, "The number of samples must be positive, with at most %d monitor arguments\n", MAX_EXTRA_ARGUMENTS);
+        return 1;
+    }
+
+    RunCost processes, threads;
+    if (runMonitor(argv[1], sampleCount, false, argv + 3, extraCount, &processes) != 0 ||
+        runMonitor(argv[1], sampleCount, true, argv + 3, extraCount, &threads) != 0)
+    {
+        return 1;
+    }
+    printf("%ld samples every 10 ms\n", sampleCount);
+    reportRun("forked processes and shared rings", sampleCount, &processes);
+    reportRun("threads and shared rings", sampleCount, &threads);
+    return 0;
+}
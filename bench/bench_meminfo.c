@@ -0,0 +1,138 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/sysinfo.h>
+
+#include "sampleTimer.h"
+#include "procFile.h"
+#include "sampleRecord.h"
+#include "parseMemoryStats.h"
+
+/**
+ * Number of parses timed for each parser when no count is given
+ */
+#define DEFAULT_PARSE_COUNT 100000
+
+/**
+ * Max length of a line of /proc/meminfo read by parseWithStrstr()
+ */
+#define MEMINFO_LINE_LENGTH 256
+
+/**
+ * Keys of /proc/meminfo looked up by parseWithStrstr(), in the order of the MEMINFO_* slots
+ */
+static const char *const strstrKeys[MEMINFO_KEY_COUNT] = {
+    "MemTotal:", "MemFree:", "MemAvailable:", "Buffers:", "Cached:", "Shmem:",
+    "Slab:", "Dirty:", "Writeback:", "SwapTotal:", "SwapFree:"};
+
+/**
+ * Parse a /proc/meminfo file the usual way, which computeMemory() avoids: open it with fopen() on every sample and
+ * search every line read by fgets() for each key of interest with strstr().
+ * @param path Path of the file
+ * @param values Where to store the value of each key, in the order of the MEMINFO_* slots
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+static int parseWithStrstr(const char *path, unsigned long long *values)
+{
+    char line[MEMINFO_LINE_LENGTH];
+    FILE *meminfo = fopen(path, "r");
+    if (meminfo == NULL)
+    {
+        perror("fopen");
+        return 1;
+    }
+    memset(values, 0, sizeof(unsigned long long) * MEMINFO_KEY_COUNT);
+    while (fgets(line, MEMINFO_LINE_LENGTH, meminfo) != NULL)
+    {
+        for (int key = 0; key < MEMINFO_KEY_COUNT; key++)
+        {
+            char *found = strstr(line, strstrKeys[key]);
+            if (found == line)
+            {
+                values[key] = strtoull(found + strlen(strstrKeys[key]), NULL, 10);
+                break;
+            }
+        }
+    }
+    fclose(meminfo);
+    return 0;
+}
+
+/**
+ * Print the time each parse took on average.
+ * @param name Name of the parser
+ * @param count Number of parses
+ * @param seconds Time all parses took, in seconds
+ */
+static void reportParses(const char *name, long count, double seconds)
+{
+    printf("%-36s %10.1f ns/parse\n", name, seconds / count * 1e9);
+}
+
+/**
+ * Time reading the memory with sysinfo(), as the memory collector did before it read /proc/meminfo, and parsing a
+ * captured /proc/meminfo with strstr() on every line and with computeMemory().
+ * Usage: bench_meminfo FIXTURE [COUNT]
+ */
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: %s FIXTURE [COUNT]\n", argv[0]);
+        return 1;
+    }
+    const char *path = argv[1];
+    long count = argc > 2 ? atol(argv[2]) : DEFAULT_PARSE_COUNT;
+    if (count <= 0)
+    {
+        fprintf(stderr, "The number of parses must be positive\n");
+        return 1;
+    }
+
+    struct sysinfo sysinfoData;
+    double start = getMonotonicSeconds();
+    for (long i = 0; i < count; i++)
+    {
+        if (sysinfo(&sysinfoData) != 0)
+        {
+            perror("sysinfo");
+            return 1;
+        }
+    }
+    reportParses("sysinfo() of the host (before)", count, getMonotonicSeconds() - start);
+
+    unsigned long long values[MEMINFO_KEY_COUNT];
+    start = getMonotonicSeconds();
+    for (long i = 0; i < count; i++)
+    {
+        if (parseWithStrstr(path, values) != 0)
+            return 1;
+    }
+    reportParses("fopen + fgets + strstr", count, getMonotonicSeconds() - start);
+
+    ProcFile meminfoFile;
+    if (openProcFile(&meminfoFile, path, MEMINFO_BUFFER_SIZE) != 0)
+    {
+        return 1;
+    }
+    ProcKeyTable keyTable;
+    initMeminfoKeyTable(&keyTable);
+    MemoryRecord record;
+    memset(&record, 0, sizeof(record));
+    start = getMonotonicSeconds();
+    for (long i = 0; i < count; i++)
+    {
+        if (computeMemory(&meminfoFile, &keyTable, &record) != 0)
+            return 1;
+    }
+    reportParses("computeMemory", count, getMonotonicSeconds() - start);
+    closeProcFile(&meminfoFile);
+
+    if (record.physTotalKb != values[MEMINFO_TOTAL] || record.cachedKb != values[MEMINFO_CACHED] ||
+        record.dirtyKb != values[MEMINFO_DIRTY] || record.writebackKb != values[MEMINFO_WRITEBACK])
+    {
+        fprintf(stderr, "The parsers disagree on the values of %s\n", path);
+        return 1;
+    }
+    return 0;
+}
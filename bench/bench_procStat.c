@@ -0,0 +1,131 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sampleTimer.h"
+#include "procFile.h"
+#include "parseCpuStats.h"
+
+/**
+ * Number of parses timed for each parser when no count is given
+ */
+#define DEFAULT_PARSE_COUNT 100000
+
+/**
+ * Max length of the first line of /proc/stat read by parseWithStdio()
+ */
+#define STAT_LINE_LENGTH 256
+
+/**
+ * Parse the first line of a /proc/stat file the way recordCpuStats() did before the file was kept open: open it with
+ * fopen() on every sample, read the line with fgets() and split it with strtok() and atol().
+ * @param path Path of the file
+ * @param sample Where to store the parsed values
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+static int parseWithStdio(const char *path, CpuDataSample *sample)
+{
+    char totalLine[STAT_LINE_LENGTH];
+    FILE *statdata = fopen(path, "r");
+    if (statdata == NULL)
+    {
+        perror("fopen");
+        return 1;
+    }
+    if (fgets(totalLine, STAT_LINE_LENGTH, statdata) == NULL)
+    {
+        fclose(statdata);
+        return 1;
+    }
+    long *fields[] = {&sample->user, &sample->nice, &sample->system, &sample->idle, &sample->iowait,
+                      &sample->irq, &sample->softirq, &sample->steal, &sample->guest, &sample->guest_nice};
+    strtok(totalLine, " ");
+    char *nextNum = strtok(NULL, " ");
+    for (int index = 0; nextNum != NULL && index < 10; index++)
+    {
+        *fields[index] = atol(nextNum);
+        nextNum = strtok(NULL, " ");
+    }
+    fclose(statdata);
+    return 0;
+}
+
+/**
+ * Print the time each parse took on average.
+ * @param name Name of the parser
+ * @param count Number of parses
+ * @param seconds Time all parses took, in seconds
+ */
+static void reportParses(const char *name, long count, double seconds)
+{
+    printf("%-36s %10.1f ns/parse\n", name, seconds / count * 1e9);
+}
+
+/**
+ * Time parsing a captured /proc/stat with the stdio parser /proc/stat was read with before, and with
+ * recordCpuStats(), with and without the per-core lines.
+ * Usage: bench_procStat FIXTURE [COUNT]
+ */
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: %s FIXTURE [COUNT]\n", argv[0]);
+        return 1;
+    }
+    const char *path = argv[1];
+    long count = argc > 2 ? atol(argv[2]) : DEFAULT_PARSE_COUNT;
+    if (count <= 0)
+    {
+        fprintf(stderr, "The number of parses must be positive\n");
+        return 1;
+    }
+
+    CpuDataSample before, after;
+    double start = getMonotonicSeconds();
+    for (long i = 0; i < count; i++)
+    {
+        if (parseWithStdio(path, &before) != 0)
+            return 1;
+    }
+    reportParses("fopen + fgets + strtok (before)", count, getMonotonicSeconds() - start);
+
+    ProcFile statFile;
+    if (openProcFile(&statFile, path, PROC_STAT_BUFFER_SIZE) != 0)
+    {
+        return 1;
+    }
+    start = getMonotonicSeconds();
+    for (long i = 0; i < count; i++)
+    {
+        if (recordCpuStats(&statFile, &after, NULL) != 0)
+            return 1;
+    }
+    reportParses("recordCpuStats", count, getMonotonicSeconds() - start);
+
+    // the core table only allocates as it first grows, which the warm-up parse takes care of
+    CpuCoreTable coreTable;
+    memset(&coreTable, 0, sizeof(coreTable));
+    if (recordCpuStats(&statFile, &after, &coreTable) != 0)
+    {
+        return 1;
+    }
+    start = getMonotonicSeconds();
+    for (long i = 0; i < count; i++)
+    {
+        if (recordCpuStats(&statFile, &after, &coreTable) != 0)
+            return 1;
+    }
+    char name[64];
+    snprintf(name, sizeof(name), "recordCpuStats, %d cpuN lines", coreTable.coreCount);
+    reportParses(name, count, getMonotonicSeconds() - start);
+
+    freeCpuCoreTable(&coreTable);
+    closeProcFile(&statFile);
+    if (memcmp(&before, &after, sizeof(CpuDataSample)) != 0)
+    {
+        fprintf(stderr, "The parsers disagree on the values of %s\n", path);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,228 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <utmp.h>
+
+#include "heapCounter.h"
+#include "sampleTimer.h"
+#include "printUsers.h"
+#include "sessionStore.h"
+
+/**
+ * Number of sessions logged in at once when no number is given
+ */
+#define DEFAULT_SESSION_COUNT 20000
+
+/**
+ * Number of sessions that log out, and of sessions that log in, on each sample when no number is given
+ */
+#define DEFAULT_CHANGE_COUNT 200
+
+/**
+ * Number of samples timed when no number is given
+ */
+#define DEFAULT_SAMPLE_COUNT 1000
+
+/**
+ * Write a utmp file of synthetic sessions, each on its own terminal and from its own host.
+ * @param path Path of the file
+ * @param count Number of sessions
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+static int writeSyntheticUtmp(const char *path, long count)
+{
+    FILE *file = fopen(path, "w");
+    if (file == NULL)
+    {
+        perror("fopen");
+        return 1;
+    }
+    for (long i = 0; i < count; i++)
+    {
+        struct utmp entry;
+        memset(&entry, 0, sizeof(entry));
+        entry.ut_type = USER_PROCESS;
+        entry.ut_pid = 1000 + i;
+        snprintf(entry.ut_line, UT_LINESIZE, "pts/%ld", i);
+        snprintf(entry.ut_user, UT_NAMESIZE, "user%ld", i % 1000);
+        snprintf(entry.ut_host, UT_HOSTSIZE, "10.%ld.%ld.%ld", i / 65536 % 256, i / 256 % 256, i % 256);
+        if (fwrite(&entry, sizeof(entry), 1, file) != 1)
+        {
+            perror("fwrite");
+            fclose(file);
+            return 1;
+        }
+    }
+    return fclose(file) == 0 ? 0 : 1;
+}
+
+/**
+ * Read the line printed for every session of a utmp file, in the format the parent prints sessions in.
+ * @param path Path of the file
+ * @param count Number of sessions in the file
+ * @returns Array of count lines of USER_LINE_LENGTH bytes, or NULL if the file could not be read
+ */
+static char *readSessionLines(const char *path, long count)
+{
+    char *lines = (char *)malloc((size_t)count * USER_LINE_LENGTH);
+    if (lines == NULL)
+    {
+        perror("malloc");
+        return NULL;
+    }
+    if (utmpname(path) != 0)
+    {
+        perror("utmpname");
+        free(lines);
+        return NULL;
+    }
+    setutent();
+    long read = 0;
+    struct utmp *data;
+    while (read < count && (data = getutent()) != NULL)
+    {
+        if (data->ut_type != USER_PROCESS)
+            continue;
+        snprintf(lines + read * USER_LINE_LENGTH, USER_LINE_LENGTH, "%.*s\t %.*s (%.*s)\n", UT_NAMESIZE, data->ut_user,
+                 UT_LINESIZE, data->ut_line, UT_HOSTSIZE, data->ut_host);
+        read++;
+    }
+    endutent();
+    if (read != count)
+    {
+        fprintf(stderr, "Read %ld of the %ld sessions of %s\n", read, count, path);
+        free(lines);
+        return NULL;
+    }
+    return lines;
+}
+
+/**
+ * Print the time and heap allocations each sample took on average.
+ * @param name Name of the approach
+ * @param count Number of samples
+ * @param seconds Time all samples took, in seconds
+ * @param allocations Heap allocations all samples made
+ */
+static void reportSamples(const char *name, long count, double seconds, uint64_t allocations)
+{
+    printf("%-44s %10.1f us/sample %10.2f allocations/sample\n", name, seconds / count * 1e6, (double)allocations / count);
+}
+
+/**
+ * Stress the session store of the parent with a synthetic utmp file, in which a window of sessions slides forward on
+ * every sample: the oldest sessions log out and as many new ones log in. The sessions are kept the way the parent
+ * kept them before the session store, with every line allocated and freed on every sample, and in the session store,
+ * which is only told of the sessions that changed.
+ * Usage: bench_sessionStore [SESSIONS] [CHANGES] [SAMPLES]
+ */
+int main(int argc, char **argv)
+{
+    long sessionCount = argc > 1 ? atol(argv[1]) : DEFAULT_SESSION_COUNT;
+    long changeCount = argc > 2 ? atol(argv[2]) : DEFAULT_CHANGE_COUNT;
+    long sampleCount = argc > 3 ? atol(argv[3]) : DEFAULT_SAMPLE_COUNT;
+    if (sessionCount <= 0 || changeCount < 0 || changeCount > sessionCount || sampleCount <= 0)
+    {
+        fprintf(stderr, "Usage: %s [SESSIONS] [CHANGES] [SAMPLES], with at most SESSIONS changes per sample\n", argv[0]);
+        return 1;
+    }
+
+    // every session that is ever logged in has an entry in the file
+    long totalCount = sessionCount + changeCount * sampleCount;
+    char path[] = "/tmp/bench_utmp.XXXXXX";
+    int fd = mkstemp(path);
+    if (fd == -1)
+    {
+        perror("mkstemp");
+        return 1;
+    }
+    close(fd);
+    char *lines = NULL;
+    if (writeSyntheticUtmp(path, totalCount) == 0)
+        lines = readSessionLines(path, totalCount);
+    unlink(path);
+    if (lines == NULL)
+    {
+        return 1;
+    }
+    printf("%ld sessions, %ld logging out and in on each of %ld samples\n", sessionCount, changeCount, sampleCount);
+
+    // before: every session is copied into its own allocation on every sample, and all of them are freed after printing
+    char **copies = (char **)malloc(sizeof(char *) * sessionCount);
+    if (copies == NULL)
+    {
+        perror("malloc");
+        return 1;
+    }
+    double start = getMonotonicSeconds();
+    uint64_t allocations = countHeapAllocations();
+    for (long sample = 0; sample < sampleCount; sample++)
+    {
+        const char *window = lines + sample * changeCount * USER_LINE_LENGTH;
+        for (long i = 0; i < sessionCount; i++)
+        {
+            noteHeapAllocation();
+            copies[i] = strdup(window + i * USER_LINE_LENGTH);
+        }
+        for (long i = 0; i < sessionCount; i++)
+        {
+            free(copies[i]);
+        }
+    }
+    reportSamples("allocation per session per sample (before)", sampleCount, getMonotonicSeconds() - start,
+                  countHeapAllocations() - allocations);
+    free(copies);
+
+    // after: the sessions are added to the store once, and each sample only removes and adds the ones that changed
+    UserSessionStore store;
+    if (initUserSessionStore(&store) != 0)
+    {
+        return 1;
+    }
+    start = getMonotonicSeconds();
+    allocations = countHeapAllocations();
+    for (long i = 0; i < sessionCount; i++)
+    {
+        const char *line = lines + i * USER_LINE_LENGTH;
+        size_t lineLength = strlen(line);
+        char *storedLine = addUserSession(&store, (int)i, lineLength);
+        if (storedLine == NULL)
+            return 1;
+        memcpy(storedLine, line, lineLength + 1);
+    }
+    reportSamples("session store, first sample", 1, getMonotonicSeconds() - start, countHeapAllocations() - allocations);
+
+    start = getMonotonicSeconds();
+    allocations = countHeapAllocations();
+    for (long sample = 0; sample < sampleCount; sample++)
+    {
+        long first = sample * changeCount;
+        for (long i = first; i < first + changeCount; i++)
+        {
+            if (removeUserSession(&store, (int)i) != 0)
+                return 1;
+        }
+        for (long i = first + sessionCount; i < first + sessionCount + changeCount; i++)
+        {
+            const char *line = lines + i * USER_LINE_LENGTH;
+            size_t lineLength = strlen(line);
+            char *storedLine = addUserSession(&store, (int)i, lineLength);
+            if (storedLine == NULL)
+                return 1;
+            memcpy(storedLine, line, lineLength + 1);
+        }
+    }
+    reportSamples("session store, later samples", sampleCount, getMonotonicSeconds() - start, countHeapAllocations() - allocations);
+
+    size_t kept = countUserSessions(&store);
+    freeUserSessionStore(&store);
+    free(lines);
+    if (kept != (size_t)sessionCount)
+    {
+        fprintf(stderr, "The session store holds %zu sessions rather than %ld\n", kept, sessionCount);
+        return 1;
+    }
+    return 0;
+}
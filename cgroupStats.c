@@ -0,0 +1,313 @@
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "procFile.h"
+#include "sampleTimer.h"
+#include "cgroupStats.h"
+
+/**
+ * Keys of memory.stat read on every sample, in the order of the CGROUP_MEMORY_* slots
+ */
+static const char *const memoryStatKeys[CGROUP_MEMORY_STAT_COUNT] = {
+    "anon", "file", "inactive_file", "shmem", "slab", "file_dirty", "file_writeback"};
+
+/**
+ * Keys of cpu.stat read on every sample, in the order of the CGROUP_CPU_* slots
+ */
+static const char *const cpuStatKeys[CGROUP_CPU_STAT_COUNT] = {
+    "usage_usec", "nr_periods", "nr_throttled", "throttled_usec"};
+
+/**
+ * Copy the next whitespace separated field at the cursor and advance the cursor past it.
+ * @param cursor Pointer to the current position within a null terminated string
+ * @param field Buffer to copy the field to, truncated if it does not fit
+ * @param fieldLength Size of field in bytes
+ */
+static void copyField(const char **cursor, char *field, size_t fieldLength)
+{
+    while (**cursor == ' ' || **cursor == '\t')
+        (*cursor)++;
+    size_t length = 0;
+    while (**cursor != '\0' && **cursor != ' ' && **cursor != '\t' && **cursor != '\n')
+    {
+        if (length < fieldLength - 1)
+            field[length++] = **cursor;
+        (*cursor)++;
+    }
+    field[length] = '\0';
+}
+
+/**
+ * Find the path of the monitor's cgroup v2 from the "0::" line of /proc/self/cgroup.
+ * @param name Buffer of CGROUP_PATH_LENGTH bytes to store the path in
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+static int findCgroupName(char *name)
+{
+    ProcFile cgroupFile;
+    if (openProcFile(&cgroupFile, "/proc/self/cgroup", CGROUP_PATH_LENGTH) != 0)
+        return 1;
+    int status = readProcFile(&cgroupFile);
+
+    const char *cursor = cgroupFile.buffer;
+    bool found = false;
+    while (status == 0 && !found)
+    {
+        if (strncmp(cursor, "0::", 3) == 0)
+        {
+            cursor += 3;
+            copyField(&cursor, name, CGROUP_PATH_LENGTH);
+            found = true;
+        }
+        else if (!skipLine(&cursor))
+        {
+            break;
+        }
+    }
+    closeProcFile(&cgroupFile);
+
+    if (status == 0 && !found)
+    {
+        fprintf(stderr, "No cgroup v2 membership listed in /proc/self/cgroup\n");
+        return 1;
+    }
+    return status;
+}
+
+/**
+ * Find where the cgroup v2 hierarchy is mounted from /proc/self/mountinfo.
+ * @param mountRoot Buffer of CGROUP_PATH_LENGTH bytes to store the cgroup at the root of the mount in
+ * @param mountPoint Buffer of CGROUP_PATH_LENGTH bytes to store the directory the hierarchy is mounted on
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+static int findCgroupMount(char *mountRoot, char *mountPoint)
+{
+    ProcFile mountFile;
+    if (openProcFile(&mountFile, "/proc/self/mountinfo", MOUNTINFO_BUFFER_SIZE) != 0)
+        return 1;
+    // the mount table can be long on container hosts, so grow the buffer until all of it fits
+    int status;
+    while ((status = readProcFile(&mountFile)) == 0 && isProcFileTruncated(&mountFile))
+    {
+        if (growProcFile(&mountFile) != 0)
+        {
+            status = 1;
+            break;
+        }
+    }
+
+    // each line is "id parent major:minor root mountpoint options [optional fields] - fstype source superoptions"
+    const char *cursor = mountFile.buffer;
+    bool found = false;
+    char fileSystem[16];
+    while (status == 0 && !found)
+    {
+        skipField(&cursor);
+        skipField(&cursor);
+        skipField(&cursor);
+        copyField(&cursor, mountRoot, CGROUP_PATH_LENGTH);
+        copyField(&cursor, mountPoint, CGROUP_PATH_LENGTH);
+        const char *separator = cursor;
+        while (*separator != '\0' && *separator != '\n' && !(separator[0] == ' ' && separator[1] == '-' && separator[2] == ' '))
+            separator++;
+        if (*separator == ' ')
+        {
+            cursor = separator + 2;
+            copyField(&cursor, fileSystem, sizeof(fileSystem));
+            found = strcmp(fileSystem, "cgroup2") == 0;
+        }
+        if (!found && !skipLine(&cursor))
+            break;
+    }
+    closeProcFile(&mountFile);
+
+    if (status == 0 && !found)
+    {
+        fprintf(stderr, "No cgroup v2 hierarchy is mounted\n");
+        return 1;
+    }
+    return status;
+}
+
+/**
+ * Open a file of the cgroup if it exists, leaving it closed otherwise.
+ * @param cgroup The cgroup, with its directory set
+ * @param file The ProcFile to initialize
+ * @param fileName Name of the file within the cgroup directory
+ * @param capacity Size of the read buffer in bytes
+ * @returns true if the file was opened, false otherwise
+ */
+static bool openCgroupFile(const Cgroup *cgroup, ProcFile *file, const char *fileName, size_t capacity)
+{
+    file->fd = -1;
+    file->buffer = NULL;
+    file->capacity = 0;
+    file->length = 0;
+
+    char path[CGROUP_PATH_LENGTH];
+    if (snprintf(path, CGROUP_PATH_LENGTH, "%s/%s", cgroup->directory, fileName) >= CGROUP_PATH_LENGTH)
+        return false;
+    // controllers that are not enabled for the cgroup have no files, which is expected rather than an error
+    if (access(path, R_OK) != 0)
+        return false;
+    return openProcFile(file, path, capacity) == 0;
+}
+
+/**
+ * Read a file holding a single value or "max".
+ * @param file The file, which may not be open
+ * @param value Where to store the value, which is CGROUP_UNLIMITED for "max"
+ * @param missing Value to store if the file is not open
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+static int readCgroupValue(ProcFile *file, unsigned long long *value, unsigned long long missing)
+{
+    if (file->fd == -1)
+    {
+        *value = missing;
+        return 0;
+    }
+    if (readProcFile(file) != 0)
+        return 1;
+    const char *cursor = file->buffer;
+    *value = strncmp(cursor, "max", 3) == 0 ? CGROUP_UNLIMITED : scanUnsigned(&cursor);
+    return 0;
+}
+
+/**
+ * Find the cgroup v2 the monitor runs in from /proc/self/cgroup and the mount table, and open its memory and CPU files.
+ * A controller whose files are missing is marked as unavailable rather than failing.
+ * @param cgroup The cgroup to initialize
+ * @returns 0 if operation was successful, 1 if no cgroup v2 hierarchy was found
+ */
+int openCgroup(Cgroup *cgroup)
+{
+    char mountRoot[CGROUP_PATH_LENGTH], mountPoint[CGROUP_PATH_LENGTH];
+    if (findCgroupName(cgroup->name) != 0 || findCgroupMount(mountRoot, mountPoint) != 0)
+    {
+        return 1;
+    }
+
+    // inside a cgroup namespace the root of the mount is usually the monitor's own cgroup, so only the rest of the path is appended
+    const char *relative = cgroup->name;
+    size_t rootLength = strlen(mountRoot);
+    if (strcmp(mountRoot, "/") != 0 && strncmp(relative, mountRoot, rootLength) == 0)
+    {
+        relative += rootLength;
+    }
+    if (snprintf(cgroup->directory, CGROUP_PATH_LENGTH, "%s%s", mountPoint, strcmp(relative, "/") == 0 ? "" : relative) >= CGROUP_PATH_LENGTH)
+    {
+        fprintf(stderr, "Path of cgroup %s is too long\n", cgroup->name);
+        return 1;
+    }
+    if (access(cgroup->directory, R_OK) != 0)
+    {
+        fprintf(stderr, "Encountered error opening cgroup %s: ", cgroup->directory);
+        perror("access");
+        return 1;
+    }
+
+    bool hasMemoryCurrent = openCgroupFile(cgroup, &cgroup->memoryCurrent, "memory.current", CGROUP_VALUE_BUFFER_SIZE);
+    bool hasMemoryStat = openCgroupFile(cgroup, &cgroup->memoryStat, "memory.stat", CGROUP_STAT_BUFFER_SIZE);
+    cgroup->hasMemory = hasMemoryCurrent && hasMemoryStat;
+    openCgroupFile(cgroup, &cgroup->memoryMax, "memory.max", CGROUP_VALUE_BUFFER_SIZE);
+    openCgroupFile(cgroup, &cgroup->memorySwapCurrent, "memory.swap.current", CGROUP_VALUE_BUFFER_SIZE);
+    openCgroupFile(cgroup, &cgroup->memorySwapMax, "memory.swap.max", CGROUP_VALUE_BUFFER_SIZE);
+    cgroup->hasCpu = openCgroupFile(cgroup, &cgroup->cpuStat, "cpu.stat", CGROUP_STAT_BUFFER_SIZE);
+    openCgroupFile(cgroup, &cgroup->cpuMax, "cpu.max", CGROUP_VALUE_BUFFER_SIZE);
+
+    initProcKeyTable(&cgroup->memoryStatKeys, memoryStatKeys, CGROUP_MEMORY_STAT_COUNT);
+    initProcKeyTable(&cgroup->cpuStatKeys, cpuStatKeys, CGROUP_CPU_STAT_COUNT);
+    return 0;
+}
+
+/**
+ * Read the memory usage and limits of the cgroup.
+ * @param cgroup A cgroup opened with openCgroup() with hasMemory set
+ * @param memory Where to store the usage
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+int readCgroupMemory(Cgroup *cgroup, CgroupMemory *memory)
+{
+    if (readCgroupValue(&cgroup->memoryCurrent, &memory->current, 0) != 0 ||
+        readCgroupValue(&cgroup->memoryMax, &memory->limit, CGROUP_UNLIMITED) != 0 ||
+        readCgroupValue(&cgroup->memorySwapCurrent, &memory->swapCurrent, 0) != 0 ||
+        readCgroupValue(&cgroup->memorySwapMax, &memory->swapLimit, CGROUP_UNLIMITED) != 0 ||
+        readProcFile(&cgroup->memoryStat) != 0)
+    {
+        return 1;
+    }
+    parseKeyedValues(&cgroup->memoryStatKeys, cgroup->memoryStat.buffer, 0, memory->stat, CGROUP_MEMORY_STAT_COUNT);
+    return 0;
+}
+
+/**
+ * Read the CPU time and limits of the cgroup.
+ * @param cgroup A cgroup opened with openCgroup() with hasCpu set
+ * @param cpu Where to store the CPU time
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+int readCgroupCpu(Cgroup *cgroup, CgroupCpu *cpu)
+{
+    if (readProcFile(&cgroup->cpuStat) != 0)
+    {
+        return 1;
+    }
+    cpu->seconds = getMonotonicSeconds();
+    parseKeyedValues(&cgroup->cpuStatKeys, cgroup->cpuStat.buffer, 0, cpu->stat, CGROUP_CPU_STAT_COUNT);
+
+    // cpu.max is "quota period", where a quota of "max" means no limit
+    cpu->limitCpus = 0;
+    if (cgroup->cpuMax.fd != -1)
+    {
+        if (readProcFile(&cgroup->cpuMax) != 0)
+        {
+            return 1;
+        }
+        const char *cursor = cgroup->cpuMax.buffer;
+        if (strncmp(cursor, "max", 3) != 0)
+        {
+            unsigned long long quota = scanUnsigned(&cursor);
+            unsigned long long period = scanUnsigned(&cursor);
+            if (period > 0)
+                cpu->limitCpus = quota / (double)period;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Calculate the CPU utilization of the cgroup between two reads, relative to the CPU time it is allowed.
+ * @param previous The earlier read
+ * @param current The later read
+ * @param onlineCpus Number of online CPUs, which bounds the cgroup when it has no quota
+ * @returns Percentage CPU utilization, where 100 is the whole quota or every online CPU
+ */
+float calculateCgroupCpuUsage(const CgroupCpu *previous, const CgroupCpu *current, int onlineCpus)
+{
+    double allowedCpus = onlineCpus > 0 ? onlineCpus : 1;
+    if (current->limitCpus > 0 && current->limitCpus < allowedCpus)
+        allowedCpus = current->limitCpus;
+    double elapsedUsec = (current->seconds - previous->seconds) * 1e6;
+    if (elapsedUsec <= 0 || current->stat[CGROUP_CPU_USAGE_USEC] < previous->stat[CGROUP_CPU_USAGE_USEC])
+        return 0.0;
+    float usage = (current->stat[CGROUP_CPU_USAGE_USEC] - previous->stat[CGROUP_CPU_USAGE_USEC]) / (elapsedUsec * allowedCpus) * 100;
+    return usage > 100 ? 100 : usage;
+}
+
+/**
+ * Close the files of the cgroup.
+ * @param cgroup A cgroup opened with openCgroup()
+ */
+void closeCgroup(Cgroup *cgroup)
+{
+    closeProcFile(&cgroup->memoryCurrent);
+    closeProcFile(&cgroup->memoryMax);
+    closeProcFile(&cgroup->memorySwapCurrent);
+    closeProcFile(&cgroup->memorySwapMax);
+    closeProcFile(&cgroup->memoryStat);
+    closeProcFile(&cgroup->cpuStat);
+    closeProcFile(&cgroup->cpuMax);
+}
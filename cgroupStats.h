@@ -0,0 +1,165 @@
+#ifndef CGROUP_STATS_H
+#define CGROUP_STATS_H
+
+#include <stdbool.h>
+
+#include "procFile.h"
+
+/**
+ * Max length of the path to a cgroup directory or a file within it
+ */
+#define CGROUP_PATH_LENGTH 4096
+
+/**
+ * Size of the buffer that files holding a single value, such as memory.max, are read into
+ */
+#define CGROUP_VALUE_BUFFER_SIZE 64
+
+/**
+ * Size of the buffer that memory.stat and cpu.stat are read into
+ */
+#define CGROUP_STAT_BUFFER_SIZE 8192
+
+/**
+ * Size of the buffer that /proc/self/mountinfo is first read into, which grows if the mount table does not fit
+ */
+#define MOUNTINFO_BUFFER_SIZE 16384
+
+/**
+ * Value of a memory limit that is not set, written as "max" by the kernel
+ */
+#define CGROUP_UNLIMITED (~0ULL)
+
+/**
+ * Slots of the values read from memory.stat, in bytes
+ */
+#define CGROUP_MEMORY_ANON 0
+#define CGROUP_MEMORY_FILE 1
+#define CGROUP_MEMORY_INACTIVE_FILE 2
+#define CGROUP_MEMORY_SHMEM 3
+#define CGROUP_MEMORY_SLAB 4
+#define CGROUP_MEMORY_DIRTY 5
+#define CGROUP_MEMORY_WRITEBACK 6
+#define CGROUP_MEMORY_STAT_COUNT 7
+
+/**
+ * Slots of the values read from cpu.stat
+ */
+#define CGROUP_CPU_USAGE_USEC 0
+#define CGROUP_CPU_PERIODS 1
+#define CGROUP_CPU_THROTTLED_PERIODS 2
+#define CGROUP_CPU_THROTTLED_USEC 3
+#define CGROUP_CPU_STAT_COUNT 4
+
+/**
+ * Memory usage and limits of a cgroup at one point in time
+ */
+typedef struct cgroupMemory
+{
+    /**
+     * Memory charged to the cgroup, including page cache, in bytes (memory.current)
+     */
+    unsigned long long current;
+    /**
+     * Memory limit of the cgroup in bytes, or CGROUP_UNLIMITED (memory.max)
+     */
+    unsigned long long limit;
+    /**
+     * Swap used by the cgroup in bytes, or 0 if swap is not accounted (memory.swap.current)
+     */
+    unsigned long long swapCurrent;
+    /**
+     * Swap limit of the cgroup in bytes, or CGROUP_UNLIMITED (memory.swap.max)
+     */
+    unsigned long long swapLimit;
+    /**
+     * Breakdown of memory.current, indexed by the CGROUP_MEMORY_* slots
+     */
+    unsigned long long stat[CGROUP_MEMORY_STAT_COUNT];
+} CgroupMemory;
+
+/**
+ * CPU time and limits of a cgroup at one point in time
+ */
+typedef struct cgroupCpu
+{
+    /**
+     * Counters of cpu.stat, indexed by the CGROUP_CPU_* slots
+     */
+    unsigned long long stat[CGROUP_CPU_STAT_COUNT];
+    /**
+     * Number of CPUs worth of time the cgroup may use, from the quota and period of cpu.max, or 0 if there is no quota
+     */
+    double limitCpus;
+    /**
+     * Monotonic time the counters were read at, in seconds
+     */
+    double seconds;
+} CgroupCpu;
+
+/**
+ * The cgroup v2 the monitor runs in, with the files read on every sample kept open
+ */
+typedef struct cgroup
+{
+    /**
+     * Path of the cgroup relative to the root of the hierarchy, as listed in /proc/self/cgroup
+     */
+    char name[CGROUP_PATH_LENGTH];
+    /**
+     * Directory of the cgroup
+     */
+    char directory[CGROUP_PATH_LENGTH];
+    /**
+     * Whether the memory controller files are available, which they are not for the root cgroup
+     */
+    bool hasMemory;
+    /**
+     * Whether the CPU controller files are available
+     */
+    bool hasCpu;
+    ProcFile memoryCurrent, memoryMax, memorySwapCurrent, memorySwapMax, memoryStat;
+    ProcFile cpuStat, cpuMax;
+    ProcKeyTable memoryStatKeys, cpuStatKeys;
+} Cgroup;
+
+/**
+ * Find the cgroup v2 the monitor runs in from /proc/self/cgroup and the mount table, and open its memory and CPU files.
+ * A controller whose files are missing is marked as unavailable rather than failing.
+ * @param cgroup The cgroup to initialize
+ * @returns 0 if operation was successful, 1 if no cgroup v2 hierarchy was found
+ */
+extern int openCgroup(Cgroup *cgroup);
+
+/**
+ * Read the memory usage and limits of the cgroup.
+ * @param cgroup A cgroup opened with openCgroup() with hasMemory set
+ * @param memory Where to store the usage
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+extern int readCgroupMemory(Cgroup *cgroup, CgroupMemory *memory);
+
+/**
+ * Read the CPU time and limits of the cgroup.
+ * @param cgroup A cgroup opened with openCgroup() with hasCpu set
+ * @param cpu Where to store the CPU time
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+extern int readCgroupCpu(Cgroup *cgroup, CgroupCpu *cpu);
+
+/**
+ * Calculate the CPU utilization of the cgroup between two reads, relative to the CPU time it is allowed.
+ * @param previous The earlier read
+ * @param current The later read
+ * @param onlineCpus Number of online CPUs, which bounds the cgroup when it has no quota
+ * @returns Percentage CPU utilization, where 100 is the whole quota or every online CPU
+ */
+extern float calculateCgroupCpuUsage(const CgroupCpu *previous, const CgroupCpu *current, int onlineCpus);
+
+/**
+ * Close the files of the cgroup.
+ * @param cgroup A cgroup opened with openCgroup()
+ */
+extern void closeCgroup(Cgroup *cgroup);
+
+#endif
@@ -0,0 +1,369 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdint.h>
+#include <math.h>
+#include <poll.h>
+#include <sys/uio.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+
+#include "spscRing.h"
+#include "sampleTimer.h"
+#include "collectorLink.h"
+
+/**
+ * epoll data of the notifier's eventfd, which cannot be mistaken for the data id of a child process's pidfd
+ */
+#define EVENT_FD_EPOLL_DATA UINT32_MAX
+
+/**
+ * Longest time readFromCollector() sleeps on the ring before checking whether the collector exited, in seconds
+ */
+#define EXIT_CHECK_INTERVAL_SECONDS 0.01
+
+/**
+ * Close a file descriptor if it is open and mark it as closed.
+ * @param fd The file descriptor
+ */
+static void closeDescriptor(int *fd)
+{
+    if (*fd != -1)
+    {
+        close(*fd);
+        *fd = -1;
+    }
+}
+
+/**
+ * Set up a notifier for collectors that run as threads or child processes.
+ * @param notifier The notifier to initialize
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+int initCollectorNotifier(CollectorNotifier *notifier)
+{
+    notifier->eventFd = -1;
+    notifier->signals = NULL;
+    notifier->epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (notifier->epollFd == -1)
+    {
+        perror("epoll_create1");
+        return 1;
+    }
+
+    // the memfd starts zero filled, so no collector is pending and the render loop is not waiting
+    notifier->signals = (CollectorSignals *)mapSharedMemory("collectorSignals", sizeof(CollectorSignals));
+    if (notifier->signals == NULL)
+    {
+        closeCollectorNotifier(notifier);
+        return 1;
+    }
+
+    notifier->eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (notifier->eventFd == -1)
+    {
+        perror("eventfd");
+        closeCollectorNotifier(notifier);
+        return 1;
+    }
+    struct epoll_event event = {.events = EPOLLIN, .data.u32 = EVENT_FD_EPOLL_DATA};
+    if (epoll_ctl(notifier->epollFd, EPOLL_CTL_ADD, notifier->eventFd, &event) == -1)
+    {
+        perror("epoll_ctl");
+        closeCollectorNotifier(notifier);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Set up a link that is not yet connected to a collector.
+ * @param link The link to initialize
+ * @param dataId Data id the collector notifies the render loop with, below 32
+ * @param notifier The notifier shared by every collector
+ * @param threaded Whether the collector runs as a thread
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+int initCollectorLink(CollectorLink *link, int dataId, CollectorNotifier *notifier, bool threaded)
+{
+    link->active = false;
+    link->threaded = threaded;
+    link->dataId = dataId;
+    link->notifier = notifier;
+    link->pendingSample = NO_PENDING_SAMPLE;
+    link->lateSamples = link->missedSamples = 0;
+    atomic_init(&link->exited, false);
+    link->pid = -1;
+    link->pidFd = -1;
+    if (initSpscRing(&link->commands, SPSC_RING_SIZE) != 0)
+    {
+        return 1;
+    }
+    if (initSpscRing(&link->data, SPSC_RING_SIZE) != 0)
+    {
+        freeSpscRing(&link->commands);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Close the descriptors only used by the render loop, in a newly forked child process running the collector.
+ * @param link The link of the collector
+ */
+void closeParentEnds(CollectorLink *link)
+{
+    closeDescriptor(&link->notifier->epollFd);
+}
+
+/**
+ * Have the render loop watch a child process once it has been forked, so that it learns when the child exits.
+ * Threads need no watching.
+ * @param link The link of the collector
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+int watchCollector(CollectorLink *link)
+{
+    if (link->threaded)
+        return 0;
+    link->pidFd = syscall(SYS_pidfd_open, link->pid, 0);
+    if (link->pidFd == -1)
+    {
+        perror("pidfd_open");
+        return 1;
+    }
+    struct epoll_event event = {.events = EPOLLIN, .data.u32 = link->dataId};
+    if (epoll_ctl(link->notifier->epollFd, EPOLL_CTL_ADD, link->pidFd, &event) == -1)
+    {
+        perror("epoll_ctl");
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Read an instruction from the render loop, blocking until it arrives. Called by the collector.
+ * @param link The link of the collector
+ * @param buffer Where to store the instruction
+ * @param size Number of bytes to read
+ * @returns size once the instruction has arrived
+ */
+ssize_t readFromParent(CollectorLink *link, void *buffer, size_t size)
+{
+    readSpscRing(&link->commands, buffer, size, INFINITY);
+    return size;
+}
+
+/**
+ * Send data to the render loop. Called by the collector.
+ * @param link The link of the collector
+ * @param buffer The data to send
+ * @param size Number of bytes to send
+ */
+void writeToParent(CollectorLink *link, const void *buffer, size_t size)
+{
+    writeSpscRing(&link->data, buffer, size);
+}
+
+/**
+ * Send data made of several parts to the render loop. Called by the collector.
+ * @param link The link of the collector
+ * @param parts The parts to send, in order, which are advanced past whatever was written
+ * @param partCount Number of entries in parts
+ */
+void writeVectorToParent(CollectorLink *link, struct iovec *parts, int partCount)
+{
+    for (int i = 0; i < partCount; i++)
+        writeSpscRing(&link->data, parts[i].iov_base, parts[i].iov_len);
+}
+
+/**
+ * Tell the render loop that the data of the current sample is ready to be read. Called by the collector.
+ * @param link The link of the collector
+ */
+void notifyParent(CollectorLink *link)
+{
+    CollectorSignals *signals = link->notifier->signals;
+    atomic_fetch_or(&signals->pendingIds, 1u << link->dataId);
+    // the system call is only made when the render loop went to sleep
+    if (atomic_exchange(&signals->waiting, 0))
+    {
+        uint64_t count = 1;
+        if (write(link->notifier->eventFd, &count, sizeof(count)) == -1 && errno != EAGAIN)
+            perror("write: eventfd");
+    }
+}
+
+/**
+ * Tell the render loop that a collector thread stopped on its own and will send nothing more. Called by the collector
+ * thread as it returns.
+ * @param link The link of the collector
+ */
+void notifyParentOfExit(CollectorLink *link)
+{
+    atomic_store(&link->exited, true);
+    // the render loop then finds the ring empty when it reads, and sees the flag
+    notifyParent(link);
+}
+
+/**
+ * Send an instruction to the collector. Called by the render loop.
+ * @param link The link of the collector
+ * @param buffer The instruction to send
+ * @param size Number of bytes to send
+ */
+void writeToCollector(CollectorLink *link, const void *buffer, size_t size)
+{
+    writeSpscRing(&link->commands, buffer, size);
+}
+
+/**
+ * Check whether the collector has exited, without waiting.
+ * @param link The link of the collector
+ * @returns true if the child process exited or the thread stopped on its own, false if it is running
+ */
+static bool collectorExited(CollectorLink *link)
+{
+    if (link->threaded)
+        return atomic_load(&link->exited);
+    if (link->pidFd == -1)
+        return false;
+    // a pidfd only becomes readable once its process exited
+    struct pollfd exitPoll = {.fd = link->pidFd, .events = POLLIN};
+    return poll(&exitPoll, 1, 0) == 1;
+}
+
+/**
+ * Read data sent by the collector, blocking until all of it arrives, the deadline passes or the collector exits.
+ * Called by the render loop.
+ * @param link The link of the collector
+ * @param buffer Where to store the data
+ * @param size Number of bytes to read
+ * @param deadline Monotonic time in seconds to give up at, or INFINITY to wait for as long as the collector runs
+ * @returns size once the data has arrived, or -1 with errno set to ETIMEDOUT if the deadline passed or ECHILD if the
+ * collector exited first
+ */
+ssize_t readFromCollector(CollectorLink *link, void *buffer, size_t size, double deadline)
+{
+    char *bytes = (char *)buffer;
+    size_t taken = 0;
+    while (true)
+    {
+        // a collector that exits never moves the ring again, so the wait is cut into slices with a check in between
+        double sliceEnd = getMonotonicSeconds() + EXIT_CHECK_INTERVAL_SECONDS;
+        taken += readSpscRing(&link->data, bytes + taken, size - taken, sliceEnd < deadline ? sliceEnd : deadline);
+        if (taken == size)
+            return size;
+        if (collectorExited(link))
+        {
+            errno = ECHILD;
+            return -1;
+        }
+        if (getMonotonicSeconds() >= deadline)
+        {
+            errno = ETIMEDOUT;
+            return -1;
+        }
+    }
+}
+
+/**
+ * Number of whole milliseconds left until the deadline, rounded up so that a wait does not end just short of it.
+ * @param deadline Monotonic time in seconds
+ * @returns The milliseconds left, or 0 if the deadline has passed
+ */
+static int millisecondsUntil(double deadline)
+{
+    double remaining = deadline - getMonotonicSeconds();
+    if (remaining <= 0)
+        return 0;
+    return (int)ceil(remaining * 1000);
+}
+
+/**
+ * Block until a collector has data ready to be read or the deadline passes. Called by the render loop.
+ * @param notifier The notifier shared by every collector
+ * @param deadline Monotonic time to stop waiting at, in seconds
+ * @param dataId Where to store the data id of the collector that is ready or whose child process exited
+ * @returns 1 if a collector is ready, 0 if the deadline passed, or -1 if the wait failed with errno set, which is
+ * ECHILD when a child process exited
+ */
+int waitForCollector(CollectorNotifier *notifier, double deadline, int *dataId)
+{
+    CollectorSignals *signals = notifier->signals;
+    struct epoll_event event;
+    while (true)
+    {
+        uint32_t pending = atomic_load(&signals->pendingIds);
+        if (pending != 0)
+        {
+            // take the lowest ready collector, leaving the others for the following calls
+            *dataId = __builtin_ctz(pending);
+            atomic_fetch_and(&signals->pendingIds, ~(1u << *dataId));
+            return 1;
+        }
+        // announce the sleep before checking one last time, so that a collector either sees it or is seen
+        atomic_store(&signals->waiting, 1);
+        if (atomic_load(&signals->pendingIds) != 0)
+        {
+            atomic_store(&signals->waiting, 0);
+            continue;
+        }
+
+        int timeoutMs = millisecondsUntil(deadline);
+        int ready = timeoutMs > 0 ? epoll_wait(notifier->epollFd, &event, 1, timeoutMs) : 0;
+        atomic_store(&signals->waiting, 0);
+        if (ready == -1 && errno == EINTR)
+            continue;
+        if (ready == -1)
+            return -1;
+        if (ready == 0)
+        {
+            if (atomic_load(&signals->pendingIds) != 0)
+                continue;
+            return 0;
+        }
+        if (event.data.u32 != EVENT_FD_EPOLL_DATA)
+        {
+            // only the pidfds of child processes carry a data id, and they are only ready once the child exited
+            *dataId = event.data.u32;
+            errno = ECHILD;
+            return -1;
+        }
+        uint64_t count;
+        if (read(notifier->eventFd, &count, sizeof(count)) == -1 && errno != EAGAIN)
+            return -1;
+    }
+}
+
+/**
+ * Release the rings of a link whose collector has stopped.
+ * @param link A link set up by initCollectorLink()
+ */
+void closeCollectorLink(CollectorLink *link)
+{
+    closeDescriptor(&link->pidFd);
+    if (link->commands.data != NULL)
+        freeSpscRing(&link->commands);
+    if (link->data.data != NULL)
+        freeSpscRing(&link->data);
+    link->active = false;
+}
+
+/**
+ * Close the epoll instance and eventfd of the notifier, and unmap its shared state.
+ * @param notifier A notifier set up by initCollectorNotifier()
+ */
+void closeCollectorNotifier(CollectorNotifier *notifier)
+{
+    closeDescriptor(&notifier->epollFd);
+    closeDescriptor(&notifier->eventFd);
+    if (notifier->signals != NULL)
+    {
+        unmapSharedMemory(notifier->signals, sizeof(CollectorSignals));
+        notifier->signals = NULL;
+    }
+}
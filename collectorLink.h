@@ -0,0 +1,222 @@
+#ifndef COLLECTOR_LINK_H
+#define COLLECTOR_LINK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <pthread.h>
+
+#include "spscRing.h"
+
+#ifndef FD_WRITE
+#define FD_WRITE 1
+#endif
+
+#ifndef FD_READ
+#define FD_READ 0
+#endif
+
+/**
+ * Instruction that makes a collector take a sample, followed by the index of the sample
+ */
+#define COLLECTOR_START_FLAG 1
+
+/**
+ * Instruction sent to a collector in place of the start flag to make it stop
+ */
+#define COLLECTOR_STOP_FLAG -1
+
+/**
+ * Value of CollectorLink.pendingSample while the collector has sent the record of every sample it was asked for
+ */
+#define NO_PENDING_SAMPLE -1
+
+/**
+ * State of the notifier that collectors change, which lives in shared memory so that child processes change the same state
+ */
+typedef struct collectorSignals
+{
+    /**
+     * Bit (1 << data id) of every collector whose data is ready and not yet taken by waitForCollector()
+     */
+    _Atomic uint32_t pendingIds;
+    /**
+     * Whether the render loop is asleep waiting for pendingIds to change
+     */
+    _Atomic uint32_t waiting;
+} CollectorSignals;
+
+/**
+ * How the render loop waits for the data of the collectors, shared by every collector
+ */
+typedef struct collectorNotifier
+{
+    /**
+     * epoll instance the render loop waits on, watching the eventfd and the pidfd of every child process
+     */
+    int epollFd;
+    /**
+     * eventfd the collectors signal when the render loop is asleep waiting for pendingIds to change
+     */
+    int eventFd;
+    CollectorSignals *signals;
+} CollectorNotifier;
+
+/**
+ * The connection between the render loop and a single collector, which is either a child process or a thread reached
+ * through a pair of lock-free rings in shared memory
+ */
+typedef struct collectorLink
+{
+    /**
+     * Whether the collector was started
+     */
+    bool active;
+    /**
+     * Whether the collector runs as a thread rather than a child process
+     */
+    bool threaded;
+    /**
+     * Data id the collector notifies the render loop with
+     */
+    int dataId;
+    /**
+     * Rings carrying instructions to the collector and data from it
+     */
+    SpscRing commands, data;
+    CollectorNotifier *notifier;
+    /**
+     * Sample the collector was last asked for and has not yet sent the record of, or NO_PENDING_SAMPLE
+     */
+    long pendingSample;
+    /**
+     * Records that arrived after the deadline of their sample, and samples rendered without a record of the collector
+     */
+    unsigned long lateSamples, missedSamples;
+    /**
+     * Set by a collector thread that stopped on its own, since a thread has no pidfd to watch
+     */
+    _Atomic bool exited;
+    pid_t pid;
+    /**
+     * pidfd of the child process, which the render loop watches to learn that the child exited, or -1
+     */
+    int pidFd;
+    pthread_t thread;
+} CollectorLink;
+
+/**
+ * Set up a notifier for collectors that run as threads or child processes.
+ * @param notifier The notifier to initialize
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+extern int initCollectorNotifier(CollectorNotifier *notifier);
+
+/**
+ * Set up a link that is not yet connected to a collector.
+ * @param link The link to initialize
+ * @param dataId Data id the collector notifies the render loop with, below 32
+ * @param notifier The notifier shared by every collector
+ * @param threaded Whether the collector runs as a thread
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+extern int initCollectorLink(CollectorLink *link, int dataId, CollectorNotifier *notifier, bool threaded);
+
+/**
+ * Close the descriptors only used by the render loop, in a newly forked child process running the collector.
+ * @param link The link of the collector
+ */
+extern void closeParentEnds(CollectorLink *link);
+
+/**
+ * Have the render loop watch a child process once it has been forked, so that it learns when the child exits.
+ * Threads need no watching.
+ * @param link The link of the collector
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+extern int watchCollector(CollectorLink *link);
+
+/**
+ * Read an instruction from the render loop, blocking until it arrives. Called by the collector.
+ * @param link The link of the collector
+ * @param buffer Where to store the instruction
+ * @param size Number of bytes to read
+ * @returns size once the instruction has arrived
+ */
+extern ssize_t readFromParent(CollectorLink *link, void *buffer, size_t size);
+
+/**
+ * Send data to the render loop. Called by the collector.
+ * @param link The link of the collector
+ * @param buffer The data to send
+ * @param size Number of bytes to send
+ */
+extern void writeToParent(CollectorLink *link, const void *buffer, size_t size);
+
+/**
+ * Send data made of several parts to the render loop. Called by the collector.
+ * @param link The link of the collector
+ * @param parts The parts to send, in order, which are advanced past whatever was written
+ * @param partCount Number of entries in parts
+ */
+extern void writeVectorToParent(CollectorLink *link, struct iovec *parts, int partCount);
+
+/**
+ * Tell the render loop that the data of the current sample is ready to be read. Called by the collector.
+ * @param link The link of the collector
+ */
+extern void notifyParent(CollectorLink *link);
+
+/**
+ * Tell the render loop that a collector thread stopped on its own and will send nothing more. Called by the collector
+ * thread as it returns.
+ * @param link The link of the collector
+ */
+extern void notifyParentOfExit(CollectorLink *link);
+
+/**
+ * Send an instruction to the collector. Called by the render loop.
+ * @param link The link of the collector
+ * @param buffer The instruction to send
+ * @param size Number of bytes to send
+ */
+extern void writeToCollector(CollectorLink *link, const void *buffer, size_t size);
+
+/**
+ * Read data sent by the collector, blocking until all of it arrives, the deadline passes or the collector exits.
+ * Called by the render loop.
+ * @param link The link of the collector
+ * @param buffer Where to store the data
+ * @param size Number of bytes to read
+ * @param deadline Monotonic time in seconds to give up at, or INFINITY to wait for as long as the collector runs
+ * @returns size once the data has arrived, or -1 with errno set to ETIMEDOUT if the deadline passed or ECHILD if the
+ * collector exited first
+ */
+extern ssize_t readFromCollector(CollectorLink *link, void *buffer, size_t size, double deadline);
+
+/**
+ * Block until a collector has data ready to be read or the deadline passes. Called by the render loop.
+ * @param notifier The notifier shared by every collector
+ * @param deadline Monotonic time to stop waiting at, in seconds
+ * @param dataId Where to store the data id of the collector that is ready or whose child process exited
+ * @returns 1 if a collector is ready, 0 if the deadline passed, or -1 if the wait failed with errno set, which is
+ * ECHILD when a child process exited
+ */
+extern int waitForCollector(CollectorNotifier *notifier, double deadline, int *dataId);
+
+/**
+ * Release the rings of a link whose collector has stopped.
+ * @param link A link set up by initCollectorLink()
+ */
+extern void closeCollectorLink(CollectorLink *link);
+
+/**
+ * Close the epoll instance and eventfd of the notifier, and unmap its shared state.
+ * @param notifier A notifier set up by initCollectorNotifier()
+ */
+extern void closeCollectorNotifier(CollectorNotifier *notifier);
+
+#endif
@@ -0,0 +1,122 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <sys/uio.h>
+
+#include "parseArguments.h"
+#include "collectorLink.h"
+#include "sampleRecord.h"
+#include "sampleTimer.h"
+#include "sampleRenderer.h"
+#include "parseMemoryStats.h"
+#include "parseCpuStats.h"
+#include "parseProcessStats.h"
+#include "printUsers.h"
+#include "psiStats.h"
+#include "collectorRegistry.h"
+
+/**
+ * Whether the system sections, and so the memory and CPU collectors, are shown.
+ * @param options The settings given by command line arguments
+ * @returns true if they are shown, false otherwise
+ */
+static bool showsSystem(const MonitorOptions *options)
+{
+    return options->showSystem || !options->showUser;
+}
+
+/**
+ * Whether the sessions and users section, and so the user collector, is shown.
+ * @param options The settings given by command line arguments
+ * @returns true if it is shown, false otherwise
+ */
+static bool showsUsers(const MonitorOptions *options)
+{
+    return options->showUser || !options->showSystem;
+}
+
+/**
+ * Whether the top processes section, and so its collector, is shown.
+ * @param options The settings given by command line arguments
+ * @returns true if it is shown, false otherwise
+ */
+static bool showsProcesses(const MonitorOptions *options)
+{
+    return options->topProcesses > 0 && showsSystem(options);
+}
+
+/**
+ * Whether the pressure section, and so its collector, is shown.
+ * @param options The settings given by command line arguments
+ * @returns true if it is shown, false otherwise
+ */
+static bool showsPressure(const MonitorOptions *options)
+{
+    return options->showPressure && showsSystem(options);
+}
+
+/**
+ * Every collector, indexed by MEMORY_COLLECTOR through PRESSURE_COLLECTOR
+ */
+const CollectorDefinition collectorRegistry[COLLECTOR_COUNT] = {
+    [MEMORY_COLLECTOR] = {"memory", RECORD_TYPE_MEMORY, showsSystem, initMemoryCollector, sampleMemoryCollector,
+                          encodeMemoryCollector, teardownMemoryCollector, renderMemoryRecord},
+    [USER_COLLECTOR] = {"user", RECORD_TYPE_USERS, showsUsers, initUserCollector, sampleUserCollector,
+                        encodeUserCollector, teardownUserCollector, renderUsersRecord},
+    [CPU_COLLECTOR] = {"CPU", RECORD_TYPE_CPU, showsSystem, initCpuCollector, sampleCpuCollector,
+                       encodeCpuCollector, teardownCpuCollector, renderCpuRecord},
+    [PROCESS_COLLECTOR] = {"processes", RECORD_TYPE_PROCESSES, showsProcesses, initProcessCollector, sampleProcessCollector,
+                           encodeProcessCollector, teardownProcessCollector, renderProcessesRecord},
+    [PRESSURE_COLLECTOR] = {"pressure", RECORD_TYPE_PRESSURE, showsPressure, initPressureCollector, samplePressureCollector,
+                            encodePressureCollector, teardownPressureCollector, renderPressureRecord}};
+
+/**
+ * Run a collector until the render loop tells it to stop: take a sample on every start instruction and send its record.
+ * Returns early if the collector cannot be set up or fails to take a sample, leaving it to the caller to tell the
+ * render loop that the collector is gone.
+ * @param definition The collector to run
+ * @param options The settings given by command line arguments
+ * @param link Connection used to read instructions from the render loop and send records back to it
+ * @returns 0 if the render loop stopped the collector, 1 if the collector failed
+ */
+int runCollector(const CollectorDefinition *definition, const MonitorOptions *options, CollectorLink *link)
+{
+    void *state = definition->init(options);
+    if (state == NULL)
+    {
+        return 1;
+    }
+
+    struct iovec parts[RECORD_MAX_PARTS];
+    int parentInfo;
+    long thisSample;
+    while (true)
+    {
+        // get an instruction from the parent
+        readFromParent(link, &parentInfo, sizeof(int));
+        if (parentInfo != COLLECTOR_START_FLAG)
+        {
+            break;
+        }
+
+        // get the iteration number
+        readFromParent(link, &thisSample, sizeof(long));
+        double collectStart = getMonotonicSeconds();
+        if (definition->sample(state, thisSample) != 0)
+        {
+            definition->teardown(state);
+            return 1;
+        }
+        double collectSeconds = getMonotonicSeconds() - collectStart;
+        // the first sample only sets the baseline, so no record of it is sent
+        if (thisSample == 0)
+        {
+            continue;
+        }
+
+        double timestamp;
+        int partCount = definition->encode(state, parts, &timestamp);
+        sendRecord(link, definition->recordType, thisSample, timestamp, collectSeconds, parts, partCount);
+    }
+    definition->teardown(state);
+    return 0;
+}
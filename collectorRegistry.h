@@ -0,0 +1,83 @@
+#ifndef COLLECTOR_REGISTRY_H
+#define COLLECTOR_REGISTRY_H
+
+#include <stdbool.h>
+#include <sys/uio.h>
+
+#include "arena.h"
+#include "parseArguments.h"
+#include "collectorLink.h"
+#include "sampleRecord.h"
+#include "sampleRenderer.h"
+
+/**
+ * Indices of the collectors in collectorRegistry, which are also the data ids they notify the render loop with
+ */
+#define MEMORY_COLLECTOR 0
+#define USER_COLLECTOR 1
+#define CPU_COLLECTOR 2
+#define PROCESS_COLLECTOR 3
+#define PRESSURE_COLLECTOR 4
+
+/**
+ * Number of collectors in collectorRegistry, and so the number of links to keep track of
+ */
+#define COLLECTOR_COUNT 5
+
+/**
+ * What the render loop and the generic collector loop need to know about a collector.
+ * The collector side keeps its state behind an opaque pointer, so it can run in a child process or a thread alike.
+ */
+typedef struct collectorDefinition
+{
+    /**
+     * Name of the collector used in error messages and notices
+     */
+    const char *name;
+    /**
+     * The RECORD_TYPE_* type of the records the collector sends
+     */
+    int recordType;
+    /**
+     * Whether the collector runs with the given settings
+     */
+    bool (*isEnabled)(const MonitorOptions *options);
+    /**
+     * Open what the collector reads, returning its state or NULL if it could not be set up
+     */
+    void *(*init)(const MonitorOptions *options);
+    /**
+     * Take a sample, of which sample 0 only sets the baseline of the rates, returning 0 if successful
+     */
+    int (*sample)(void *state, long thisSample);
+    /**
+     * Describe the latest sample as parts of a record, leaving parts[0] for the header, returning the number of parts
+     */
+    int (*encode)(void *state, struct iovec *parts, double *timestamp);
+    /**
+     * Close what the collector reads and release its state
+     */
+    void (*teardown)(void *state);
+    /**
+     * Render a record of the collector in the render loop, returning 0 if successful
+     */
+    int (*render)(SampleRenderer *renderer, const RecordHeader *header, const void *payload, RenderedSample *rendered, Arena *arena);
+} CollectorDefinition;
+
+/**
+ * Every collector, indexed by MEMORY_COLLECTOR through PRESSURE_COLLECTOR
+ */
+extern const CollectorDefinition collectorRegistry[COLLECTOR_COUNT];
+
+/**
+ * Run a collector until the render loop tells it to stop: take a sample on every start instruction and send its record.
+ * Returns early if the collector cannot be set up or fails to take a sample, leaving it to the caller to tell the
+ * render loop that the collector is gone.
+ * @param definition The collector to run
+ * @param options The settings given by command line arguments
+ * @param link Connection used to read instructions from the render loop and send records back to it
+ * @returns 0 if the render loop stopped the collector, 1 if the collector failed
+ */
+extern int runCollector(const CollectorDefinition *definition, const MonitorOptions *options, CollectorLink *link);
+
+#endif
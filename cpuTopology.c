@@ -0,0 +1,195 @@
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <inttypes.h>
+
+#include "heapCounter.h"
+#include "procFile.h"
+#include "cpuTopology.h"
+
+/**
+ * Parse a CPU list in the kernel's list format (e.g. "0-3,8,10-11") into individual CPU ids.
+ * @param list The null terminated list to parse. Parsing stops at the first newline.
+ * @param cpus Array where the parsed ids are stored in the order they appear, or NULL to only count them
+ * @param capacity Number of ids cpus has room for. Ids beyond capacity are counted but not stored.
+ * @returns The number of CPU ids in the list
+ */
+int parseCpuList(const char *list, int *cpus, int capacity)
+{
+    int count = 0;
+    const char *cursor = list;
+    while (*cursor >= '0' && *cursor <= '9')
+    {
+        int first = scanUnsigned(&cursor);
+        int last = first;
+        if (*cursor == '-')
+        {
+            cursor++;
+            last = scanUnsigned(&cursor);
+        }
+        for (int cpu = first; cpu <= last; cpu++)
+        {
+            if (cpus != NULL && count < capacity)
+                cpus[count] = cpu;
+            count++;
+        }
+        if (*cursor != ',')
+            break;
+        cursor++;
+    }
+    return count;
+}
+
+/**
+ * Read a single integer from a small sysfs attribute file.
+ * @param path Path of the file to read
+ * @param value Pointer to where the value will be stored
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+int readSysfsValue(const char *path, long *value)
+{
+    char contents[64];
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        return 1;
+    ssize_t bytesRead = read(fd, contents, sizeof(contents) - 1);
+    close(fd);
+    if (bytesRead <= 0)
+        return 1;
+    contents[bytesRead] = '\0';
+    *value = strtol(contents, NULL, 10);
+    return 0;
+}
+
+/**
+ * Compare two 64-bit keys for use with qsort()
+ */
+int compareTopologyKeys(const void *a, const void *b)
+{
+    uint64_t first = *(const uint64_t *)a, second = *(const uint64_t *)b;
+    return (first > second) - (first < second);
+}
+
+/**
+ * Build the topology from the online CPU mask currently held in topology->onlineFile.
+ * Each online CPU's package and core ids are read from sysfs and the unique packages and cores are counted.
+ * @param topology The topology to rebuild
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+int buildCpuTopology(CpuTopology *topology)
+{
+    const char *mask = topology->onlineFile.buffer;
+    int onlineCount = parseCpuList(mask, NULL, 0);
+    if (onlineCount > topology->capacity)
+    {
+        noteHeapAllocation();
+        int *larger = (int *)realloc(topology->onlineCpus, sizeof(int) * onlineCount);
+        if (larger == NULL)
+        {
+            perror("realloc");
+            return 1;
+        }
+        topology->onlineCpus = larger;
+        topology->capacity = onlineCount;
+    }
+    topology->onlineCount = parseCpuList(mask, topology->onlineCpus, topology->capacity);
+
+    // identify each core by its package id in the upper half and core id in the lower half, so sorting groups cores by package
+    noteHeapAllocation();
+    uint64_t *keys = (uint64_t *)malloc(sizeof(uint64_t) * (onlineCount > 0 ? onlineCount : 1));
+    if (keys == NULL)
+    {
+        perror("malloc");
+        return 1;
+    }
+    char path[SYSFS_PATH_LENGTH];
+    for (int i = 0; i < onlineCount; i++)
+    {
+        long packageId = 0, coreId = topology->onlineCpus[i];
+        // without topology information, treat every CPU as its own core in a single package
+        snprintf(path, SYSFS_PATH_LENGTH, SYSFS_CPU_DIRECTORY "/cpu%d/topology/physical_package_id", topology->onlineCpus[i]);
+        readSysfsValue(path, &packageId);
+        snprintf(path, SYSFS_PATH_LENGTH, SYSFS_CPU_DIRECTORY "/cpu%d/topology/core_id", topology->onlineCpus[i]);
+        readSysfsValue(path, &coreId);
+        keys[i] = ((uint64_t)(uint32_t)packageId << 32) | (uint32_t)coreId;
+    }
+    qsort(keys, onlineCount, sizeof(uint64_t), compareTopologyKeys);
+
+    topology->packageCount = 0;
+    topology->coreCount = 0;
+    for (int i = 0; i < onlineCount; i++)
+    {
+        if (i == 0 || keys[i] != keys[i - 1])
+            topology->coreCount++;
+        if (i == 0 || keys[i] >> 32 != keys[i - 1] >> 32)
+            topology->packageCount++;
+    }
+    free(keys);
+
+    strncpy(topology->onlineMask, mask, CPU_ONLINE_BUFFER_SIZE - 1);
+    topology->onlineMask[CPU_ONLINE_BUFFER_SIZE - 1] = '\0';
+    return 0;
+}
+
+/**
+ * Build the CPU topology from sysfs for the first time.
+ * @param topology The topology to initialize
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+int initCpuTopology(CpuTopology *topology)
+{
+    topology->packageCount = 0;
+    topology->coreCount = 0;
+    topology->onlineCount = 0;
+    topology->onlineCpus = NULL;
+    topology->capacity = 0;
+    topology->onlineMask[0] = '\0';
+    if (openProcFile(&topology->onlineFile, SYSFS_CPU_DIRECTORY "/online", CPU_ONLINE_BUFFER_SIZE) != 0)
+    {
+        return 1;
+    }
+    if (readProcFile(&topology->onlineFile) != 0)
+    {
+        return 1;
+    }
+    return buildCpuTopology(topology);
+}
+
+/**
+ * Re-read the online CPU mask and rebuild the topology only if the set of online CPUs has changed since it was last built.
+ * @param topology A topology set up by initCpuTopology()
+ * @param changed If not NULL, set to whether the topology was rebuilt
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+int refreshCpuTopology(CpuTopology *topology, bool *changed)
+{
+    if (changed != NULL)
+        *changed = false;
+    if (readProcFile(&topology->onlineFile) != 0)
+    {
+        return 1;
+    }
+    if (strcmp(topology->onlineFile.buffer, topology->onlineMask) == 0)
+    {
+        return 0;
+    }
+    if (changed != NULL)
+        *changed = true;
+    return buildCpuTopology(topology);
+}
+
+/**
+ * Release the resources held by a CPU topology.
+ * @param topology A topology set up by initCpuTopology()
+ */
+void freeCpuTopology(CpuTopology *topology)
+{
+    closeProcFile(&topology->onlineFile);
+    free(topology->onlineCpus);
+    topology->onlineCpus = NULL;
+    topology->capacity = 0;
+    topology->onlineCount = 0;
+}
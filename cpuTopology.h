@@ -0,0 +1,88 @@
+#ifndef CPU_TOPOLOGY_H
+#define CPU_TOPOLOGY_H
+
+#include <stdbool.h>
+
+#include "procFile.h"
+
+/**
+ * Directory containing the cpuN entries describing each logical CPU
+ */
+#define SYSFS_CPU_DIRECTORY "/sys/devices/system/cpu"
+
+/**
+ * Size of the buffer that the online CPU mask is read into
+ */
+#define CPU_ONLINE_BUFFER_SIZE 4096
+
+/**
+ * Max length of a path to a file within SYSFS_CPU_DIRECTORY
+ */
+#define SYSFS_PATH_LENGTH 256
+
+/**
+ * Cached layout of the CPUs on the machine, built from sysfs and only rebuilt when the set of online CPUs changes.
+ */
+typedef struct cpuTopology
+{
+    /**
+     * Number of unique physical packages (sockets) with an online CPU
+     */
+    int packageCount;
+    /**
+     * Number of unique physical cores with an online CPU, where SMT siblings share a core
+     */
+    int coreCount;
+    /**
+     * Number of online logical CPUs, counting each SMT sibling separately
+     */
+    int onlineCount;
+    /**
+     * Ids of the online logical CPUs in increasing order, with onlineCount entries
+     */
+    int *onlineCpus;
+    /**
+     * Number of entries onlineCpus has room for
+     */
+    int capacity;
+    /**
+     * The online CPU mask file, kept open and re-read to detect hotplug
+     */
+    ProcFile onlineFile;
+    /**
+     * Contents of the online CPU mask when the topology was last built
+     */
+    char onlineMask[CPU_ONLINE_BUFFER_SIZE];
+} CpuTopology;
+
+/**
+ * Build the CPU topology from sysfs for the first time.
+ * @param topology The topology to initialize
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+extern int initCpuTopology(CpuTopology *topology);
+
+/**
+ * Re-read the online CPU mask and rebuild the topology only if the set of online CPUs has changed since it was last built.
+ * @param topology A topology set up by initCpuTopology()
+ * @param changed If not NULL, set to whether the topology was rebuilt
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+extern int refreshCpuTopology(CpuTopology *topology, bool *changed);
+
+/**
+ * Release the resources held by a CPU topology.
+ * @param topology A topology set up by initCpuTopology()
+ */
+extern void freeCpuTopology(CpuTopology *topology);
+
+/**
+ * Parse a CPU list in the kernel's list format (e.g. "0-3,8,10-11") into individual CPU ids.
+ * @param list The null terminated list to parse. Parsing stops at the first newline.
+ * @param cpus Array where the parsed ids are stored in the order they appear, or NULL to only count them
+ * @param capacity Number of ids cpus has room for. Ids beyond capacity are counted but not stored.
+ * @returns The number of CPU ids in the list
+ */
+extern int parseCpuList(const char *list, int *cpus, int capacity);
+
+#endif
@@ -0,0 +1,27 @@
+#include <stdint.h>
+
+#include "heapCounter.h"
+
+/**
+ * Heap allocations noted by the thread
+ */
+static _Thread_local uint64_t heapAllocations;
+
+/**
+ * Count a heap allocation made by the calling thread. Called next to every malloc(), calloc(), realloc() and
+ * aligned_alloc() of the monitor that may run while samples are taken, such as an arena or table growing.
+ */
+void noteHeapAllocation(void)
+{
+    heapAllocations++;
+}
+
+/**
+ * Count the heap allocations noted by the calling thread since it started. Allocations made inside the C library and
+ * those made once at startup are not noted. A child process starts from the count of the thread that forked it.
+ * @returns The number of allocations
+ */
+uint64_t countHeapAllocations(void)
+{
+    return heapAllocations;
+}
@@ -0,0 +1,19 @@
+#ifndef HEAP_COUNTER_H
+#define HEAP_COUNTER_H
+
+#include <stdint.h>
+
+/**
+ * Count a heap allocation made by the calling thread. Called next to every malloc(), calloc(), realloc() and
+ * aligned_alloc() of the monitor that may run while samples are taken, such as an arena or table growing.
+ */
+extern void noteHeapAllocation(void);
+
+/**
+ * Count the heap allocations noted by the calling thread since it started. Allocations made inside the C library and
+ * those made once at startup are not noted. A child process starts from the count of the thread that forked it.
+ * @returns The number of allocations
+ */
+extern uint64_t countHeapAllocations(void);
+
+#endif
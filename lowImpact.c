@@ -0,0 +1,122 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
+
+#include "cpuTopology.h"
+#include "heapCounter.h"
+#include "sampleTimer.h"
+#include "parseArguments.h"
+#include "lowImpact.h"
+
+/**
+ * Pin the calling thread, and the processes and threads it later creates, to a list of CPUs.
+ * @param list CPU list in the kernel's list format (e.g. "0-1,4")
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+static int pinToCpus(const char *list)
+{
+    int count = parseCpuList(list, NULL, 0);
+    if (count == 0)
+    {
+        fprintf(stderr, "Invalid housekeeping CPU list: %s\n", list);
+        return 1;
+    }
+    int *cpus = (int *)malloc(sizeof(int) * count);
+    if (cpus == NULL)
+    {
+        perror("malloc");
+        return 1;
+    }
+    parseCpuList(list, cpus, count);
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int i = 0; i < count; i++)
+    {
+        if (cpus[i] >= CPU_SETSIZE)
+        {
+            fprintf(stderr, "Housekeeping CPU %d is out of range\n", cpus[i]);
+            free(cpus);
+            return 1;
+        }
+        CPU_SET(cpus[i], &set);
+    }
+    free(cpus);
+    if (sched_setaffinity(0, sizeof(set), &set) == -1)
+    {
+        perror("sched_setaffinity");
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Keep the monitor out of the way of the workload it observes: pin it to the housekeeping CPUs, run it under
+ * SCHED_IDLE (or the lowest priority if that is not permitted), and give its timers slack so its wakeups can be
+ * coalesced with others. Called before the collectors start, since child processes and threads inherit all three.
+ * Does nothing unless --low-impact was given.
+ * @param options The settings given by command line arguments
+ * @param state Where to store how the mode was applied
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+int applyLowImpactMode(const MonitorOptions *options, LowImpactState *state)
+{
+    memset(state, 0, sizeof(LowImpactState));
+    if (options->lowImpactCpus == NULL)
+    {
+        return 0;
+    }
+    state->active = true;
+
+    if (pinToCpus(options->lowImpactCpus) != 0)
+    {
+        return 1;
+    }
+
+    struct sched_param param = {.sched_priority = 0};
+    if (sched_setscheduler(0, SCHED_IDLE, &param) == 0)
+    {
+        state->schedIdle = true;
+    }
+    else if (setpriority(PRIO_PROCESS, 0, LOW_IMPACT_NICE) == -1)
+    {
+        perror("setpriority");
+        return 1;
+    }
+
+    // wakeups from waits with a timeout may be deferred by up to the slack, so the kernel can serve several at once
+    long slackMs = options->sampleDelayMs * LOW_IMPACT_TIMER_SLACK_PERCENT / 100;
+    if (slackMs > LOW_IMPACT_MAX_TIMER_SLACK_MS)
+        slackMs = LOW_IMPACT_MAX_TIMER_SLACK_MS;
+    state->timerSlackNs = slackMs > 0 ? slackMs * NANOSECONDS_PER_MILLISECOND : NANOSECONDS_PER_MILLISECOND / 10;
+    if (prctl(PR_SET_TIMERSLACK, state->timerSlackNs, 0, 0, 0) == -1)
+    {
+        perror("prctl: PR_SET_TIMERSLACK");
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Read the CPU time, context switches and heap allocations of the calling thread.
+ * @param usage Where to store the usage
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+int getThreadUsage(ThreadUsage *usage)
+{
+    struct rusage rusage;
+    if (getrusage(RUSAGE_THREAD, &rusage) == -1)
+    {
+        return 1;
+    }
+    usage->cpuSeconds = rusage.ru_utime.tv_sec + rusage.ru_utime.tv_usec / 1e6 +
+                        rusage.ru_stime.tv_sec + rusage.ru_stime.tv_usec / 1e6;
+    usage->contextSwitches = rusage.ru_nvcsw + rusage.ru_nivcsw;
+    usage->heapAllocations = countHeapAllocations();
+    return 0;
+}
@@ -0,0 +1,77 @@
+#ifndef LOW_IMPACT_H
+#define LOW_IMPACT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "parseArguments.h"
+
+/**
+ * Nice value the monitor runs at in low impact mode when SCHED_IDLE is not permitted
+ */
+#define LOW_IMPACT_NICE 19
+
+/**
+ * Timer slack given to the monitor in low impact mode, in percent of the sample delay
+ */
+#define LOW_IMPACT_TIMER_SLACK_PERCENT 1
+
+/**
+ * Largest timer slack given to the monitor in low impact mode, in milliseconds
+ */
+#define LOW_IMPACT_MAX_TIMER_SLACK_MS 50
+
+/**
+ * CPU time and context switches of a single thread since it started
+ */
+typedef struct threadUsage
+{
+    /**
+     * User and system CPU time, in seconds
+     */
+    double cpuSeconds;
+    /**
+     * Voluntary and involuntary context switches
+     */
+    uint64_t contextSwitches;
+    /**
+     * Heap allocations noted by the thread, as counted by countHeapAllocations()
+     */
+    uint64_t heapAllocations;
+} ThreadUsage;
+
+/**
+ * How low impact mode was applied, for display
+ */
+typedef struct lowImpactState
+{
+    bool active;
+    /**
+     * Whether the monitor runs under SCHED_IDLE, or otherwise at LOW_IMPACT_NICE
+     */
+    bool schedIdle;
+    /**
+     * Timer slack given to the monitor, in nanoseconds
+     */
+    unsigned long timerSlackNs;
+} LowImpactState;
+
+/**
+ * Keep the monitor out of the way of the workload it observes: pin it to the housekeeping CPUs, run it under
+ * SCHED_IDLE (or the lowest priority if that is not permitted), and give its timers slack so its wakeups can be
+ * coalesced with others. Called before the collectors start, since child processes and threads inherit all three.
+ * Does nothing unless --low-impact was given.
+ * @param options The settings given by command line arguments
+ * @param state Where to store how the mode was applied
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+extern int applyLowImpactMode(const MonitorOptions *options, LowImpactState *state);
+
+/**
+ * Read the CPU time, context switches and heap allocations of the calling thread.
+ * @param usage Where to store the usage
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+extern int getThreadUsage(ThreadUsage *usage);
+
+#endif
@@ -0,0 +1,279 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "procFile.h"
+#include "cpuTopology.h"
+#include "sampleTimer.h"
+#include "numaStats.h"
+
+/**
+ * Keys of a node's meminfo read on every sample, in the order of the NUMA_MEM_* slots
+ */
+static const char *const numaMeminfoKeys[NUMA_MEMINFO_KEY_COUNT] = {"MemTotal", "MemFree", "MemUsed", "FilePages"};
+
+/**
+ * Keys of a node's numastat read on every sample, in the order of NUMA_HIT, NUMA_MISS and NUMA_FOREIGN
+ */
+static const char *const numaNumastatKeys[NUMA_NUMASTAT_KEY_COUNT] = {"numa_hit", "numa_miss", "numa_foreign"};
+
+/**
+ * Read a CPU or node list file from sysfs and parse it into a newly allocated array of ids.
+ * @param path Path of the list file
+ * @param ids Where to store the allocated array, which is NULL if the list is empty
+ * @param count Where to store the number of ids in the list
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+static int readSysfsList(const char *path, int **ids, int *count)
+{
+    ProcFile file;
+    if (openProcFile(&file, path, CPU_ONLINE_BUFFER_SIZE) != 0)
+    {
+        return 1;
+    }
+    if (readProcFile(&file) != 0)
+    {
+        closeProcFile(&file);
+        return 1;
+    }
+    *count = parseCpuList(file.buffer, NULL, 0);
+    *ids = NULL;
+    if (*count > 0)
+    {
+        *ids = (int *)malloc(sizeof(int) * *count);
+        if (*ids == NULL)
+        {
+            perror("malloc");
+            closeProcFile(&file);
+            return 1;
+        }
+        parseCpuList(file.buffer, *ids, *count);
+    }
+    closeProcFile(&file);
+    return 0;
+}
+
+/**
+ * Open the meminfo and numastat of a node.
+ * @param node The node to open the files of, with its id set
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+static int openNumaNodeFiles(NumaNode *node)
+{
+    char path[SYSFS_PATH_LENGTH];
+    snprintf(path, SYSFS_PATH_LENGTH, SYSFS_NODE_DIRECTORY "/node%d/meminfo", node->id);
+    if (openProcFile(&node->meminfo, path, NUMA_MEMINFO_BUFFER_SIZE) != 0)
+    {
+        return 1;
+    }
+    snprintf(path, SYSFS_PATH_LENGTH, SYSFS_NODE_DIRECTORY "/node%d/numastat", node->id);
+    if (openProcFile(&node->numastat, path, NUMA_NUMASTAT_BUFFER_SIZE) != 0)
+    {
+        closeProcFile(&node->meminfo);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Find the online NUMA nodes and the CPUs of each one from sysfs.
+ * @param topology The topology to initialize
+ * @param openMemory Whether to open the meminfo and numastat of each node for readNumaMemory()
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+int initNumaTopology(NumaTopology *topology, bool openMemory)
+{
+    memset(topology, 0, sizeof(NumaTopology));
+    initProcKeyTable(&topology->meminfoKeys, numaMeminfoKeys, NUMA_MEMINFO_KEY_COUNT);
+    initProcKeyTable(&topology->numastatKeys, numaNumastatKeys, NUMA_NUMASTAT_KEY_COUNT);
+
+    // kernels built without NUMA support have no node directory at all
+    int *nodeIds;
+    if (readSysfsList(SYSFS_NODE_DIRECTORY "/online", &nodeIds, &topology->nodeCount) != 0 || topology->nodeCount == 0)
+    {
+        fprintf(stderr, "NUMA node information is not available on this system\n");
+        return 1;
+    }
+    topology->nodes = (NumaNode *)calloc(topology->nodeCount, sizeof(NumaNode));
+    if (topology->nodes == NULL)
+    {
+        perror("calloc");
+        free(nodeIds);
+        return 1;
+    }
+    for (int i = 0; i < topology->nodeCount; i++)
+    {
+        topology->nodes[i].meminfo.fd = -1;
+        topology->nodes[i].numastat.fd = -1;
+    }
+
+    // the CPUs of every node are kept only long enough to build the lookup from CPU to node
+    int **nodeCpus = (int **)calloc(topology->nodeCount, sizeof(int *));
+    if (nodeCpus == NULL)
+    {
+        perror("calloc");
+        free(nodeIds);
+        freeNumaTopology(topology);
+        return 1;
+    }
+    int result = 0;
+    char path[SYSFS_PATH_LENGTH];
+    for (int i = 0; i < topology->nodeCount && result == 0; i++)
+    {
+        NumaNode *node = topology->nodes + i;
+        node->id = nodeIds[i];
+        snprintf(path, SYSFS_PATH_LENGTH, SYSFS_NODE_DIRECTORY "/node%d/cpulist", node->id);
+        result = readSysfsList(path, nodeCpus + i, &node->cpuCount);
+        for (int j = 0; j < node->cpuCount && result == 0; j++)
+        {
+            if (nodeCpus[i][j] >= topology->cpuNodeCapacity)
+                topology->cpuNodeCapacity = nodeCpus[i][j] + 1;
+        }
+        if (result == 0 && openMemory)
+            result = openNumaNodeFiles(node);
+    }
+
+    if (result == 0 && topology->cpuNodeCapacity > 0)
+    {
+        topology->cpuNodes = (int *)malloc(sizeof(int) * topology->cpuNodeCapacity);
+        if (topology->cpuNodes == NULL)
+        {
+            perror("malloc");
+            result = 1;
+        }
+        else
+        {
+            for (int cpu = 0; cpu < topology->cpuNodeCapacity; cpu++)
+                topology->cpuNodes[cpu] = -1;
+            for (int i = 0; i < topology->nodeCount; i++)
+            {
+                for (int j = 0; j < topology->nodes[i].cpuCount; j++)
+                    topology->cpuNodes[nodeCpus[i][j]] = i;
+            }
+        }
+    }
+
+    for (int i = 0; i < topology->nodeCount; i++)
+    {
+        free(nodeCpus[i]);
+    }
+    free(nodeCpus);
+    free(nodeIds);
+    if (result != 0)
+    {
+        fprintf(stderr, "Encountered error reading the NUMA nodes from " SYSFS_NODE_DIRECTORY "\n");
+        freeNumaTopology(topology);
+    }
+    return result;
+}
+
+/**
+ * Read the meminfo and numastat of every node, keeping the previous read for calculating rates.
+ * @param topology A topology set up by initNumaTopology() with openMemory set
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+int readNumaMemory(NumaTopology *topology)
+{
+    for (int i = 0; i < topology->nodeCount; i++)
+    {
+        NumaNode *node = topology->nodes + i;
+        if (readProcFile(&node->meminfo) != 0 || readProcFile(&node->numastat) != 0)
+        {
+            return 1;
+        }
+        node->previous = node->current;
+        node->current.seconds = getMonotonicSeconds();
+        // every line of a node's meminfo starts with "Node N", while its numastat has no prefix
+        parseKeyedValues(&topology->meminfoKeys, node->meminfo.buffer, 2, node->current.meminfo, NUMA_MEMINFO_KEY_COUNT);
+        parseKeyedValues(&topology->numastatKeys, node->numastat.buffer, 0, node->current.numastat, NUMA_NUMASTAT_KEY_COUNT);
+    }
+    return 0;
+}
+
+/**
+ * Calculate the per second rate of a numastat counter between the two latest reads of a node.
+ * @param node A node read by readNumaMemory() at least twice
+ * @param slot The counter, one of NUMA_HIT, NUMA_MISS and NUMA_FOREIGN
+ * @returns The rate in pages per second, or 0 if the counter went backwards
+ */
+static double calculateNumaRate(const NumaNode *node, int slot)
+{
+    double seconds = node->current.seconds - node->previous.seconds;
+    unsigned long long before = node->previous.numastat[slot], after = node->current.numastat[slot];
+    if (seconds <= 0 || after < before)
+        return 0.0;
+    return (after - before) / seconds;
+}
+
+/**
+ * Store the memory usage and the numa_miss and numa_foreign rates of every node in records.
+ * @param topology A topology read by readNumaMemory() at least twice
+ * @param records Array of nodeCount records to fill in
+ */
+void fillNumaMemoryRecords(const NumaTopology *topology, NumaMemoryRecord *records)
+{
+    for (int i = 0; i < topology->nodeCount; i++)
+    {
+        const NumaNode *node = topology->nodes + i;
+        const unsigned long long *meminfo = node->current.meminfo;
+        memset(records + i, 0, sizeof(NumaMemoryRecord));
+        records[i].id = node->id;
+        records[i].totalKb = meminfo[NUMA_MEM_TOTAL];
+        records[i].usedKb = meminfo[NUMA_MEM_USED];
+        records[i].filePagesKb = meminfo[NUMA_FILE_PAGES];
+        records[i].missRate = calculateNumaRate(node, NUMA_MISS);
+        records[i].foreignRate = calculateNumaRate(node, NUMA_FOREIGN);
+    }
+}
+
+/**
+ * Store the average utilization of the CPUs of every node in records.
+ * @param topology A topology set up by initNumaTopology()
+ * @param cores Utilization of each CPU, identified by its cpuN line of /proc/stat
+ * @param coreCount Number of entries in cores
+ * @param records Array of nodeCount records to fill in
+ */
+void fillNumaCpuRecords(const NumaTopology *topology, const CoreRecord *cores, int coreCount, NumaCpuRecord *records)
+{
+    for (int i = 0; i < topology->nodeCount; i++)
+    {
+        memset(records + i, 0, sizeof(NumaCpuRecord));
+        records[i].id = topology->nodes[i].id;
+        records[i].cpuCount = topology->nodes[i].cpuCount;
+    }
+    // sum the usage of each node's CPUs in its record before dividing
+    for (int i = 0; i < coreCount; i++)
+    {
+        // CPUs brought online after the nodes were read are left out
+        if (cores[i].id < 0 || cores[i].id >= topology->cpuNodeCapacity || topology->cpuNodes[cores[i].id] == -1)
+            continue;
+        NumaCpuRecord *record = records + topology->cpuNodes[cores[i].id];
+        record->usage += cores[i].usage;
+        record->usageCount++;
+    }
+    for (int i = 0; i < topology->nodeCount; i++)
+    {
+        if (records[i].usageCount > 0)
+            records[i].usage /= records[i].usageCount;
+    }
+}
+
+/**
+ * Close the files of every node and release the topology's memory.
+ * @param topology A topology set up by initNumaTopology()
+ */
+void freeNumaTopology(NumaTopology *topology)
+{
+    for (int i = 0; topology->nodes != NULL && i < topology->nodeCount; i++)
+    {
+        closeProcFile(&topology->nodes[i].meminfo);
+        closeProcFile(&topology->nodes[i].numastat);
+    }
+    free(topology->nodes);
+    free(topology->cpuNodes);
+    topology->nodes = NULL;
+    topology->cpuNodes = NULL;
+    topology->nodeCount = 0;
+    topology->cpuNodeCapacity = 0;
+}
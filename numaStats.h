@@ -0,0 +1,149 @@
+#ifndef NUMA_STATS_H
+#define NUMA_STATS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "procFile.h"
+#include "sampleRecord.h"
+
+/**
+ * Directory containing the nodeN entries describing each NUMA node
+ */
+#define SYSFS_NODE_DIRECTORY "/sys/devices/system/node"
+
+/**
+ * Size of the buffer that the meminfo of a node is read into
+ */
+#define NUMA_MEMINFO_BUFFER_SIZE 4096
+
+/**
+ * Size of the buffer that the numastat of a node is read into
+ */
+#define NUMA_NUMASTAT_BUFFER_SIZE 512
+
+/**
+ * Space reserved in the rendered per-node memory for each node, in bytes
+ */
+#define NUMA_MEMORY_OUTPUT_LENGTH 128
+
+/**
+ * Space reserved in the rendered per-node CPU usage for each node, in bytes
+ */
+#define NUMA_CPU_OUTPUT_LENGTH 64
+
+/**
+ * Slots of the values read from the meminfo of a node, in kilobytes
+ */
+#define NUMA_MEM_TOTAL 0
+#define NUMA_MEM_FREE 1
+#define NUMA_MEM_USED 2
+#define NUMA_FILE_PAGES 3
+#define NUMA_MEMINFO_KEY_COUNT 4
+
+/**
+ * Slots of the counters read from the numastat of a node, in pages
+ */
+#define NUMA_HIT 0
+#define NUMA_MISS 1
+#define NUMA_FOREIGN 2
+#define NUMA_NUMASTAT_KEY_COUNT 3
+
+/**
+ * The memory of a NUMA node at one point in time
+ */
+typedef struct numaNodeSample
+{
+    /**
+     * Values of the node's meminfo, indexed by the NUMA_MEM_* slots
+     */
+    unsigned long long meminfo[NUMA_MEMINFO_KEY_COUNT];
+    /**
+     * Counters of the node's numastat, indexed by NUMA_HIT, NUMA_MISS and NUMA_FOREIGN
+     */
+    unsigned long long numastat[NUMA_NUMASTAT_KEY_COUNT];
+    /**
+     * Monotonic time the node was read at, in seconds
+     */
+    double seconds;
+} NumaNodeSample;
+
+/**
+ * A NUMA node with the files read on every sample kept open
+ */
+typedef struct numaNode
+{
+    /**
+     * Number N of the nodeN directory
+     */
+    int id;
+    /**
+     * Number of CPUs attached to the node
+     */
+    int cpuCount;
+    /**
+     * meminfo and numastat of the node, or closed if only CPU usage is reported
+     */
+    ProcFile meminfo, numastat;
+    /**
+     * The two latest reads of the node's memory
+     */
+    NumaNodeSample previous, current;
+} NumaNode;
+
+/**
+ * The NUMA nodes of the machine and the node each CPU belongs to
+ */
+typedef struct numaTopology
+{
+    NumaNode *nodes;
+    int nodeCount;
+    /**
+     * Index in nodes of the node of each CPU id, or -1 for CPUs without a node
+     */
+    int *cpuNodes;
+    /**
+     * Number of entries in cpuNodes, one more than the highest CPU id of any node
+     */
+    int cpuNodeCapacity;
+    ProcKeyTable meminfoKeys, numastatKeys;
+} NumaTopology;
+
+/**
+ * Find the online NUMA nodes and the CPUs of each one from sysfs.
+ * @param topology The topology to initialize
+ * @param openMemory Whether to open the meminfo and numastat of each node for readNumaMemory()
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+extern int initNumaTopology(NumaTopology *topology, bool openMemory);
+
+/**
+ * Read the meminfo and numastat of every node, keeping the previous read for calculating rates.
+ * @param topology A topology set up by initNumaTopology() with openMemory set
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+extern int readNumaMemory(NumaTopology *topology);
+
+/**
+ * Store the memory usage and the numa_miss and numa_foreign rates of every node in records.
+ * @param topology A topology read by readNumaMemory() at least twice
+ * @param records Array of nodeCount records to fill in
+ */
+extern void fillNumaMemoryRecords(const NumaTopology *topology, NumaMemoryRecord *records);
+
+/**
+ * Store the average utilization of the CPUs of every node in records.
+ * @param topology A topology set up by initNumaTopology()
+ * @param cores Utilization of each CPU, identified by its cpuN line of /proc/stat
+ * @param coreCount Number of entries in cores
+ * @param records Array of nodeCount records to fill in
+ */
+extern void fillNumaCpuRecords(const NumaTopology *topology, const CoreRecord *cores, int coreCount, NumaCpuRecord *records);
+
+/**
+ * Close the files of every node and release the topology's memory.
+ * @param topology A topology set up by initNumaTopology()
+ */
+extern void freeNumaTopology(NumaTopology *topology);
+
+#endif
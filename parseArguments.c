@@ -1,125 +1,279 @@
-#include <sys/utsname.h>
-#include <sys/sysinfo.h>
-#include <unistd.h>
-#include <stdio.h>
-#include <string.h>
-#include <errno.h>
-#include <stdbool.h>
-#include <stdlib.h>
-#include <utmp.h>
-#include <inttypes.h>
-#include <sys/resource.h>
-
-#include "stringUtils.h"
-#include "parseArguments.h"
-
-/**
- * Print a standardized error to stderr to indicate to the user that the command arguments are incorrect.
-*/
-void notifyInvalidArguments() {
-    fprintf(stderr, "Error: Command has invalid formatting and could not be parsed.\n");
-}
-
-/**
- * Parse an command argument key-value pair separated by an equal sign and store its result.
- * @param result Pointer to where the value will be assigned to
- * @param argv A string representing the command string and the value (e.g. "--samples=3")
- * @returns 0 if operation was successful, 1 otherwise
-*/
-int parseNumericalArgument(long *result, char *argv)
-{
-    char *splitToken = strtok(argv, "=");
-    splitToken = strtok(NULL, "=");
-    if (splitToken == NULL)
-    {
-        // failed to find a string after the = character
-        notifyInvalidArguments();
-        return 1;
-    }
-    long tempResult = atol(splitToken);
-    if (tempResult == 0)
-    {
-        // failed to parse string to number
-        notifyInvalidArguments();
-        return 1;
-    }
-    *result = atol(splitToken);
-    return 0;
-}
-
-/**
- * Parse all command line arguments and store the results.
- * @param argc The number of command line arguments.
- * @param argv An string array of the arguments
- * @param showSystem Pointer to boolean where the --system flag value will be set
- * @param showUser Pointer to boolean where the --user flag value will be set
- * @param showGraphics Pointer to boolean where the --graphics flag value will be set
- * @param showSequential Pointer to boolean where the --sequential flag value will be set
- * @param numSamples Pointer to long where the --samples value will be set
- * @param sampleDelay Pointer to long where the --tdelay value will be set
- * @return Returns zero if command line arguments successfully returned, non-zero otherwise.
-*/
-int parseArguments(const int argc, char **argv, bool *showSystem, bool *showUser, bool *showGraphics, bool *showSequential, long* numSamples, long *sampleDelay)
-{
-    int positionalArgumentsSet = 0;
-    // parse command line arguments
-    if (argc >= 2) {
-        for (int i = 1; i < argc; i++) {
-
-            // check for a match with each flag
-
-            if (strncmp(argv[i], ARG_SYSTEM, COMMAND_LINE_LENGTH) == 0) {
-                *showSystem = true;
-            }
-            else if (strncmp(argv[i], ARG_USER, COMMAND_LINE_LENGTH) == 0) {
-                *showUser = true;
-            }
-            else if (strncmp(argv[i], ARG_GRAPHICS, COMMAND_LINE_LENGTH) == 0) {
-                *showGraphics = true;
-            }
-            else if (strncmp(argv[i], ARG_SEQUENTIAL, COMMAND_LINE_LENGTH) == 0)  {
-                *showSequential = true;
-            }
-            else if (startsWith(argv[i], ARG_SAMPLES)) {
-                if (parseNumericalArgument(numSamples, argv[i]) != 0) {
-                    // return non-zero if parsing failed
-                    return 1;
-                }
-            }
-            else if (startsWith(argv[i], ARG_TDELAY)) {
-                if (parseNumericalArgument(sampleDelay, argv[i]) != 0) {
-                    // return non-zero if parsing failed
-                    return 1;
-                }
-            }
-            else
-            {
-                if (positionalArgumentsSet == 0) {
-                    // set --samples if this is the first positional argument set
-                    *numSamples = atoi(argv[i]);
-                    if (*numSamples == 0) {
-                        notifyInvalidArguments();
-                        return 1;
-                    }
-                    positionalArgumentsSet++;
-                }
-                else if (positionalArgumentsSet == 1) {
-                    // set --tdelay if this is the second positional argument set
-                    *sampleDelay = atoi(argv[i]);
-                    if (*sampleDelay == 0) {
-                        notifyInvalidArguments();
-                        return 1;
-                    }
-                    positionalArgumentsSet++;
-                } 
-                else {
-                    // there is an unidentifiable command or excess positional arguments
-                    notifyInvalidArguments();
-                    return 1;
-                }
-            }
-        }
-    }
-    return 0;
-}
-
+#include <sys/utsname.h>
+#include <sys/sysinfo.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <math.h>
+#include <limits.h>
+#include <utmp.h>
+#include <inttypes.h>
+#include <sys/resource.h>
+
+#include "stringUtils.h"
+#include "sampleTimer.h"
+#include "psiStats.h"
+#include "parseArguments.h"
+
+/**
+ * Print a standardized error to stderr to indicate to the user that the command arguments are incorrect.
+*/
+void notifyInvalidArguments() {
+    fprintf(stderr, "Error: Command has invalid formatting and could not be parsed.\n");
+}
+
+/**
+ * Parse an command argument key-value pair separated by an equal sign and store its result.
+ * @param result Pointer to where the value will be assigned to
+ * @param argv A string representing the command string and the value (e.g. "--samples=3")
+ * @returns 0 if operation was successful, 1 otherwise
+*/
+int parseNumericalArgument(long *result, char *argv)
+{
+    char *splitToken = strtok(argv, "=");
+    splitToken = strtok(NULL, "=");
+    if (splitToken == NULL)
+    {
+        // failed to find a string after the = character
+        notifyInvalidArguments();
+        return 1;
+    }
+    long tempResult = atol(splitToken);
+    if (tempResult == 0)
+    {
+        // failed to parse string to number
+        notifyInvalidArguments();
+        return 1;
+    }
+    *result = atol(splitToken);
+    return 0;
+}
+
+/**
+ * Parse a time delay given in seconds, which may have a fractional part (e.g. "0.05"), and store it in milliseconds.
+ * @param resultMs Pointer to where the delay in milliseconds will be assigned to
+ * @param value A string representing the number of seconds
+ * @returns 0 if operation was successful, 1 otherwise
+*/
+int parseDelay(long *resultMs, const char *value)
+{
+    char *end = NULL;
+    double seconds = strtod(value, &end);
+    if (end == value || *end != '\0')
+    {
+        // failed to parse string to number
+        notifyInvalidArguments();
+        return 1;
+    }
+    if (!isfinite(seconds) || seconds <= 0 || seconds >= (double)LONG_MAX / MILLISECONDS_PER_SECOND)
+    {
+        // nan, inf and delays beyond the range of milliseconds cannot be converted
+        notifyInvalidArguments();
+        return 1;
+    }
+    long milliseconds = (long)(seconds * MILLISECONDS_PER_SECOND + 0.5);
+    if (milliseconds < 1)
+    {
+        // delay must be positive and at least one millisecond
+        notifyInvalidArguments();
+        return 1;
+    }
+    *resultMs = milliseconds;
+    return 0;
+}
+
+/**
+ * Parse a number of samples, which may be zero to sample continuously, and store its result.
+ * @param result Pointer to where the number of samples will be assigned to
+ * @param value A string representing the number of samples
+ * @returns 0 if operation was successful, 1 otherwise
+*/
+int parseSampleCount(long *result, const char *value)
+{
+    char *end = NULL;
+    long samples = strtol(value, &end, 10);
+    if (end == value || *end != '\0' || samples < 0)
+    {
+        // failed to parse string to a non-negative number
+        notifyInvalidArguments();
+        return 1;
+    }
+    *result = samples;
+    return 0;
+}
+
+/**
+ * Parse all command line arguments and store the results.
+ * @param argc The number of command line arguments.
+ * @param argv An string array of the arguments
+ * @param options Pointer to the options where the parsed flags are set. Flags that are not given are set to their defaults.
+ * @return Returns zero if command line arguments successfully returned, non-zero otherwise.
+*/
+int parseArguments(const int argc, char **argv, MonitorOptions *options)
+{
+    options->showSystem = false;
+    options->showUser = false;
+    options->showUserUsage = false;
+    options->showGraphics = false;
+    options->showSequential = false;
+    options->showCores = false;
+    options->useCgroup = false;
+    options->showPressure = false;
+    options->pressureTriggerMs = 0;
+    options->showNuma = false;
+    options->useThreads = false;
+    options->lowImpactCpus = NULL;
+    options->showSelfStats = false;
+    options->outputFormat = OUTPUT_FORMAT_TEXT;
+    options->numSamples = DEFAULT_SAMPLES;
+    options->sampleDelayMs = MILLISECONDS_PER_SECOND;
+    options->historyLength = 0;
+    options->topProcesses = 0;
+
+    int positionalArgumentsSet = 0;
+    // parse command line arguments
+    if (argc >= 2) {
+        for (int i = 1; i < argc; i++) {
+
+            // check for a match with each flag
+
+            if (strncmp(argv[i], ARG_SYSTEM, COMMAND_LINE_LENGTH) == 0) {
+                options->showSystem = true;
+            }
+            else if (strncmp(argv[i], ARG_USER, COMMAND_LINE_LENGTH) == 0) {
+                options->showUser = true;
+            }
+            else if (strncmp(argv[i], ARG_USER_USAGE, COMMAND_LINE_LENGTH) == 0) {
+                options->showUserUsage = true;
+            }
+            else if (strncmp(argv[i], ARG_GRAPHICS, COMMAND_LINE_LENGTH) == 0) {
+                options->showGraphics = true;
+            }
+            else if (strncmp(argv[i], ARG_SEQUENTIAL, COMMAND_LINE_LENGTH) == 0)  {
+                options->showSequential = true;
+            }
+            else if (strncmp(argv[i], ARG_CORES, COMMAND_LINE_LENGTH) == 0)  {
+                options->showCores = true;
+            }
+            else if (strncmp(argv[i], ARG_CGROUP, COMMAND_LINE_LENGTH) == 0)  {
+                options->useCgroup = true;
+            }
+            else if (strncmp(argv[i], ARG_PRESSURE, COMMAND_LINE_LENGTH) == 0)  {
+                options->showPressure = true;
+            }
+            else if (strncmp(argv[i], ARG_NUMA, COMMAND_LINE_LENGTH) == 0)  {
+                options->showNuma = true;
+            }
+            else if (strncmp(argv[i], ARG_THREADS, COMMAND_LINE_LENGTH) == 0)  {
+                options->useThreads = true;
+            }
+            else if (strncmp(argv[i], ARG_SELF_STATS, COMMAND_LINE_LENGTH) == 0)  {
+                options->showSelfStats = true;
+            }
+            else if (strncmp(argv[i], ARG_LOW_IMPACT, COMMAND_LINE_LENGTH) == 0)  {
+                options->lowImpactCpus = DEFAULT_HOUSEKEEPING_CPUS;
+            }
+            else if (startsWith(argv[i], ARG_LOW_IMPACT "=")) {
+                options->lowImpactCpus = argv[i] + strlen(ARG_LOW_IMPACT "=");
+                if (options->lowImpactCpus[0] < '0' || options->lowImpactCpus[0] > '9') {
+                    // the list must start with a CPU id
+                    notifyInvalidArguments();
+                    return 1;
+                }
+            }
+            else if (startsWith(argv[i], ARG_PRESSURE_TRIGGER)) {
+                if (parseNumericalArgument(&options->pressureTriggerMs, argv[i]) != 0) {
+                    // return non-zero if parsing failed
+                    return 1;
+                }
+                if (options->pressureTriggerMs < 0 || options->pressureTriggerMs >= PSI_TRIGGER_WINDOW_MS) {
+                    // the stall time must fit within the window of the trigger
+                    notifyInvalidArguments();
+                    return 1;
+                }
+                // triggered events are reported alongside the pressure averages
+                options->showPressure = true;
+            }
+            else if (startsWith(argv[i], ARG_FORMAT)) {
+                const char *format = argv[i] + strlen(ARG_FORMAT);
+                if (strcmp(format, "text") == 0) {
+                    options->outputFormat = OUTPUT_FORMAT_TEXT;
+                }
+                else if (strcmp(format, "ndjson") == 0) {
+                    options->outputFormat = OUTPUT_FORMAT_NDJSON;
+                }
+                else if (strcmp(format, "csv") == 0) {
+                    options->outputFormat = OUTPUT_FORMAT_CSV;
+                }
+                else {
+                    notifyInvalidArguments();
+                    return 1;
+                }
+            }
+            else if (startsWith(argv[i], ARG_SAMPLES)) {
+                if (parseSampleCount(&options->numSamples, argv[i] + strlen(ARG_SAMPLES)) != 0) {
+                    // return non-zero if parsing failed
+                    return 1;
+                }
+            }
+            else if (startsWith(argv[i], ARG_TDELAY)) {
+                if (parseDelay(&options->sampleDelayMs, argv[i] + strlen(ARG_TDELAY)) != 0) {
+                    // return non-zero if parsing failed
+                    return 1;
+                }
+            }
+            else if (startsWith(argv[i], ARG_HISTORY)) {
+                if (parseNumericalArgument(&options->historyLength, argv[i]) != 0) {
+                    // return non-zero if parsing failed
+                    return 1;
+                }
+                if (options->historyLength < 0) {
+                    notifyInvalidArguments();
+                    return 1;
+                }
+            }
+            else if (startsWith(argv[i], ARG_TOP)) {
+                if (parseNumericalArgument(&options->topProcesses, argv[i]) != 0) {
+                    // return non-zero if parsing failed
+                    return 1;
+                }
+                if (options->topProcesses < 0) {
+                    notifyInvalidArguments();
+                    return 1;
+                }
+            }
+            else
+            {
+                if (positionalArgumentsSet == 0) {
+                    // set --samples if this is the first positional argument set
+                    if (parseSampleCount(&options->numSamples, argv[i]) != 0) {
+                        return 1;
+                    }
+                    positionalArgumentsSet++;
+                }
+                else if (positionalArgumentsSet == 1) {
+                    // set --tdelay if this is the second positional argument set
+                    if (parseDelay(&options->sampleDelayMs, argv[i]) != 0) {
+                        return 1;
+                    }
+                    positionalArgumentsSet++;
+                } 
+                else {
+                    // there is an unidentifiable command or excess positional arguments
+                    notifyInvalidArguments();
+                    return 1;
+                }
+            }
+        }
+    }
+
+    // unless given, keep every sample up to a fixed window, so that memory stays bounded however many samples are taken
+    if (options->historyLength == 0) {
+        options->historyLength = DEFAULT_HISTORY;
+        if (options->numSamples != CONTINUOUS_SAMPLES && options->numSamples < DEFAULT_HISTORY)
+            options->historyLength = options->numSamples;
+    }
+    return 0;
+}
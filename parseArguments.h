@@ -1,6 +1,8 @@
 #ifndef PARSE_ARGUMENTS_H
 #define PARSE_ARGUMENTS_H
 
+#include <stdbool.h>
+
 /**
  * Max length of command line argument
 */
@@ -16,6 +18,11 @@
 */
 #define ARG_USER "--user"
 
+/**
+ * Command line string representing the --user-usage flag
+*/
+#define ARG_USER_USAGE "--user-usage"
+
 /**
  * Command line string representing the --graphics flag
 */
@@ -26,6 +33,63 @@
 */
 #define ARG_SEQUENTIAL "--sequential"
 
+/**
+ * Command line string representing the --cores flag
+*/
+#define ARG_CORES "--cores"
+
+/**
+ * Command line string representing the --cgroup flag
+*/
+#define ARG_CGROUP "--cgroup"
+
+/**
+ * Command line string representing the --pressure flag
+*/
+#define ARG_PRESSURE "--pressure"
+
+/**
+ * Command line string representing the --pressure-trigger= flag
+*/
+#define ARG_PRESSURE_TRIGGER "--pressure-trigger="
+
+/**
+ * Command line string representing the --numa flag
+ */
+#define ARG_NUMA "--numa"
+
+/**
+ * Command line string representing the --threads flag
+ */
+#define ARG_THREADS "--threads"
+
+/**
+ * Command line string representing the --low-impact flag, which may be followed by =CPULIST
+ */
+#define ARG_LOW_IMPACT "--low-impact"
+
+/**
+ * CPUs the monitor is pinned to by --low-impact when no list is given
+ */
+#define DEFAULT_HOUSEKEEPING_CPUS "0"
+
+/**
+ * Command line string representing the --self-stats flag
+ */
+#define ARG_SELF_STATS "--self-stats"
+
+/**
+ * Command line string representing the --format= flag
+ */
+#define ARG_FORMAT "--format="
+
+/**
+ * Values of --format: the text meant for a person, one JSON object per line, or comma separated values
+ */
+#define OUTPUT_FORMAT_TEXT 0
+#define OUTPUT_FORMAT_NDJSON 1
+#define OUTPUT_FORMAT_CSV 2
+
 /**
  * Command line string representing the --samples= flag
 */
@@ -36,18 +100,117 @@
 */
 #define ARG_TDELAY "--tdelay="
 
+/**
+ * Command line string representing the --history= flag
+*/
+#define ARG_HISTORY "--history="
+
+/**
+ * Command line string representing the --top= flag
+*/
+#define ARG_TOP "--top="
+
+/**
+ * Number of samples taken by default
+*/
+#define DEFAULT_SAMPLES 10
+
+/**
+ * Most samples kept for display by default, which is also the number kept when samples are taken continuously
+*/
+#define DEFAULT_HISTORY 60
+
+/**
+ * Value of --samples for sampling continuously until the program is stopped
+*/
+#define CONTINUOUS_SAMPLES 0
+
+/**
+ * Settings of the monitor as given by command line arguments
+*/
+typedef struct monitorOptions
+{
+    /**
+     * Show only the system usage? (--system)
+     */
+    bool showSystem;
+    /**
+     * Show only the user's usage? (--user)
+     */
+    bool showUser;
+    /**
+     * Show the CPU and memory usage of the processes of each logged in user below the sessions? (--user-usage)
+     */
+    bool showUserUsage;
+    /**
+     * Show graphical output for memory and CPU utilization? (--graphics)
+     */
+    bool showGraphics;
+    /**
+     * Output information sequentially without refreshing screen? (--sequential)
+     */
+    bool showSequential;
+    /**
+     * Show the CPU utilization of each individual core? (--cores)
+     */
+    bool showCores;
+    /**
+     * Report memory and CPU usage of the cgroup the monitor runs in, against its limits, rather than of the whole host? (--cgroup)
+     */
+    bool useCgroup;
+    /**
+     * Show the pressure stall information of the CPU, memory and IO? (--pressure)
+     */
+    bool showPressure;
+    /**
+     * Stall time in milliseconds within a PSI trigger window that is reported as soon as it happens, or 0 to not register triggers (--pressure-trigger). Default = 0
+     */
+    long pressureTriggerMs;
+    /**
+     * Show the memory and CPU usage of each NUMA node? (--numa)
+     */
+    bool showNuma;
+    /**
+     * Run the collectors as threads exchanging samples through lock-free rings, rather than as child processes exchanging samples through pipes? (--threads)
+     */
+    bool useThreads;
+    /**
+     * CPU list the monitor is pinned to while running under SCHED_IDLE with timer slack, or NULL to run normally (--low-impact). Default = NULL
+     */
+    const char *lowImpactCpus;
+    /**
+     * Show the latency of each stage of the monitor below every sample, and their histograms on exit? (--self-stats)
+     */
+    bool showSelfStats;
+    /**
+     * One of the OUTPUT_FORMAT_* formats the samples are written in (--format). Default = OUTPUT_FORMAT_TEXT
+     */
+    int outputFormat;
+    /**
+     * The number of times that the usage statistics will be sampled, or CONTINUOUS_SAMPLES to sample until stopped (--samples). Default = 10
+     */
+    long numSamples;
+    /**
+     * The time between consecutive samples of the usage statistics, in milliseconds (--tdelay, given in seconds). Default = 1 second
+     */
+    long sampleDelayMs;
+    /**
+     * The number of most recent samples kept and displayed (--history). Default = numSamples up to DEFAULT_HISTORY
+     */
+    long historyLength;
+    /**
+     * The number of processes listed by CPU and by memory usage, or 0 to not list processes (--top). Default = 0
+     */
+    long topProcesses;
+} MonitorOptions;
+
 /**
  * Parse all command line arguments and store the results.
  * @param argc The number of command line arguments.
  * @param argv An string array of the arguments
- * @param showSystem Pointer to boolean where the --system flag value will be set
- * @param showUser Pointer to boolean where the --user flag value will be set
- * @param showGraphics Pointer to boolean where the --graphics flag value will be set
- * @param showSequential Pointer to boolean where the --sequential flag value will be set
- * @param numSamples Pointer to long where the --samples value will be set
- * @param sampleDelay Pointer to long where the --tdelay value will be set
+ * @param options Pointer to the options where the parsed flags are set. Flags that are not given are set to their defaults.
  * @return Returns zero if command line arguments successfully returned, non-zero otherwise.
 */
-extern int parseArguments(const int argc, char **argv, bool *showSystem, bool *showUser, bool *showGraphics, bool *showSequential, long* numSamples, long *sampleDelay);
+extern int parseArguments(const int argc, char **argv, MonitorOptions *options);
 
 #endif
\ No newline at end of file
@@ -1,357 +1,529 @@
-#include <sys/utsname.h>
-#include <sys/sysinfo.h>
-#include <unistd.h>
-#include <stdio.h>
-#include <string.h>
-#include <errno.h>
-#include <stdbool.h>
-#include <stdlib.h>
-#include <utmp.h>
-#include <inttypes.h>
-#include <sys/resource.h>
-
-#include "stringUtils.h"
-#include "parseCpuStats.h"
-
-/**
- * Start flag for cpu stats to be calculated
- */
-#define CPU_START_FLAG 2
-
-/**
- * Flag to identify output data as CPU related
-*/
-#define CPU_DATA_ID 2
-
-/**
- * Max length of string readable from /proc/cpuinfo
- */
-#define CPUINFO_LINE_LENGTH 256
-/**
- * Max number of processors to check for
- */
-#define MAX_PROCESSORS 256
-/**
- * Size of a single gigabyte in bytes (1024 ^ 3)
- */
-#define GIGABYTE_BYTE_SIZE 1073741824
-/**
- * Max length of output string dedicated for displaying the bars in the graphical representation of CPU usage
- */
-#define GRAPHICS_MAX_CPU_BAR_COUNT 100
-/**
- * Max length of output string dedicated for displaying the numbers in the graphical representation of CPU usage
- */
-#define GRAPHICS_MAX_CPU_NUM_COUNT 32
-
-/**
- * Representation of a single data point of CPU usage, as set by recordCpuStats()
- */
-typedef struct cpuDataSample
-{
-    long user;
-    long nice;
-    long system;
-    long idle;
-    long iowait;
-    long irq;
-    long softirq;
-    long steal;
-    long guest;
-    long guest_nice;
-} CpuDataSample;
-
-/**
- * Retrieve the number of processors and cores on the machine while considering hyperthreading.
- * Statistics are calculated by reading /proc/cpuinfo, and counting the number of unique physical ids and summing their sibling counts.
- * @param processorCount Pointer to int where the number of processors will be stored
- * @param coreCount Pointer to int where the number of cores will be stored
- * @returns 0 if operation successful, 1 otherwise
- */
-int getCpuCounts(int *processorCount, int *coreCount)
-{
-    FILE *cpuinfodata = fopen("/proc/cpuinfo", "r");
-    char inp[CPUINFO_LINE_LENGTH], inpVal[CPUINFO_LINE_LENGTH];
-    bool processors_seen[MAX_PROCESSORS] = {false};
-    int lastPhysicalId = 0;
-
-    if (cpuinfodata == NULL)
-    {
-        fprintf(stderr, "Encountered error finding /proc/cpuinfo");
-        return 1;
-    }
-    else
-    {
-        while (fgets(inp, CPUINFO_LINE_LENGTH, cpuinfodata) != NULL)
-        {
-            // check if the line begins with "processor  :"
-            if (startsWith(inp, "physical id"))
-            {
-                // retrieve physical id and store it
-                strncpy(inpVal, strstr(inp, ":") + 1, CPUINFO_LINE_LENGTH);
-                lastPhysicalId = atoi(inpVal);
-            }
-            else if (startsWith(inp, "siblings"))
-            {
-                // add the number of "cores" for processors we havent seen before
-                // by using "siblings" so we account for hyperthreading, so the core count is similar to that of htop and nproc
-                if (lastPhysicalId < MAX_PROCESSORS && !processors_seen[lastPhysicalId])
-                {
-                    strncpy(inpVal, strstr(inp, ":") + 1, CPUINFO_LINE_LENGTH);
-                    processors_seen[lastPhysicalId] = true;
-                    *coreCount = *coreCount + atoi(inpVal);
-                    *processorCount = *processorCount + 1;
-                }
-            }
-        }
-    }
-    if (fclose(cpuinfodata) != 0)
-    {
-        fprintf(stderr, "Failed to properly close /proc/cpuinfo");
-        return 1;
-    }
-    return 0;
-}
-
-/**
- * Record a data point for CPU utilization by reading from /proc/stat, and store the data in a struct.
- * @param cpuHistoryRow A pointer to a cpuDataSample struct used to store the parsed values
- * @returns 1 if operation was successful, 0 otherwise
- */
-int recordCpuStats(struct cpuDataSample *cpuHistoryRow)
-{
-    char totalLine[CPUINFO_LINE_LENGTH];
-    FILE *statdata = fopen("/proc/stat", "r");
-    if (statdata == NULL)
-    {
-        fprintf(stderr, "Encountered error finding /proc/cpuinfo");
-        return 1;
-    }
-    else
-    {
-        // read the first line of /proc/stat which contains the total cpu time
-        fgets(totalLine, CPUINFO_LINE_LENGTH, statdata);
-        char *nextNum = NULL;
-        // separate the entries in the row using the space as delimiter
-        nextNum = strtok(totalLine, " ");
-        int index = 0;
-        nextNum = strtok(NULL, " ");
-        // parse each integer
-        while (nextNum != NULL && index < 10)
-        {
-            long val = atol(nextNum);
-            switch (index)
-            {
-            case 0:
-                cpuHistoryRow->user = val;
-                break;
-            case 1:
-                cpuHistoryRow->nice = val;
-                break;
-            case 2:
-                cpuHistoryRow->system = val;
-                break;
-            case 3:
-                cpuHistoryRow->idle = val;
-                break;
-            case 4:
-                cpuHistoryRow->iowait = val;
-                break;
-            case 5:
-                cpuHistoryRow->irq = val;
-                break;
-            case 6:
-                cpuHistoryRow->softirq = val;
-                break;
-            case 7:
-                cpuHistoryRow->steal = val;
-                break;
-            case 8:
-                cpuHistoryRow->guest = val;
-                break;
-            case 9:
-                cpuHistoryRow->guest_nice = val;
-                break;
-            }
-            index++;
-            nextNum = strtok(NULL, " ");
-        }
-    }
-    if (fclose(statdata) != 0)
-    {
-        perror("Failed to close /proc/stat");
-        return 1;
-    }
-    return 0;
-}
-
-/**
- * Calculate the percentage CPU utilization (0%-100%) that occurred between two CPU usage data points parsed by recordCpuStats.
- * @param previous Pointer to data point taken first.
- * @param current Pointer to data point taken second.
- * @returns Percentage CPU utilization, with 100 representing 100%.
- */
-float calculateCpuUsage(struct cpuDataSample *previous, struct cpuDataSample *current)
-{
-    // calculate the cpu change attributed to idle
-    long deltaIdle = current->idle - previous->idle;
-
-    // calculate the total cpu change from previous to current
-    long totalDelta = (current->user - previous->user) +
-                      (current->nice - previous->nice) +
-                      (current->system - previous->system) +
-                      deltaIdle +
-                      (current->iowait - previous->iowait) +
-                      (current->irq - previous->irq) +
-                      (current->softirq - previous->softirq) +
-                      (current->steal - previous->steal);
-
-    float usage = (1 - (float)deltaIdle / (float)totalDelta) * 100;
-    return usage;
-}
-
-/**
- * Return a pointer to dynamically-allocated string representing the specified change in CPU utilization graphically.
- * The display begins with a [ character, followed by a number of | characters proportional to the CPU utilization level
- * @param cpuUsage The value of CPU utilization to be displayed. 100 = 100%.
- * @return A string displaying the CPU usage as a graphical display.
- */
-char *renderCPUUsage(float cpuUsage)
-{
-    char *deltaChange = (char *)malloc((GRAPHICS_MAX_CPU_BAR_COUNT + GRAPHICS_MAX_CPU_NUM_COUNT) * sizeof(char));
-
-    deltaChange[0] = '[';
-    for (int i = 1; i < GRAPHICS_MAX_CPU_BAR_COUNT + GRAPHICS_MAX_CPU_NUM_COUNT - 1; i++)
-    {
-        deltaChange[i] = ' ';
-    }
-    deltaChange[GRAPHICS_MAX_CPU_BAR_COUNT + GRAPHICS_MAX_CPU_NUM_COUNT - 1] = '\0';
-
-    int bars = cpuUsage / 100.0 * GRAPHICS_MAX_CPU_BAR_COUNT;
-    for (int i = 1; i <= (int)(bars); i++)
-    {
-        deltaChange[i] = '|';
-    }
-    deltaChange[bars + 1] = '\0';
-
-    char deltaNum[GRAPHICS_MAX_CPU_NUM_COUNT] = "";
-    snprintf(deltaNum, GRAPHICS_MAX_CPU_NUM_COUNT, " %.2f%%", cpuUsage);
-
-    strncat(deltaChange, deltaNum, GRAPHICS_MAX_CPU_NUM_COUNT);
-
-    return deltaChange;
-}
-
-/**
- * Handle processing and printing of CPU utilization stats
- * @param numSamples The number of iterations specified by command line arguments
- * @param showGraphics Command line argument for whether to show memory use graphics
- * @param writeToChildFds Pipes used to read input data from main
- * @param readFromChildFds Pipes used to write input data to main
- * @param incomingDataPipe Pipe used to notify parent of data ready in readFromChildFds
- */
-void displayCpu(int numSamples, bool showGraphics, int writeToChildFds[2], int readFromChildFds[2], int incomingDataPipe[2])
-{
-    struct cpuDataSample cpuData[numSamples + 1];
-    float cpuHistory[numSamples + 1];
-    for (int i = 0; i <= numSamples; i++)
-    {
-        cpuHistory[i] = 0.0;
-    }
-
-    char averageUseOutputString[4096], outputString[4096];
-    int parentInfo, thisSample;
-
-    while (true)
-    {
-        // get an instruction from the parent
-        read(writeToChildFds[FD_READ], &parentInfo, sizeof(int));
-        if (parentInfo != CPU_START_FLAG) {
-            // TODO: Remove before submitting
-            printf("CPU process ended.\n");
-            break;
-        }
-
-        // get the iteration number
-        read(writeToChildFds[FD_READ], &thisSample, sizeof(int));
-
-        // Total number of processors on the machine
-        int processorCount = 0;
-        // Total number of cores across all processors on the machine
-        int coreCount = 0;
-        if (getCpuCounts(&processorCount, &coreCount) != 0)
-        {
-            exit(1);
-        }
-
-        // sample the cpu utilization
-        if (recordCpuStats(cpuData + thisSample) != 0)
-        {
-            exit(1);
-        }
-
-        // compute average since start
-        float averageCpuUsage = calculateCpuUsage(cpuData, cpuData + thisSample);
-        snprintf(averageUseOutputString, 4096, "\tAverage Usage = %.4f%%\n", averageCpuUsage);
-
-        // calculate the cpu utilization for the current sample
-        // calculate the unused cpu time
-        if (thisSample > 0)
-        cpuHistory[thisSample] = calculateCpuUsage(cpuData + thisSample - 1, cpuData + thisSample);
-
-        if (thisSample == 0) {
-            continue;
-        }
-        else if (thisSample == 1)
-        {
-            if (showGraphics)
-            {
-                char *cpuGraphics = renderCPUUsage(cpuHistory[thisSample]);
-                // print only the % usage if this is the first sample
-                snprintf(outputString, 4096, "%.2f%% (0.00) \t%s\n", cpuHistory[thisSample], cpuGraphics);
-                free(cpuGraphics);
-            }
-            else
-            {
-                snprintf(outputString, 4096, "%.2f%% (0.00)\n", cpuHistory[thisSample - 1]);
-            }
-        }
-        else if (thisSample > 1)
-        {
-            // print the change in cpu % usage from the previous sample
-            float absChange = cpuHistory[thisSample] - cpuHistory[thisSample - 1];
-            if (showGraphics)
-            {
-                char *cpuGraphics = renderCPUUsage(cpuHistory[thisSample]);
-                snprintf(outputString, 4096, "%.2f%% (%.2f) \t%s\n", cpuHistory[thisSample], absChange, cpuGraphics);
-                free(cpuGraphics);
-            }
-            else
-            {
-                snprintf(outputString, 4096, "%.2f%% (%.2f)\n", cpuHistory[thisSample], absChange);
-            }
-        }
-
-        // send results back to parent in a pipe
-        write(readFromChildFds[FD_WRITE], &processorCount, sizeof(int));
-        write(readFromChildFds[FD_WRITE], &coreCount, sizeof(int));
-        
-        int outLen = strlen(averageUseOutputString);
-        write(readFromChildFds[FD_WRITE], &outLen, sizeof(int)); 
-        write(readFromChildFds[FD_WRITE], averageUseOutputString, sizeof(char) * (outLen + 1));
-        outLen = strlen(outputString);
-        write(readFromChildFds[FD_WRITE], &outLen, sizeof(int)); 
-        write(readFromChildFds[FD_WRITE], outputString, sizeof(char) * (outLen + 1));
-    
-        // printf("Notifying parent cpu");
-        int temp = CPU_DATA_ID; 
-        write(incomingDataPipe[FD_WRITE], &temp, sizeof(int)); // notify parent that there is cpu data
-    }
-    exit(0);
-    close(readFromChildFds[FD_READ]);
-    close(readFromChildFds[FD_WRITE]);
-    close(writeToChildFds[FD_READ]);
-    close(writeToChildFds[FD_WRITE]);
-    close(incomingDataPipe[FD_READ]);
-    close(incomingDataPipe[FD_WRITE]);
-}
+#include <sys/utsname.h>
+#include <sys/sysinfo.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <utmp.h>
+#include <inttypes.h>
+#include <sys/resource.h>
+
+#include "heapCounter.h"
+#include "stringUtils.h"
+#include "procFile.h"
+#include "cpuTopology.h"
+#include "cgroupStats.h"
+#include "numaStats.h"
+#include "ringBuffer.h"
+#include "sampleTimer.h"
+#include "sampleRecord.h"
+#include "parseArguments.h"
+#include "parseCpuStats.h"
+
+/**
+ * A data point of CPU usage together with the utilization calculated from it, as kept in the CPU history
+ */
+typedef struct cpuHistoryEntry
+{
+    CpuDataSample data;
+    /**
+     * CPU time of the monitor's cgroup at the same point, only read in cgroup mode
+     */
+    CgroupCpu cgroup;
+    float usage;
+} CpuHistoryEntry;
+
+/**
+ * Grow the arrays of a CpuCoreTable so that they can hold the given number of cores, keeping the values of the cores
+ * already stored, as the table may grow in the middle of parsing /proc/stat.
+ * @param table The table to resize. A zero-initialized table has no arrays allocated.
+ * @param capacity The number of cores the table must have room for, at least its current capacity
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+int resizeCpuCoreTable(CpuCoreTable *table, int capacity)
+{
+    // the ids and the 8 counters share one allocation, laid out one array after another
+    noteHeapAllocation();
+    long *block = (long *)realloc(table->coreIds, sizeof(long) * capacity * 9);
+    if (block == NULL)
+    {
+        perror("realloc");
+        return 1;
+    }
+    // move each array to where it starts in the larger block, last first so that no array overwrites one not yet moved
+    for (int array = 8; array > 0 && table->capacity > 0; array--)
+    {
+        memmove(block + (size_t)capacity * array, block + (size_t)table->capacity * array, sizeof(long) * table->capacity);
+    }
+    table->coreIds = block;
+    table->user = block + capacity;
+    table->nice = block + capacity * 2;
+    table->system = block + capacity * 3;
+    table->idle = block + capacity * 4;
+    table->iowait = block + capacity * 5;
+    table->irq = block + capacity * 6;
+    table->softirq = block + capacity * 7;
+    table->steal = block + capacity * 8;
+    table->capacity = capacity;
+    return 0;
+}
+
+/**
+ * Release the arrays held by a CpuCoreTable.
+ * @param table The table to free
+ */
+void freeCpuCoreTable(CpuCoreTable *table)
+{
+    free(table->coreIds);
+    table->coreIds = NULL;
+    table->coreCount = 0;
+    table->capacity = 0;
+}
+
+/**
+ * Parse the cpuN lines of /proc/stat, starting at the cursor, into a CpuCoreTable.
+ * @param cursor Pointer to the start of the first cpuN line. Set to where parsing stopped.
+ * @param coreTable The table to store the counters of each core in
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+int recordCoreStats(const char **cursor, CpuCoreTable *coreTable)
+{
+    int core = 0;
+    while (startsWith(*cursor, "cpu") && (*cursor)[3] >= '0' && (*cursor)[3] <= '9')
+    {
+        if (core == coreTable->capacity && resizeCpuCoreTable(coreTable, coreTable->capacity == 0 ? 64 : coreTable->capacity * 2) != 0)
+        {
+            return 1;
+        }
+        *cursor += 3;
+        coreTable->coreIds[core] = scanUnsigned(cursor);
+        coreTable->user[core] = scanUnsigned(cursor);
+        coreTable->nice[core] = scanUnsigned(cursor);
+        coreTable->system[core] = scanUnsigned(cursor);
+        coreTable->idle[core] = scanUnsigned(cursor);
+        coreTable->iowait[core] = scanUnsigned(cursor);
+        coreTable->irq[core] = scanUnsigned(cursor);
+        coreTable->softirq[core] = scanUnsigned(cursor);
+        coreTable->steal[core] = scanUnsigned(cursor);
+        core++;
+        if (!skipLine(cursor))
+            break;
+    }
+    coreTable->coreCount = core;
+    return 0;
+}
+
+/**
+ * Record a data point for CPU utilization by re-reading the already open /proc/stat, and store the data in a struct.
+ * The first line of the file, which contains the total cpu time, is parsed in a single pass without copying or tokenizing.
+ * @param statFile /proc/stat, as opened by openProcFile()
+ * @param cpuHistoryRow A pointer to a cpuDataSample struct used to store the parsed values
+ * @param coreTable If not NULL, the counters of each individual core are also parsed and stored in this table
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+int recordCpuStats(ProcFile *statFile, struct cpuDataSample *cpuHistoryRow, CpuCoreTable *coreTable)
+{
+    while (true)
+    {
+        if (readProcFile(statFile) != 0)
+        {
+            fprintf(stderr, "Encountered error reading /proc/stat\n");
+            return 1;
+        }
+        if (!startsWith(statFile->buffer, "cpu "))
+        {
+            fprintf(stderr, "Unexpected format of /proc/stat\n");
+            return 1;
+        }
+
+        // skip the "cpu" label and parse each integer of the first row in order
+        const char *cursor = statFile->buffer + 3;
+        cpuHistoryRow->user = scanUnsigned(&cursor);
+        cpuHistoryRow->nice = scanUnsigned(&cursor);
+        cpuHistoryRow->system = scanUnsigned(&cursor);
+        cpuHistoryRow->idle = scanUnsigned(&cursor);
+        cpuHistoryRow->iowait = scanUnsigned(&cursor);
+        cpuHistoryRow->irq = scanUnsigned(&cursor);
+        cpuHistoryRow->softirq = scanUnsigned(&cursor);
+        cpuHistoryRow->steal = scanUnsigned(&cursor);
+        cpuHistoryRow->guest = scanUnsigned(&cursor);
+        cpuHistoryRow->guest_nice = scanUnsigned(&cursor);
+
+        if (coreTable == NULL)
+            return 0;
+
+        skipLine(&cursor);
+        if (recordCoreStats(&cursor, coreTable) != 0)
+            return 1;
+
+        // the cpuN lines ran into the end of the buffer, so enlarge it and read again to get every core
+        if (*cursor == '\0' && isProcFileTruncated(statFile))
+        {
+            if (growProcFile(statFile) != 0)
+                return 1;
+            continue;
+        }
+        return 0;
+    }
+}
+
+/**
+ * Calculate the percentage CPU utilization (0%-100%) that occurred between two CPU usage data points parsed by recordCpuStats.
+ * @param previous Pointer to data point taken first.
+ * @param current Pointer to data point taken second.
+ * @returns Percentage CPU utilization, with 100 representing 100%.
+ */
+float calculateCpuUsage(struct cpuDataSample *previous, struct cpuDataSample *current)
+{
+    // calculate the cpu change attributed to idle
+    long deltaIdle = current->idle - previous->idle;
+
+    // calculate the total cpu change from previous to current
+    long totalDelta = (current->user - previous->user) +
+                      (current->nice - previous->nice) +
+                      (current->system - previous->system) +
+                      deltaIdle +
+                      (current->iowait - previous->iowait) +
+                      (current->irq - previous->irq) +
+                      (current->softirq - previous->softirq) +
+                      (current->steal - previous->steal);
+
+    // no tick passed between samples taken less than a tick apart, so there is nothing to measure
+    if (totalDelta <= 0)
+        return 0.0;
+    float usage = (1 - (float)deltaIdle / (float)totalDelta) * 100;
+    return usage;
+}
+
+/**
+ * Calculate the percentage CPU utilization (0%-100%) of every core between two per-core data points parsed by recordCpuStats.
+ * The counters are laid out as one array per field so this loop runs over all cores at once and can be vectorized.
+ * @param previous Table of the data point taken first.
+ * @param current Table of the data point taken second. Must describe the same cores as previous.
+ * @param usage Array of at least current->coreCount values where the utilization of each core is stored, with 100 representing 100%.
+ */
+void calculateCoreUsage(const CpuCoreTable *previous, const CpuCoreTable *current, float *restrict usage)
+{
+    const long *restrict userPrev = previous->user, *restrict userCur = current->user;
+    const long *restrict nicePrev = previous->nice, *restrict niceCur = current->nice;
+    const long *restrict systemPrev = previous->system, *restrict systemCur = current->system;
+    const long *restrict idlePrev = previous->idle, *restrict idleCur = current->idle;
+    const long *restrict iowaitPrev = previous->iowait, *restrict iowaitCur = current->iowait;
+    const long *restrict irqPrev = previous->irq, *restrict irqCur = current->irq;
+    const long *restrict softirqPrev = previous->softirq, *restrict softirqCur = current->softirq;
+    const long *restrict stealPrev = previous->steal, *restrict stealCur = current->steal;
+    int coreCount = current->coreCount;
+
+    for (int i = 0; i < coreCount; i++)
+    {
+        long deltaIdle = idleCur[i] - idlePrev[i];
+        long totalDelta = (userCur[i] - userPrev[i]) +
+                          (niceCur[i] - nicePrev[i]) +
+                          (systemCur[i] - systemPrev[i]) +
+                          deltaIdle +
+                          (iowaitCur[i] - iowaitPrev[i]) +
+                          (irqCur[i] - irqPrev[i]) +
+                          (softirqCur[i] - softirqPrev[i]) +
+                          (stealCur[i] - stealPrev[i]);
+        // an idle core with no ticks between samples is reported as 0% rather than dividing by zero
+        float total = totalDelta > 0 ? (float)totalDelta : 1.0f;
+        float busy = totalDelta > 0 ? (float)(totalDelta - deltaIdle) : 0.0f;
+        usage[i] = busy / total * 100;
+    }
+}
+
+/**
+ * Check whether two per-core data points describe the same set of online cores, so that their counters can be compared.
+ * @param previous Table of the data point taken first.
+ * @param current Table of the data point taken second.
+ * @returns true if both tables list the same cores in the same order, false otherwise
+ */
+bool sameCoreLayout(const CpuCoreTable *previous, const CpuCoreTable *current)
+{
+    return previous->coreCount == current->coreCount &&
+           memcmp(previous->coreIds, current->coreIds, sizeof(long) * current->coreCount) == 0;
+}
+
+/**
+ * State the CPU collector keeps between samples
+ */
+typedef struct cpuCollector
+{
+    const MonitorOptions *options;
+    bool showCores;
+    bool showNuma;
+    /**
+     * Whether per-core counters are read, which --numa also needs as the usage of each node is averaged over its CPUs
+     */
+    bool collectCores;
+    /**
+     * The data point taken on the first sample, used to compute the average since start
+     */
+    CpuDataSample firstSample;
+    CgroupCpu firstCgroupSample;
+    /**
+     * The most recent data points and their utilization, of which at least the previous sample must be kept
+     */
+    RingBuffer cpuHistory;
+    /**
+     * /proc/stat, kept open for the lifetime of the collector and re-read on every sample
+     */
+    ProcFile statFile;
+    /**
+     * The processor and core counts, cached and only rebuilt when a CPU goes on or offline
+     */
+    CpuTopology topology;
+    /**
+     * The cgroup, only open in cgroup mode when it has a CPU controller
+     */
+    Cgroup cgroup;
+    bool useCgroup;
+    const char *cgroupName;
+    /**
+     * Per-core counters of the previous and current data points, swapped after every sample
+     */
+    CpuCoreTable coreTables[2];
+    CpuCoreTable *previousCores, *currentCores;
+    float *coreUsage;
+    CoreRecord *coreRecords;
+    int coreRecordCapacity;
+    NumaTopology numa;
+    NumaCpuRecord *numaRecords;
+    CpuRecord record;
+    double timestamp;
+} CpuCollector;
+
+/**
+ * Open the files read by the CPU collector.
+ * @param options The settings given by command line arguments
+ * @returns The state of the collector, or NULL if it could not be set up
+ */
+void *initCpuCollector(const MonitorOptions *options)
+{
+    CpuCollector *collector = (CpuCollector *)calloc(1, sizeof(CpuCollector));
+    if (collector == NULL)
+    {
+        perror("calloc");
+        return NULL;
+    }
+    collector->options = options;
+    collector->showCores = options->showCores;
+    collector->showNuma = options->showNuma;
+    collector->collectCores = collector->showCores || collector->showNuma;
+
+    if (initRingBuffer(&collector->cpuHistory, options->historyLength < 2 ? 2 : options->historyLength, sizeof(CpuHistoryEntry)) != 0 ||
+        openProcFile(&collector->statFile, "/proc/stat", PROC_STAT_BUFFER_SIZE) != 0 ||
+        initCpuTopology(&collector->topology) != 0)
+    {
+        return NULL;
+    }
+
+    // in cgroup mode, utilization is the cgroup's CPU time measured against its quota instead of the whole host's
+    collector->cgroupName = "";
+    if (options->useCgroup)
+    {
+        if (openCgroup(&collector->cgroup) != 0)
+        {
+            return NULL;
+        }
+        collector->cgroupName = collector->cgroup.name;
+        collector->useCgroup = collector->cgroup.hasCpu;
+        if (!collector->useCgroup)
+        {
+            closeCgroup(&collector->cgroup);
+        }
+    }
+
+    collector->previousCores = collector->coreTables;
+    collector->currentCores = collector->coreTables + 1;
+
+    if (collector->showNuma)
+    {
+        if (initNumaTopology(&collector->numa, false) != 0)
+        {
+            return NULL;
+        }
+        collector->numaRecords = (NumaCpuRecord *)calloc(collector->numa.nodeCount > 0 ? collector->numa.nodeCount : 1, sizeof(NumaCpuRecord));
+        if (collector->numaRecords == NULL)
+        {
+            perror("calloc");
+            return NULL;
+        }
+    }
+    return collector;
+}
+
+/**
+ * Read the CPU utilization since the previous sample and since the first one, and the utilization of each core and NUMA node.
+ * @param state The state returned by initCpuCollector()
+ * @param thisSample Index of the sample, of which sample 0 only sets the baseline of the utilization
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+int sampleCpuCollector(void *state, long thisSample)
+{
+    CpuCollector *collector = (CpuCollector *)state;
+    CpuRecord *record = &collector->record;
+
+    if (refreshCpuTopology(&collector->topology, NULL) != 0)
+    {
+        return 1;
+    }
+    memset(record, 0, sizeof(CpuRecord));
+    // Total number of processors on the machine
+    record->processorCount = collector->topology.packageCount;
+    // Total number of cores across all processors on the machine, counting each hyperthread
+    record->coreCount = collector->topology.onlineCount;
+    // Total number of physical cores across all processors on the machine
+    record->physicalCoreCount = collector->topology.coreCount;
+
+    // sample the cpu utilization, keeping the previous data point which is the newest until the push
+    CpuHistoryEntry *previous = (CpuHistoryEntry *)getRingBufferFromNewest(&collector->cpuHistory, 0);
+    CpuHistoryEntry *current = (CpuHistoryEntry *)pushRingBuffer(&collector->cpuHistory);
+    collector->timestamp = getMonotonicSeconds();
+    if (recordCpuStats(&collector->statFile, &current->data, collector->collectCores ? collector->currentCores : NULL) != 0)
+    {
+        return 1;
+    }
+    if (collector->useCgroup && readCgroupCpu(&collector->cgroup, &current->cgroup) != 0)
+    {
+        return 1;
+    }
+    record->userTicks = current->data.user;
+    record->niceTicks = current->data.nice;
+    record->systemTicks = current->data.system;
+    record->idleTicks = current->data.idle;
+    record->iowaitTicks = current->data.iowait;
+    record->irqTicks = current->data.irq;
+    record->softirqTicks = current->data.softirq;
+    record->stealTicks = current->data.steal;
+    if (thisSample == 0)
+    {
+        collector->firstSample = current->data;
+        collector->firstCgroupSample = current->cgroup;
+    }
+
+    if (collector->collectCores)
+    {
+        CpuCoreTable *currentCores = collector->currentCores;
+        // make room for the utilization of every core, which only grows if cores come online
+        if (collector->coreRecordCapacity < currentCores->capacity)
+        {
+            collector->coreRecordCapacity = currentCores->capacity;
+            noteHeapAllocation();
+            collector->coreUsage = (float *)realloc(collector->coreUsage, sizeof(float) * collector->coreRecordCapacity);
+            noteHeapAllocation();
+            collector->coreRecords = (CoreRecord *)realloc(collector->coreRecords, sizeof(CoreRecord) * collector->coreRecordCapacity);
+            if (collector->coreUsage == NULL || collector->coreRecords == NULL)
+            {
+                perror("realloc");
+                return 1;
+            }
+        }
+
+        if (thisSample > 0 && sameCoreLayout(collector->previousCores, currentCores))
+        {
+            calculateCoreUsage(collector->previousCores, currentCores, collector->coreUsage);
+        }
+        else
+        {
+            // cores went on or offline since the last sample, so there is nothing to compare against
+            memset(collector->coreUsage, 0, sizeof(float) * currentCores->coreCount);
+        }
+        for (int i = 0; i < currentCores->coreCount; i++)
+        {
+            collector->coreRecords[i].id = currentCores->coreIds[i];
+            collector->coreRecords[i].usage = collector->coreUsage[i];
+        }
+        if (collector->showCores)
+            record->coreRecordCount = currentCores->coreCount;
+        if (collector->showNuma)
+        {
+            fillNumaCpuRecords(&collector->numa, collector->coreRecords, currentCores->coreCount, collector->numaRecords);
+            record->numaNodeCount = collector->numa.nodeCount;
+        }
+
+        collector->currentCores = collector->previousCores;
+        collector->previousCores = currentCores;
+    }
+
+    // compute average since start
+    if (collector->useCgroup)
+    {
+        record->flags |= RECORD_FLAG_CGROUP;
+        record->averageUsage = calculateCgroupCpuUsage(&collector->firstCgroupSample, &current->cgroup, record->coreCount);
+        record->cgroupLimitCpus = current->cgroup.limitCpus;
+        record->cgroupPeriods = current->cgroup.stat[CGROUP_CPU_PERIODS];
+        record->cgroupThrottledPeriods = current->cgroup.stat[CGROUP_CPU_THROTTLED_PERIODS];
+        record->cgroupThrottledUsec = current->cgroup.stat[CGROUP_CPU_THROTTLED_USEC];
+    }
+    else
+    {
+        record->averageUsage = calculateCpuUsage(&collector->firstSample, &current->data);
+        if (collector->options->useCgroup)
+            record->flags |= RECORD_FLAG_CGROUP_MISSING;
+    }
+
+    // calculate the cpu utilization for the current sample
+    current->usage = 0.0;
+    if (thisSample == 0 || previous == NULL)
+    {
+        return 0;
+    }
+    current->usage = collector->useCgroup ? calculateCgroupCpuUsage(&previous->cgroup, &current->cgroup, record->coreCount)
+                                          : calculateCpuUsage(&previous->data, &current->data);
+    record->usage = current->usage;
+    return 0;
+}
+
+/**
+ * Describe the record of the latest sample as the parts of a RECORD_TYPE_CPU record.
+ * @param state The state returned by initCpuCollector()
+ * @param parts Parts of the record, of which the first entry is left free for the header
+ * @param timestamp Where to store the monotonic time the values were read at
+ * @returns The number of entries in parts including the header
+ */
+int encodeCpuCollector(void *state, struct iovec *parts, double *timestamp)
+{
+    CpuCollector *collector = (CpuCollector *)state;
+    CpuRecord *record = &collector->record;
+    record->cgroupNameLength = strlen(collector->cgroupName);
+
+    parts[1].iov_base = record;
+    parts[1].iov_len = sizeof(CpuRecord);
+    parts[2].iov_base = collector->coreRecords;
+    parts[2].iov_len = sizeof(CoreRecord) * record->coreRecordCount;
+    parts[3].iov_base = collector->numaRecords;
+    parts[3].iov_len = sizeof(NumaCpuRecord) * record->numaNodeCount;
+    parts[4].iov_base = (char *)collector->cgroupName;
+    parts[4].iov_len = sizeof(char) * (record->cgroupNameLength + 1);
+    *timestamp = collector->timestamp;
+    return 5;
+}
+
+/**
+ * Close the files read by the CPU collector and release its state.
+ * @param state The state returned by initCpuCollector()
+ */
+void teardownCpuCollector(void *state)
+{
+    CpuCollector *collector = (CpuCollector *)state;
+    closeProcFile(&collector->statFile);
+    freeRingBuffer(&collector->cpuHistory);
+    freeCpuTopology(&collector->topology);
+    if (collector->useCgroup)
+    {
+        closeCgroup(&collector->cgroup);
+    }
+    freeCpuCoreTable(collector->coreTables);
+    freeCpuCoreTable(collector->coreTables + 1);
+    free(collector->coreUsage);
+    free(collector->coreRecords);
+    if (collector->showNuma)
+    {
+        freeNumaTopology(&collector->numa);
+        free(collector->numaRecords);
+    }
+    free(collector);
+}
@@ -12,8 +12,11 @@
 #include <utmp.h>
 #include <inttypes.h>
 #include <sys/resource.h>
+#include <sys/uio.h>
 
 #include "stringUtils.h"
+#include "procFile.h"
+#include "parseArguments.h"
 
 #ifndef FD_WRITE
 #define FD_WRITE 1
@@ -24,44 +27,133 @@
 #endif
 
 /**
- * Start flag for cpu stats to be calculated
+ * Size of the buffer that /proc/stat is read into. Only the leading cpu lines are parsed, so the rest of the file may be truncated.
  */
-#define CPU_START_FLAG 2
+#define PROC_STAT_BUFFER_SIZE 16384
+/**
+ * Size of a single gigabyte in bytes (1024 ^ 3)
+ */
+#define GIGABYTE_BYTE_SIZE 1073741824
+/**
+ * Max length of output string dedicated for displaying the bars in the graphical representation of CPU usage
+ */
+#define GRAPHICS_MAX_CPU_BAR_COUNT 100
+/**
+ * Max length of output string dedicated for displaying the numbers in the graphical representation of CPU usage
+ */
+#define GRAPHICS_MAX_CPU_NUM_COUNT 32
+/**
+ * Length of the bar in the graphical representation of a single core's CPU usage
+ */
+#define GRAPHICS_MAX_CORE_BAR_COUNT 20
+/**
+ * Number of cores listed on each row of the per-core CPU usage when graphics are not shown
+ */
+#define CORES_PER_ROW 6
+/**
+ * Space reserved in the per-core CPU usage output for each core, in bytes
+ */
+#define CORE_OUTPUT_LENGTH 64
 
 /**
- * Flag to identify output data as CPU related
-*/
-#define CPU_DATA_ID 2
+ * Representation of a single data point of CPU usage, as set by recordCpuStats()
+ */
+typedef struct cpuDataSample
+{
+    long user;
+    long nice;
+    long system;
+    long idle;
+    long iowait;
+    long irq;
+    long softirq;
+    long steal;
+    long guest;
+    long guest_nice;
+} CpuDataSample;
 
 /**
- * Max length of string readable from /proc/cpuinfo
+ * Counters of every cpuN line in /proc/stat, stored as a structure of arrays with one contiguous array per counter
+ * so that the usage of all cores can be computed in a single vectorizable loop by calculateCoreUsage().
+ * All counter arrays are carved out of a single allocation owned by coreIds.
  */
-#define CPUINFO_LINE_LENGTH 256
+typedef struct cpuCoreTable
+{
+    /**
+     * Number of cores recorded in the table
+     */
+    int coreCount;
+    /**
+     * Number of cores the arrays have room for
+     */
+    int capacity;
+    /**
+     * The N of each cpuN line. Offline cores have no line, so ids may not be consecutive.
+     */
+    long *coreIds;
+    long *user;
+    long *nice;
+    long *system;
+    long *idle;
+    long *iowait;
+    long *irq;
+    long *softirq;
+    long *steal;
+} CpuCoreTable;
+
 /**
- * Max number of processors to check for
+ * Grow the arrays of a CpuCoreTable so that they can hold the given number of cores, keeping the values of the cores
+ * already stored, as the table may grow in the middle of parsing /proc/stat.
+ * @param table The table to resize. A zero-initialized table has no arrays allocated.
+ * @param capacity The number of cores the table must have room for, at least its current capacity
+ * @returns 0 if operation was successful, 1 otherwise
  */
-#define MAX_PROCESSORS 256
+extern int resizeCpuCoreTable(CpuCoreTable *table, int capacity);
+
 /**
- * Size of a single gigabyte in bytes (1024 ^ 3)
+ * Release the arrays held by a CpuCoreTable.
+ * @param table The table to free
  */
-#define GIGABYTE_BYTE_SIZE 1073741824
+extern void freeCpuCoreTable(CpuCoreTable *table);
+
 /**
- * Max length of output string dedicated for displaying the bars in the graphical representation of CPU usage
+ * Record a data point for CPU utilization by re-reading the already open /proc/stat, and store the data in a struct.
+ * The first line of the file, which contains the total cpu time, is parsed in a single pass without copying or tokenizing.
+ * @param statFile /proc/stat, as opened by openProcFile()
+ * @param cpuHistoryRow A pointer to a cpuDataSample struct used to store the parsed values
+ * @param coreTable If not NULL, the counters of each individual core are also parsed and stored in this table
+ * @returns 0 if operation was successful, 1 otherwise
  */
-#define GRAPHICS_MAX_CPU_BAR_COUNT 100
+extern int recordCpuStats(ProcFile *statFile, struct cpuDataSample *cpuHistoryRow, CpuCoreTable *coreTable);
+
 /**
- * Max length of output string dedicated for displaying the numbers in the graphical representation of CPU usage
+ * Open the files read by the CPU collector.
+ * @param options The settings given by command line arguments
+ * @returns The state of the collector, or NULL if it could not be set up
  */
-#define GRAPHICS_MAX_CPU_NUM_COUNT 32
+extern void *initCpuCollector(const MonitorOptions *options);
+
+/**
+ * Read the CPU utilization since the previous sample and since the first one, and the utilization of each core and NUMA node.
+ * @param state The state returned by initCpuCollector()
+ * @param thisSample Index of the sample, of which sample 0 only sets the baseline of the utilization
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+extern int sampleCpuCollector(void *state, long thisSample);
+
+/**
+ * Describe the record of the latest sample as the parts of a RECORD_TYPE_CPU record.
+ * @param state The state returned by initCpuCollector()
+ * @param parts Parts of the record, of which the first entry is left free for the header
+ * @param timestamp Where to store the monotonic time the values were read at
+ * @returns The number of entries in parts including the header
+ */
+extern int encodeCpuCollector(void *state, struct iovec *parts, double *timestamp);
 
 /**
- * Handle processing and printing of CPU utilization stats
- * @param numSamples The number of iterations specified by command line arguments
- * @param showGraphics Command line argument for whether to show memory use graphics
- * @param writeToChildFds Pipes used to read input data from main
- * @param readFromChildFds Pipes used to write input data to main
- * @param incomingDataPipe Pipe used to notify parent of data ready in readFromChildFds
+ * Close the files read by the CPU collector and release its state.
+ * @param state The state returned by initCpuCollector()
  */
-extern void displayCpu(int numSamples, bool showGraphics, int writeToChildFds[2], int readFromChildFds[2], int incomingDataPipe[2]);
+extern void teardownCpuCollector(void *state);
 
 #endif
@@ -1,220 +1,291 @@
-#include <sys/utsname.h>
-#include <sys/sysinfo.h>
-#include <unistd.h>
-#include <stdio.h>
-#include <string.h>
-#include <errno.h>
-#include <stdbool.h>
-#include <stdlib.h>
-#include <utmp.h>
-#include <inttypes.h>
-#include <sys/resource.h>
-
-#include "parseMemoryStats.h"
-
-/**
- * Representation of a single data point of memory usage, as set by recordCpuStats(), as well as a string representation to be printed according to convertMemoryToString()
- */
-typedef struct memorySample
-{
-    float physUsed, physTot, virtUsed, virtTot;
-    char *memoryOutput;
-} MemorySample;
-
-/**
- * Generate a human readable string representation of the memory utilization at the given sample data point and store its result in the same struct.
- * @param sample A memory utilization data point.
- * @param mem_unit The size of a memory unit, as given by sysinfo.mem_unit
- */
-void convertMemoryToString(MemorySample *sample, unsigned int mem_unit)
-{
-    // calculate the number of gigabytes
-    sample->memoryOutput = (char *)malloc(sizeof(char) * 63);
-    sprintf(sample->memoryOutput, "%.2f GB / %.2f GB -- %.2f GB / %.2f GB", sample->physUsed, sample->physTot, sample->virtUsed, sample->virtTot);
-    return;
-}
-
-/**
- * Retrieve memory information to calculate current utilization and store the result and memory statistics.
- * @param sample Pointer to memorySample point to store the current memory utilization.
- * @returns 0 if operation was successful, 1 otherwise
- */
-int computeMemory(MemorySample *sample)
-{
-    struct sysinfo sysinfoData;
-    int sysinfoStatus = sysinfo(&sysinfoData);
-    if (sysinfoStatus == 0)
-    {
-        // total physical ram
-        sample->physTot = sysinfoData.totalram / (float)GIGABYTE_BYTE_SIZE * sysinfoData.mem_unit;
-        // used physical ram
-        sample->physUsed = (sysinfoData.totalram - sysinfoData.freeram) / (float)GIGABYTE_BYTE_SIZE * sysinfoData.mem_unit;
-        // total virtual ram
-        sample->virtTot = (sysinfoData.totalswap + sysinfoData.totalram) / (float)GIGABYTE_BYTE_SIZE * sysinfoData.mem_unit;
-        // used virtual ram
-        sample->virtUsed = (sysinfoData.totalram - sysinfoData.freeram + sysinfoData.totalswap - sysinfoData.freeswap) / (float)GIGABYTE_BYTE_SIZE * sysinfoData.mem_unit;
-        // generate string with statistics
-        convertMemoryToString(sample, sysinfoData.mem_unit);
-    }
-    else if (sysinfoStatus == -1)
-    {
-        // On error
-        perror("Failed to read information from sysinfo()");
-        return 1;
-    }
-    return 0;
-}
-
-/**
- * Return a pointer to dynamically-allocated string representing the change in memory usage using graphical bars.
- */
-char *calculateDelta(MemorySample *previous, MemorySample *current)
-{
-    // allocate a string to store the result
-    char *deltaChange = (char *)malloc((GRAPHICS_MAX_BAR_COUNT + GRAPHICS_MAX_NUM_COUNT) * sizeof(char));
-    if (current == NULL)
-    {
-        // Error if current is null
-        snprintf(deltaChange, GRAPHICS_MAX_BAR_COUNT, "---");
-        return deltaChange;
-    }
-    else if (previous == NULL)
-    {
-        // First entry
-        snprintf(deltaChange, GRAPHICS_MAX_BAR_COUNT, "|o 0.00 (%.2f)", current->virtUsed);
-        return deltaChange;
-    }
-
-    // initialize the string to start with | and end with null terminator
-    deltaChange[0] = '|';
-    for (int i = 1; i < GRAPHICS_MAX_BAR_COUNT + GRAPHICS_MAX_NUM_COUNT - 1; i++)
-    {
-        deltaChange[i] = ' ';
-    }
-    deltaChange[GRAPHICS_MAX_BAR_COUNT + GRAPHICS_MAX_NUM_COUNT - 1] = '\0';
-
-    // calculate the net change in gigabytes, in absolute and percentage difference
-    float delta = current->virtUsed - previous->virtUsed;
-    float deltaPercentage = delta / current->virtTot;
-
-    // the maximum number of relative change bars we can display, while leaving space for starting bar (|), ending symbol (* or @) and null terminator
-    int maxChangeBars = GRAPHICS_MAX_BAR_COUNT - 3;
-
-    // if change was positive (more memory is being used)
-    if (deltaPercentage > 0)
-    {
-        int bars = (int)(deltaPercentage * maxChangeBars);
-        for (int i = 1; i <= bars; i++)
-        {
-            deltaChange[i] = '#';
-        }
-        deltaChange[bars + 1] = '*';
-        deltaChange[bars + 2] = '\0';
-    }
-    // if change was positive (less memory being used)
-    else if (deltaPercentage < 0)
-    {
-        int bars = (int)(-deltaPercentage * maxChangeBars);
-        for (int i = 1; i <= bars; i++)
-        {
-            deltaChange[i] = ':';
-        }
-        deltaChange[bars + 1] = '@';
-        deltaChange[bars + 2] = '\0';
-    }
-    else // change of zero
-    {
-        snprintf(deltaChange, GRAPHICS_MAX_BAR_COUNT, "|o 0.00 (%.2f)", current->virtUsed);
-        return deltaChange;
-    }
-
-    char deltaNum[GRAPHICS_MAX_NUM_COUNT] = "";
-    // print the change in memory numerically
-    snprintf(deltaNum, GRAPHICS_MAX_NUM_COUNT, " %.2f (%.2f)", delta, current->virtUsed);
-
-    // add the numerical stats at the end of the graphical representation
-    strncat(deltaChange, deltaNum, GRAPHICS_MAX_NUM_COUNT);
-    return deltaChange;
-}
-
-/**
- * Handle processing and printing of memory stats
- * @param numSamples The number of iterations specified by command line arguments
- * @param showGraphics Command line argument for whether to show memory use graphics
- * @param writeToChildFds Pipes used to read input data from main
- * @param readFromChildFds Pipes used to write input data to main
- * @param incomingDataPipe Pipe used to notify parent of data ready in readFromChildFds
- */
-void displayMemory(int numSamples, bool showGraphics, int writeToChildFds[2], int readFromChildFds[2], int incomingDataPipe[2])
-{
-    // store previously calculated memory data
-    struct memorySample memorySamples[numSamples + 1];
-
-    char outputString[4096]; 
-    int parentInfo, thisSample;
-
-    while (true) {
-
-        // get an instruction from the parent
-        read(writeToChildFds[FD_READ], &parentInfo, sizeof(int));
-        if (parentInfo != MEM_START_FLAG) {
-            // TODO: Remove before submitting
-            printf("Memory process ended.\n");
-            break;
-        }
-
-        // get the iteration number
-        read(writeToChildFds[FD_READ], &thisSample, sizeof(int)); 
-        
-        // Retrieve memory information from sysinfo
-        // DOCS: https://man7.org/linux/man-pages/man2/sysinfo.2.html
-        if (computeMemory(memorySamples + thisSample) != 0)
-        {
-            return;
-        }
-
-        if (thisSample == 0) continue;
-
-        if (showGraphics)
-        {
-            // print graphical representations
-            char *memoryGraphics = NULL;
-            if (thisSample == 1)
-            {
-                // if first sample, exclude previous data
-                memoryGraphics = calculateDelta(NULL, memorySamples + thisSample);
-            }
-            else
-            {
-                // for all other samples, pass two data points
-                memoryGraphics = calculateDelta(memorySamples + thisSample - 1, memorySamples + thisSample);
-            }
-            if (memoryGraphics == NULL)
-            {
-                fprintf(stderr, "Errored while showing memory graphics.");
-                return;
-            }
-            snprintf(outputString, 4096, "%s \t%s\n", (memorySamples + thisSample)->memoryOutput, memoryGraphics);
-        }
-        else
-        {
-            snprintf(outputString, 4096, "%s\n", (memorySamples + thisSample)->memoryOutput);
-        }
-
-        // communicate results back to parent
-        int outLen = strlen(outputString);
-        write(readFromChildFds[FD_WRITE], &outLen, sizeof(int)); 
-        write(readFromChildFds[FD_WRITE], outputString, sizeof(char) * (outLen + 1));
-        // printf("Notifying parent cpu");
-        int temp = MEM_DATA_ID; 
-        write(incomingDataPipe[FD_WRITE], &temp, sizeof(int)); // notify parent that memory data is available
-
-    }
-    close(readFromChildFds[FD_READ]);
-    close(readFromChildFds[FD_WRITE]);
-    close(writeToChildFds[FD_READ]);
-    close(writeToChildFds[FD_WRITE]);
-    close(incomingDataPipe[FD_READ]);
-    close(incomingDataPipe[FD_WRITE]);
-    exit(0);
-}
\ No newline at end of file
+#include <sys/utsname.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <utmp.h>
+#include <inttypes.h>
+#include <sys/resource.h>
+
+#include "procFile.h"
+#include "cgroupStats.h"
+#include "vmstatStats.h"
+#include "numaStats.h"
+#include "sampleTimer.h"
+#include "sampleRecord.h"
+#include "parseArguments.h"
+#include "parseMemoryStats.h"
+
+/**
+ * Keys of /proc/meminfo read on every sample, in the order of the MEMINFO_* slots
+ */
+static const char *const meminfoKeys[MEMINFO_KEY_COUNT] = {
+    "MemTotal", "MemFree", "MemAvailable", "Buffers", "Cached", "Shmem",
+    "Slab", "Dirty", "Writeback", "SwapTotal", "SwapFree"};
+
+/**
+ * Build the lookup of the keys of /proc/meminfo read on every sample.
+ * @param keyTable The lookup to build
+ */
+void initMeminfoKeyTable(ProcKeyTable *keyTable)
+{
+    initProcKeyTable(keyTable, meminfoKeys, MEMINFO_KEY_COUNT);
+}
+
+/**
+ * Read /proc/meminfo to calculate current utilization and store the result and memory statistics.
+ * Used memory excludes MemAvailable, so page cache and reclaimable slab that the kernel can drop are not counted as used.
+ * @param meminfoFile /proc/meminfo, kept open between samples
+ * @param keyTable Lookup of the keys built by initMeminfoKeyTable()
+ * @param sample Record to store the current memory utilization in
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+int computeMemory(ProcFile *meminfoFile, const ProcKeyTable *keyTable, MemoryRecord *sample)
+{
+    if (readProcFile(meminfoFile) != 0)
+    {
+        return 1;
+    }
+    unsigned long long values[MEMINFO_KEY_COUNT];
+    parseKeyedValues(keyTable, meminfoFile->buffer, 0, values, MEMINFO_KEY_COUNT);
+
+    // kernels before 3.14 have no MemAvailable, so fall back to counting free memory and cache as available
+    unsigned long long available = values[MEMINFO_AVAILABLE];
+    if (available == 0)
+    {
+        available = values[MEMINFO_FREE] + values[MEMINFO_BUFFERS] + values[MEMINFO_CACHED];
+    }
+    unsigned long long physUsed = values[MEMINFO_TOTAL] > available ? values[MEMINFO_TOTAL] - available : 0;
+    unsigned long long swapUsed = values[MEMINFO_SWAP_TOTAL] > values[MEMINFO_SWAP_FREE] ? values[MEMINFO_SWAP_TOTAL] - values[MEMINFO_SWAP_FREE] : 0;
+
+    // /proc/meminfo reports kilobytes, which are sent as they are and only converted when rendered
+    sample->physTotalKb = values[MEMINFO_TOTAL];
+    sample->physUsedKb = physUsed;
+    sample->virtTotalKb = values[MEMINFO_TOTAL] + values[MEMINFO_SWAP_TOTAL];
+    sample->virtUsedKb = physUsed + swapUsed;
+    sample->availableKb = available;
+    sample->cachedKb = values[MEMINFO_CACHED];
+    sample->buffersKb = values[MEMINFO_BUFFERS];
+    sample->shmemKb = values[MEMINFO_SHMEM];
+    sample->slabKb = values[MEMINFO_SLAB];
+    sample->dirtyKb = values[MEMINFO_DIRTY];
+    sample->writebackKb = values[MEMINFO_WRITEBACK];
+    return 0;
+}
+
+/**
+ * Replace the host memory usage of a sample with the usage of a cgroup, measured against the cgroup's limits.
+ * Used memory excludes inactive page cache, which the kernel reclaims before the cgroup would hit its limit.
+ * Where the cgroup has no limit, the host's totals from computeMemory() are kept as the bound.
+ * @param cgroup A cgroup opened with openCgroup() with hasMemory set
+ * @param sample Record already filled in by computeMemory()
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+int computeCgroupMemory(Cgroup *cgroup, MemoryRecord *sample)
+{
+    CgroupMemory memory;
+    if (readCgroupMemory(cgroup, &memory) != 0)
+    {
+        return 1;
+    }
+
+    // the files of a cgroup report bytes
+    unsigned long long inactiveFile = memory.stat[CGROUP_MEMORY_INACTIVE_FILE];
+    unsigned long long used = memory.current > inactiveFile ? memory.current - inactiveFile : 0;
+    uint64_t hostSwapKb = sample->virtTotalKb - sample->physTotalKb;
+
+    sample->flags |= RECORD_FLAG_CGROUP;
+    if (memory.limit != CGROUP_UNLIMITED)
+    {
+        sample->flags |= RECORD_FLAG_CGROUP_LIMITED;
+        sample->physTotalKb = memory.limit / KILOBYTE_BYTE_SIZE;
+    }
+    sample->limitKb = sample->physTotalKb;
+    sample->physUsedKb = used / KILOBYTE_BYTE_SIZE;
+    sample->virtTotalKb = sample->physTotalKb + (memory.swapLimit != CGROUP_UNLIMITED ? memory.swapLimit / KILOBYTE_BYTE_SIZE : hostSwapKb);
+    sample->virtUsedKb = (used + memory.swapCurrent) / KILOBYTE_BYTE_SIZE;
+    sample->availableKb = sample->physTotalKb > sample->physUsedKb ? sample->physTotalKb - sample->physUsedKb : 0;
+    sample->anonKb = memory.stat[CGROUP_MEMORY_ANON] / KILOBYTE_BYTE_SIZE;
+    sample->cachedKb = memory.stat[CGROUP_MEMORY_FILE] / KILOBYTE_BYTE_SIZE;
+    sample->buffersKb = 0;
+    sample->shmemKb = memory.stat[CGROUP_MEMORY_SHMEM] / KILOBYTE_BYTE_SIZE;
+    sample->slabKb = memory.stat[CGROUP_MEMORY_SLAB] / KILOBYTE_BYTE_SIZE;
+    sample->dirtyKb = memory.stat[CGROUP_MEMORY_DIRTY] / KILOBYTE_BYTE_SIZE;
+    sample->writebackKb = memory.stat[CGROUP_MEMORY_WRITEBACK] / KILOBYTE_BYTE_SIZE;
+    return 0;
+}
+
+/**
+ * State the memory collector keeps between samples
+ */
+typedef struct memoryCollector
+{
+    const MonitorOptions *options;
+    ProcFile meminfoFile;
+    ProcKeyTable meminfoKeyTable;
+    /**
+     * The cgroup, only open in cgroup mode when it has a memory controller
+     */
+    Cgroup cgroup;
+    bool useCgroup;
+    const char *cgroupName;
+    /**
+     * Paging and swap counters of the previous and current samples, swapped after every sample
+     */
+    Vmstat vmstat;
+    VmstatSample vmstatSamples[2];
+    VmstatSample *previousVmstat, *currentVmstat;
+    /**
+     * Memory of each NUMA node, which keeps its own previous read for the miss and foreign rates
+     */
+    bool showNuma;
+    NumaTopology numa;
+    NumaMemoryRecord *numaRecords;
+    MemoryRecord record;
+    double timestamp;
+} MemoryCollector;
+
+/**
+ * Open the files read by the memory collector.
+ * @param options The settings given by command line arguments
+ * @returns The state of the collector, or NULL if it could not be set up
+ */
+void *initMemoryCollector(const MonitorOptions *options)
+{
+    MemoryCollector *collector = (MemoryCollector *)calloc(1, sizeof(MemoryCollector));
+    if (collector == NULL)
+    {
+        perror("calloc");
+        return NULL;
+    }
+    collector->options = options;
+    if (openProcFile(&collector->meminfoFile, "/proc/meminfo", MEMINFO_BUFFER_SIZE) != 0)
+    {
+        return NULL;
+    }
+    initMeminfoKeyTable(&collector->meminfoKeyTable);
+
+    // in cgroup mode, the host's memory is still read for the totals of a cgroup without limits
+    collector->cgroupName = "";
+    if (options->useCgroup)
+    {
+        if (openCgroup(&collector->cgroup) != 0)
+        {
+            return NULL;
+        }
+        collector->cgroupName = collector->cgroup.name;
+        collector->useCgroup = collector->cgroup.hasMemory;
+        if (!collector->useCgroup)
+        {
+            closeCgroup(&collector->cgroup);
+        }
+    }
+
+    if (openVmstat(&collector->vmstat) != 0)
+    {
+        return NULL;
+    }
+    collector->previousVmstat = collector->vmstatSamples;
+    collector->currentVmstat = collector->vmstatSamples + 1;
+
+    collector->showNuma = options->showNuma;
+    if (collector->showNuma)
+    {
+        if (initNumaTopology(&collector->numa, true) != 0)
+        {
+            return NULL;
+        }
+        collector->numaRecords = (NumaMemoryRecord *)calloc(collector->numa.nodeCount > 0 ? collector->numa.nodeCount : 1, sizeof(NumaMemoryRecord));
+        if (collector->numaRecords == NULL)
+        {
+            perror("calloc");
+            return NULL;
+        }
+    }
+    return collector;
+}
+
+/**
+ * Read the memory utilization, paging rates and memory of each NUMA node.
+ * @param state The state returned by initMemoryCollector()
+ * @param thisSample Index of the sample, of which sample 0 only sets the baseline of the rates
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+int sampleMemoryCollector(void *state, long thisSample)
+{
+    MemoryCollector *collector = (MemoryCollector *)state;
+    MemoryRecord *record = &collector->record;
+
+    // Retrieve memory information from /proc/meminfo
+    // DOCS: https://man7.org/linux/man-pages/man5/proc_meminfo.5.html
+    memset(record, 0, sizeof(MemoryRecord));
+    collector->timestamp = getMonotonicSeconds();
+    if (computeMemory(&collector->meminfoFile, &collector->meminfoKeyTable, record) != 0 ||
+        (collector->useCgroup && computeCgroupMemory(&collector->cgroup, record) != 0) ||
+        readVmstat(&collector->vmstat, collector->currentVmstat) != 0 ||
+        (collector->showNuma && readNumaMemory(&collector->numa) != 0))
+    {
+        return 1;
+    }
+    if (thisSample > 0)
+    {
+        calculatePagingRates(collector->previousVmstat, collector->currentVmstat, record->pagingRates);
+        if (collector->showNuma)
+            fillNumaMemoryRecords(&collector->numa, collector->numaRecords);
+    }
+    VmstatSample *latestVmstat = collector->currentVmstat;
+    collector->currentVmstat = collector->previousVmstat;
+    collector->previousVmstat = latestVmstat;
+    return 0;
+}
+
+/**
+ * Describe the record of the latest sample as the parts of a RECORD_TYPE_MEMORY record.
+ * @param state The state returned by initMemoryCollector()
+ * @param parts Parts of the record, of which the first entry is left free for the header
+ * @param timestamp Where to store the monotonic time the values were read at
+ * @returns The number of entries in parts including the header
+ */
+int encodeMemoryCollector(void *state, struct iovec *parts, double *timestamp)
+{
+    MemoryCollector *collector = (MemoryCollector *)state;
+    MemoryRecord *record = &collector->record;
+    if (collector->options->useCgroup && !collector->useCgroup)
+    {
+        record->flags |= RECORD_FLAG_CGROUP_MISSING;
+    }
+    record->numaNodeCount = collector->showNuma ? collector->numa.nodeCount : 0;
+    record->cgroupNameLength = strlen(collector->cgroupName);
+
+    parts[1].iov_base = record;
+    parts[1].iov_len = sizeof(MemoryRecord);
+    parts[2].iov_base = collector->numaRecords;
+    parts[2].iov_len = sizeof(NumaMemoryRecord) * record->numaNodeCount;
+    parts[3].iov_base = (char *)collector->cgroupName;
+    parts[3].iov_len = sizeof(char) * (record->cgroupNameLength + 1);
+    *timestamp = collector->timestamp;
+    return 4;
+}
+
+/**
+ * Close the files read by the memory collector and release its state.
+ * @param state The state returned by initMemoryCollector()
+ */
+void teardownMemoryCollector(void *state)
+{
+    MemoryCollector *collector = (MemoryCollector *)state;
+    closeProcFile(&collector->meminfoFile);
+    closeVmstat(&collector->vmstat);
+    if (collector->useCgroup)
+    {
+        closeCgroup(&collector->cgroup);
+    }
+    if (collector->showNuma)
+    {
+        freeNumaTopology(&collector->numa);
+        free(collector->numaRecords);
+    }
+    free(collector);
+}
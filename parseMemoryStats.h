@@ -1,19 +1,41 @@
 #ifndef PARSE_MEMORY_H
 #define PARSE_MEMORY_H
 
+#include <sys/uio.h>
+
+#include "procFile.h"
+#include "parseArguments.h"
+
 #define GIGABYTE_BYTE_SIZE 1073741824
+#define KILOBYTE_BYTE_SIZE 1024
 #define GRAPHICS_MAX_BAR_COUNT 512
 #define GRAPHICS_MAX_NUM_COUNT 32
 
 /**
- * Flag used to start memory reading
+ * Size of the buffer /proc/meminfo is read into, several times its usual size
+ */
+#define MEMINFO_BUFFER_SIZE 8192
+
+/**
+ * Space reserved for each line of memory output, in bytes
  */
-#define MEM_START_FLAG 1
+#define MEMORY_OUTPUT_LENGTH 256
 
 /**
- * Flag used to indicate that data came from memory process
+ * Slots of the values read from /proc/meminfo, in kilobytes
  */
-#define MEM_DATA_ID 1
+#define MEMINFO_TOTAL 0
+#define MEMINFO_FREE 1
+#define MEMINFO_AVAILABLE 2
+#define MEMINFO_BUFFERS 3
+#define MEMINFO_CACHED 4
+#define MEMINFO_SHMEM 5
+#define MEMINFO_SLAB 6
+#define MEMINFO_DIRTY 7
+#define MEMINFO_WRITEBACK 8
+#define MEMINFO_SWAP_TOTAL 9
+#define MEMINFO_SWAP_FREE 10
+#define MEMINFO_KEY_COUNT 11
 
 #ifndef FD_WRITE
 #define FD_WRITE 1
@@ -23,14 +45,52 @@
 #define FD_READ 0
 #endif
 
+struct memoryRecord;
+
+/**
+ * Build the lookup of the keys of /proc/meminfo read on every sample.
+ * @param keyTable The lookup to build
+ */
+extern void initMeminfoKeyTable(ProcKeyTable *keyTable);
+
+/**
+ * Read /proc/meminfo to calculate current utilization and store the result and memory statistics.
+ * Used memory excludes MemAvailable, so page cache and reclaimable slab that the kernel can drop are not counted as used.
+ * @param meminfoFile /proc/meminfo, kept open between samples
+ * @param keyTable Lookup of the keys built by initMeminfoKeyTable()
+ * @param sample Record to store the current memory utilization in
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+extern int computeMemory(ProcFile *meminfoFile, const ProcKeyTable *keyTable, struct memoryRecord *sample);
+
+/**
+ * Open the files read by the memory collector.
+ * @param options The settings given by command line arguments
+ * @returns The state of the collector, or NULL if it could not be set up
+ */
+extern void *initMemoryCollector(const MonitorOptions *options);
+
+/**
+ * Read the memory utilization, paging rates and memory of each NUMA node.
+ * @param state The state returned by initMemoryCollector()
+ * @param thisSample Index of the sample, of which sample 0 only sets the baseline of the rates
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+extern int sampleMemoryCollector(void *state, long thisSample);
+
+/**
+ * Describe the record of the latest sample as the parts of a RECORD_TYPE_MEMORY record.
+ * @param state The state returned by initMemoryCollector()
+ * @param parts Parts of the record, of which the first entry is left free for the header
+ * @param timestamp Where to store the monotonic time the values were read at
+ * @returns The number of entries in parts including the header
+ */
+extern int encodeMemoryCollector(void *state, struct iovec *parts, double *timestamp);
+
 /**
- * Handle processing and printing of memory stats
- * @param numSamples The number of iterations specified by command line arguments
- * @param showGraphics Command line argument for whether to show memory use graphics
- * @param writeToChildFds Pipes used to read input data from main
- * @param readFromChildFds Pipes used to write input data to main
- * @param incomingDataPipe Pipe used to notify parent of data ready in readFromChildFds
+ * Close the files read by the memory collector and release its state.
+ * @param state The state returned by initMemoryCollector()
  */
-extern void displayMemory(int numSamples, bool showGraphics, int writeToChildFds[2], int readFromChildFds[2], int incomingDataPipe[2]);
+extern void teardownMemoryCollector(void *state);
 
 #endif 
@@ -0,0 +1,648 @@
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/resource.h>
+
+#include "heapCounter.h"
+#include "procFile.h"
+#include "sampleTimer.h"
+#include "sampleRecord.h"
+#include "parseArguments.h"
+#include "collectorRegistry.h"
+#include "parseProcessStats.h"
+#include "printUsers.h"
+
+/**
+ * Layout of a single entry returned by the getdents64 system call
+ */
+struct linuxDirent64
+{
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+/**
+ * Get the home slot of a pid in a table with the given number of slots.
+ * @param pid The process id
+ * @param capacity Number of slots in the table, a power of two
+ * @returns Index of the first slot to probe
+ */
+size_t hashPid(pid_t pid, size_t capacity)
+{
+    // Fibonacci hashing spreads consecutive pids across the table
+    return ((uint32_t)pid * 2654435761u) & (capacity - 1);
+}
+
+/**
+ * Find the slot of a pid in the table, which is either the slot holding the pid or the empty slot where it belongs.
+ * @param entries Slots of the table
+ * @param capacity Number of slots in the table, a power of two
+ * @param pid The process id to look for
+ * @returns Index of the slot
+ */
+size_t findProcessSlot(const ProcessEntry *entries, size_t capacity, pid_t pid)
+{
+    size_t index = hashPid(pid, capacity);
+    while (entries[index].pid != 0 && entries[index].pid != pid)
+    {
+        index = (index + 1) & (capacity - 1);
+    }
+    return index;
+}
+
+/**
+ * Double the number of slots in the table and move every process to its slot in the larger table.
+ * @param table The table to grow
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+int growProcessTable(ProcessTable *table)
+{
+    size_t capacity = table->capacity * 2;
+    noteHeapAllocation();
+    ProcessEntry *entries = (ProcessEntry *)calloc(capacity, sizeof(ProcessEntry));
+    if (entries == NULL)
+    {
+        perror("calloc");
+        return 1;
+    }
+    for (size_t i = 0; i < table->capacity; i++)
+    {
+        if (table->entries[i].pid != 0)
+        {
+            entries[findProcessSlot(entries, capacity, table->entries[i].pid)] = table->entries[i];
+        }
+    }
+    free(table->entries);
+    table->entries = entries;
+    table->capacity = capacity;
+    return 0;
+}
+
+/**
+ * Remove the process in the given slot, closing its stat file, and shift later entries of the same probe sequence back
+ * so lookups keep working without tombstones.
+ * @param table The table holding the process
+ * @param index Index of the slot to empty
+ */
+void removeProcessAt(ProcessTable *table, size_t index)
+{
+    ProcessEntry *entries = table->entries;
+    size_t mask = table->capacity - 1;
+    if (entries[index].statFd != -1)
+    {
+        close(entries[index].statFd);
+        table->openStatFds--;
+    }
+
+    size_t hole = index;
+    size_t next = (hole + 1) & mask;
+    while (entries[next].pid != 0)
+    {
+        size_t home = hashPid(entries[next].pid, table->capacity);
+        // move the entry into the hole unless its home slot lies cyclically between the hole and its current slot
+        bool homeBetween = hole <= next ? (hole < home && home <= next) : (hole < home || home <= next);
+        if (!homeBetween)
+        {
+            entries[hole] = entries[next];
+            hole = next;
+        }
+        next = (next + 1) & mask;
+    }
+    entries[hole].pid = 0;
+    entries[hole].statFd = -1;
+    table->count--;
+}
+
+/**
+ * Open /proc and set up an empty process table.
+ * @param table The table to initialize
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+int initProcessTable(ProcessTable *table)
+{
+    table->capacity = 1024;
+    table->count = 0;
+    table->generation = 0;
+    table->openStatFds = 0;
+    table->scanSeconds = 0;
+    table->ticksPerSecond = sysconf(_SC_CLK_TCK);
+    table->pageSize = sysconf(_SC_PAGESIZE);
+    table->entries = (ProcessEntry *)calloc(table->capacity, sizeof(ProcessEntry));
+    table->directoryBuffer = (char *)malloc(sizeof(char) * PROC_DIRECTORY_BUFFER_SIZE);
+    table->statBuffer = (char *)malloc(sizeof(char) * PROC_PID_STAT_BUFFER_SIZE);
+    if (table->entries == NULL || table->directoryBuffer == NULL || table->statBuffer == NULL)
+    {
+        perror("malloc");
+        return 1;
+    }
+
+    table->procFd = open("/proc", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (table->procFd == -1)
+    {
+        perror("open: /proc");
+        return 1;
+    }
+
+    // keep as many stat files open as the file descriptor limit allows, which is left as the user set it, so that the
+    // monitor never holds more descriptors than it was given
+    struct rlimit fileLimit;
+    table->maxOpenStatFds = 0;
+    if (getrlimit(RLIMIT_NOFILE, &fileLimit) == 0)
+    {
+        if (fileLimit.rlim_cur > RESERVED_FILE_DESCRIPTORS)
+        {
+            rlim_t available = fileLimit.rlim_cur - RESERVED_FILE_DESCRIPTORS;
+            table->maxOpenStatFds = available > INT32_MAX ? INT32_MAX : (int)available;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Read /proc/[pid]/stat of a process into the table's stat buffer, using the file kept open for it if there is one.
+ * A stat file that is not kept open is opened, and kept open if the file descriptor budget allows.
+ * @param table The table holding the process
+ * @param entry The process to read
+ * @returns Number of bytes read, -1 if the process no longer exists, or -2 if the file could not be opened for another
+ * reason, such as running out of file descriptors
+ */
+ssize_t readProcessStatFile(ProcessTable *table, ProcessEntry *entry)
+{
+    if (entry->statFd != -1)
+    {
+        ssize_t bytesRead = pread(entry->statFd, table->statBuffer, PROC_PID_STAT_BUFFER_SIZE - 1, 0);
+        if (bytesRead > 0)
+            return bytesRead;
+        // the process that was opened has exited, even if its pid has been reused since
+        close(entry->statFd);
+        entry->statFd = -1;
+        table->openStatFds--;
+        return -1;
+    }
+
+    char path[32];
+    snprintf(path, sizeof(path), "%d/stat", entry->pid);
+    int fd = openat(table->procFd, path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1 && (errno == ENOENT || errno == ESRCH))
+        return -1;
+    if (fd == -1)
+    {
+        // EMFILE and the like say nothing about the process, so they must not make it look like it exited
+        perror("openat: /proc/[pid]/stat");
+        return -2;
+    }
+    ssize_t bytesRead = pread(fd, table->statBuffer, PROC_PID_STAT_BUFFER_SIZE - 1, 0);
+    if (bytesRead > 0 && table->openStatFds < table->maxOpenStatFds)
+    {
+        entry->statFd = fd;
+        table->openStatFds++;
+    }
+    else
+    {
+        close(fd);
+    }
+    return bytesRead > 0 ? bytesRead : -1;
+}
+
+/**
+ * Re-read the CPU time and memory of a process from /proc/[pid]/stat.
+ * @param table The table holding the process
+ * @param entry The process to read
+ * @param isNew Whether the process was added to the table during this scan
+ * @returns 0 if operation was successful, 1 if the process no longer exists, or -1 if its stat file could not be opened
+ */
+int readProcessStats(ProcessTable *table, ProcessEntry *entry, bool isNew)
+{
+    ssize_t length = readProcessStatFile(table, entry);
+    if (length == -2)
+        return -1;
+    if (length == -1)
+        return 1;
+    char *contents = table->statBuffer;
+    contents[length] = '\0';
+
+    // the name is enclosed in parentheses and may itself contain spaces or parentheses, so find the last ')'
+    char *nameStart = strchr(contents, '(');
+    char *nameEnd = strrchr(contents, ')');
+    if (nameStart == NULL || nameEnd == NULL || nameEnd < nameStart)
+        return 1;
+    size_t nameLength = nameEnd - nameStart - 1;
+    if (nameLength >= PROCESS_NAME_LENGTH)
+        nameLength = PROCESS_NAME_LENGTH - 1;
+    memcpy(entry->name, nameStart + 1, nameLength);
+    entry->name[nameLength] = '\0';
+
+    // fields are numbered from 1 as in proc(5); the cursor starts at field 3 (state)
+    const char *cursor = nameEnd + 1;
+    skipField(&cursor);
+    for (int field = 4; field < 14; field++)
+        skipField(&cursor);
+    unsigned long long ticks = scanUnsigned(&cursor);
+    ticks += scanUnsigned(&cursor);
+    for (int field = 16; field < 22; field++)
+        skipField(&cursor);
+    unsigned long long startTime = scanUnsigned(&cursor);
+    skipField(&cursor);
+    entry->rssPages = scanUnsigned(&cursor);
+
+    if (isNew || startTime != entry->startTime || ticks < entry->ticks)
+    {
+        // nothing to compare against for a new process or a reused pid
+        entry->deltaTicks = 0;
+        entry->deltaSeconds = 0;
+        struct stat statInfo;
+        char path[32];
+        snprintf(path, sizeof(path), "%d", entry->pid);
+        entry->uid = fstatat(table->procFd, path, &statInfo, 0) == 0 ? statInfo.st_uid : (uid_t)-1;
+    }
+    else
+    {
+        entry->deltaTicks = ticks - entry->ticks;
+        entry->deltaSeconds = table->scanSeconds - entry->readSeconds;
+    }
+    entry->ticks = ticks;
+    entry->startTime = startTime;
+    entry->readSeconds = table->scanSeconds;
+    return 0;
+}
+
+/**
+ * List /proc and update the table: new processes are added, processes that exited are removed, and the CPU time
+ * and memory of each process are re-read. Every process is read on every scan, through the /proc/[pid]/stat file kept
+ * open for it, so that a process that starts using CPU time shows it in the very next scan.
+ * @param table A table set up by initProcessTable()
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+int scanProcesses(ProcessTable *table)
+{
+    table->scanSeconds = getMonotonicSeconds();
+    table->generation++;
+
+    // list /proc again from the start through the same directory handle
+    if (lseek(table->procFd, 0, SEEK_SET) == -1)
+    {
+        perror("lseek: /proc");
+        return 1;
+    }
+    while (true)
+    {
+        long bytesRead = syscall(SYS_getdents64, table->procFd, table->directoryBuffer, PROC_DIRECTORY_BUFFER_SIZE);
+        if (bytesRead == -1)
+        {
+            perror("getdents64: /proc");
+            return 1;
+        }
+        if (bytesRead == 0)
+            break;
+
+        for (long offset = 0; offset < bytesRead;)
+        {
+            struct linuxDirent64 *directoryEntry = (struct linuxDirent64 *)(table->directoryBuffer + offset);
+            offset += directoryEntry->d_reclen;
+
+            // only the numeric entries of /proc are processes
+            const char *cursor = directoryEntry->d_name;
+            if (*cursor < '0' || *cursor > '9')
+                continue;
+            pid_t pid = scanUnsigned(&cursor);
+            if (*cursor != '\0' || pid <= 0)
+                continue;
+
+            if ((table->count + 1) * 2 > table->capacity && growProcessTable(table) != 0)
+                return 1;
+            size_t index = findProcessSlot(table->entries, table->capacity, pid);
+            ProcessEntry *entry = table->entries + index;
+            bool isNew = entry->pid == 0;
+            if (isNew)
+            {
+                memset(entry, 0, sizeof(ProcessEntry));
+                entry->pid = pid;
+                entry->statFd = -1;
+                table->count++;
+            }
+            entry->generation = table->generation;
+
+            int readResult = readProcessStats(table, entry, isNew);
+            if (readResult == -1)
+                return 1;
+            if (readResult != 0)
+            {
+                // exited between listing and reading, so leave it for removal below
+                entry->generation = table->generation - 1;
+            }
+        }
+    }
+
+    // remove every process that was not listed or could not be read during this scan
+    for (size_t i = 0; i < table->capacity; i++)
+    {
+        while (table->entries[i].pid != 0 && table->entries[i].generation != table->generation)
+        {
+            // removal may shift another entry into this slot, so check the slot again
+            removeProcessAt(table, i);
+        }
+    }
+    return 0;
+}
+
+/**
+ * Calculate the CPU utilization of a process between its two latest reads, where 100 is one fully used core.
+ * @param table The table holding the process
+ * @param entry The process
+ * @returns Percentage CPU utilization
+ */
+float processCpuUsage(const ProcessTable *table, const ProcessEntry *entry)
+{
+    if (entry->deltaSeconds <= 0)
+        return 0.0;
+    return entry->deltaTicks / (entry->deltaSeconds * table->ticksPerSecond) * 100;
+}
+
+/**
+ * Close every file held by the table and release its memory.
+ * @param table A table set up by initProcessTable()
+ */
+void freeProcessTable(ProcessTable *table)
+{
+    for (size_t i = 0; i < table->capacity; i++)
+    {
+        if (table->entries[i].pid != 0 && table->entries[i].statFd != -1)
+            close(table->entries[i].statFd);
+    }
+    if (table->procFd != -1)
+        close(table->procFd);
+    free(table->entries);
+    free(table->directoryBuffer);
+    free(table->statBuffer);
+    table->entries = NULL;
+    table->directoryBuffer = NULL;
+    table->statBuffer = NULL;
+    table->count = 0;
+    table->openStatFds = 0;
+}
+
+/**
+ * Order processes by decreasing CPU time used since their previous read, breaking ties by pid.
+ * @returns Negative if a ranks higher than b, positive if lower
+ */
+int compareProcessCpu(const ProcessEntry *a, const ProcessEntry *b)
+{
+    // compare the rate rather than raw ticks, since processes first seen in this scan have not been read over an interval
+    double rateA = a->deltaSeconds > 0 ? a->deltaTicks / a->deltaSeconds : 0;
+    double rateB = b->deltaSeconds > 0 ? b->deltaTicks / b->deltaSeconds : 0;
+    if (rateA != rateB)
+        return rateA > rateB ? -1 : 1;
+    return a->pid - b->pid;
+}
+
+/**
+ * Order processes by decreasing resident set size, breaking ties by pid.
+ * @returns Negative if a ranks higher than b, positive if lower
+ */
+int compareProcessMemory(const ProcessEntry *a, const ProcessEntry *b)
+{
+    if (a->rssPages != b->rssPages)
+        return a->rssPages > b->rssPages ? -1 : 1;
+    return a->pid - b->pid;
+}
+
+/**
+ * Rearrange the processes so that the highest ranked topCount of them come first, in ranked order.
+ * Uses quickselect so that only the selected processes are fully sorted, rather than every process.
+ * @param processes Array of processes to rearrange
+ * @param count Number of processes in the array
+ * @param topCount Number of highest ranked processes to select
+ * @param compare Function ranking two processes, returning negative if the first ranks higher
+ */
+void selectTopProcesses(ProcessEntry **processes, size_t count, size_t topCount, int (*compare)(const ProcessEntry *, const ProcessEntry *))
+{
+    if (topCount > count)
+        topCount = count;
+    if (topCount == 0)
+        return;
+
+    // partition until the first topCount slots hold the highest ranked processes, in any order
+    size_t low = 0, high = count - 1;
+    while (low < high)
+    {
+        ProcessEntry *pivot = processes[low + (high - low) / 2];
+        size_t i = low, j = high;
+        while (i <= j)
+        {
+            while (compare(processes[i], pivot) < 0)
+                i++;
+            while (compare(processes[j], pivot) > 0)
+                j--;
+            if (i <= j)
+            {
+                ProcessEntry *temp = processes[i];
+                processes[i] = processes[j];
+                processes[j] = temp;
+                i++;
+                if (j == 0)
+                    break;
+                j--;
+            }
+        }
+        if (topCount - 1 <= j)
+            high = j;
+        else if (topCount - 1 >= i)
+            low = i;
+        else
+            break;
+    }
+
+    // insertion sort the few selected processes into ranked order
+    for (size_t i = 1; i < topCount; i++)
+    {
+        ProcessEntry *current = processes[i];
+        size_t j = i;
+        while (j > 0 && compare(current, processes[j - 1]) < 0)
+        {
+            processes[j] = processes[j - 1];
+            j--;
+        }
+        processes[j] = current;
+    }
+}
+
+/**
+ * Store the given processes in records.
+ * @param table The table holding the processes
+ * @param processes The processes to store, in order
+ * @param count Number of processes to store
+ * @param records Array of count records to fill in
+ */
+void fillProcessRecords(const ProcessTable *table, ProcessEntry **processes, size_t count, ProcessRecord *records)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        memset(records + i, 0, sizeof(ProcessRecord));
+        records[i].pid = processes[i]->pid;
+        records[i].cpuUsage = processCpuUsage(table, processes[i]);
+        records[i].rssBytes = (uint64_t)processes[i]->rssPages * table->pageSize;
+        memcpy(records[i].name, processes[i]->name, PROCESS_NAME_LENGTH);
+    }
+}
+
+/**
+ * State the top processes collector keeps between samples
+ */
+typedef struct processCollector
+{
+    size_t topCount;
+    ProcessTable table;
+    /**
+     * Candidates for selection, which only grows when the number of processes does
+     */
+    ProcessEntry **candidates;
+    size_t candidateCapacity;
+    /**
+     * The processes ranked by CPU followed by the processes ranked by memory
+     */
+    ProcessRecord *processRecords;
+    /**
+     * The usage of each owner, sent along for the user collector when the usage of each user is shown
+     */
+    bool countOwners;
+    UserUsageMap ownerUsage;
+    OwnerUsageRecord *ownerRecords;
+    size_t ownerRecordCapacity;
+    ProcessesRecord record;
+} ProcessCollector;
+
+/**
+ * Set up the table of processes read by the top processes collector.
+ * @param options The settings given by command line arguments
+ * @returns The state of the collector, or NULL if it could not be set up
+ */
+void *initProcessCollector(const MonitorOptions *options)
+{
+    ProcessCollector *collector = (ProcessCollector *)calloc(1, sizeof(ProcessCollector));
+    if (collector == NULL)
+    {
+        perror("calloc");
+        return NULL;
+    }
+    collector->topCount = options->topProcesses;
+    collector->countOwners = collectorRegistry[USER_COLLECTOR].isEnabled(options) && options->showUserUsage;
+    collector->processRecords = (ProcessRecord *)malloc(sizeof(ProcessRecord) * (collector->topCount * 2 + 1));
+    if (collector->processRecords == NULL || initProcessTable(&collector->table) != 0)
+    {
+        return NULL;
+    }
+    return collector;
+}
+
+/**
+ * Scan the processes and rank the ones using the most CPU and memory.
+ * @param state The state returned by initProcessCollector()
+ * @param thisSample Index of the sample, of which sample 0 only sets the baseline of the CPU times
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+int sampleProcessCollector(void *state, long thisSample)
+{
+    ProcessCollector *collector = (ProcessCollector *)state;
+    ProcessTable *table = &collector->table;
+    if (scanProcesses(table) != 0)
+    {
+        return 1;
+    }
+    if (thisSample == 0)
+        return 0;
+
+    if (collector->candidateCapacity < table->count)
+    {
+        collector->candidateCapacity = table->capacity;
+        noteHeapAllocation();
+        collector->candidates = (ProcessEntry **)realloc(collector->candidates, sizeof(ProcessEntry *) * collector->candidateCapacity);
+        if (collector->candidates == NULL)
+        {
+            perror("realloc");
+            return 1;
+        }
+    }
+    ProcessEntry **candidates = collector->candidates;
+    size_t candidateCount = 0;
+    for (size_t i = 0; i < table->capacity; i++)
+    {
+        if (table->entries[i].pid != 0)
+            candidates[candidateCount++] = table->entries + i;
+    }
+    size_t topCount = collector->topCount;
+    size_t listed = topCount < candidateCount ? topCount : candidateCount;
+    collector->record.processCount = candidateCount;
+    collector->record.listedCount = listed;
+
+    selectTopProcesses(candidates, candidateCount, topCount, compareProcessCpu);
+    fillProcessRecords(table, candidates, listed, collector->processRecords);
+    selectTopProcesses(candidates, candidateCount, topCount, compareProcessMemory);
+    fillProcessRecords(table, candidates, listed, collector->processRecords + listed);
+
+    // the user collector takes the usage of each logged in user from these totals rather than scanning /proc itself
+    collector->record.ownerCount = 0;
+    if (collector->countOwners)
+    {
+        if (aggregateUserUsage(&collector->ownerUsage, table) != 0)
+            return 1;
+        if (collector->ownerRecordCapacity < collector->ownerUsage.count)
+        {
+            collector->ownerRecordCapacity = collector->ownerUsage.capacity;
+            noteHeapAllocation();
+            collector->ownerRecords = (OwnerUsageRecord *)realloc(collector->ownerRecords, sizeof(OwnerUsageRecord) * collector->ownerRecordCapacity);
+            if (collector->ownerRecords == NULL)
+            {
+                perror("realloc");
+                return 1;
+            }
+        }
+        fillOwnerUsageRecords(&collector->ownerUsage, table->pageSize, collector->ownerRecords, &collector->record.ownerCount);
+    }
+    return 0;
+}
+
+/**
+ * Describe the record of the latest sample as the parts of a RECORD_TYPE_PROCESSES record.
+ * @param state The state returned by initProcessCollector()
+ * @param parts Parts of the record, of which the first entry is left free for the header
+ * @param timestamp Where to store the monotonic time the processes were scanned at
+ * @returns The number of entries in parts including the header
+ */
+int encodeProcessCollector(void *state, struct iovec *parts, double *timestamp)
+{
+    ProcessCollector *collector = (ProcessCollector *)state;
+    parts[1].iov_base = &collector->record;
+    parts[1].iov_len = sizeof(ProcessesRecord);
+    parts[2].iov_base = collector->processRecords;
+    parts[2].iov_len = sizeof(ProcessRecord) * collector->record.listedCount * 2;
+    parts[3].iov_base = collector->ownerRecords;
+    parts[3].iov_len = sizeof(OwnerUsageRecord) * collector->record.ownerCount;
+    *timestamp = collector->table.scanSeconds;
+    return 4;
+}
+
+/**
+ * Release the table of processes and the state of the top processes collector.
+ * @param state The state returned by initProcessCollector()
+ */
+void teardownProcessCollector(void *state)
+{
+    ProcessCollector *collector = (ProcessCollector *)state;
+    free(collector->candidates);
+    free(collector->processRecords);
+    free(collector->ownerUsage.entries);
+    free(collector->ownerRecords);
+    freeProcessTable(&collector->table);
+    free(collector);
+}
@@ -0,0 +1,208 @@
+#ifndef PARSE_PROCESS_STATS_H
+#define PARSE_PROCESS_STATS_H
+
+#include <stdbool.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include "parseArguments.h"
+
+/**
+ * Length of a process name as stored by the kernel, including the null terminator
+ */
+#define PROCESS_NAME_LENGTH 16
+
+/**
+ * Size of the buffer used to list the entries of /proc
+ */
+#define PROC_DIRECTORY_BUFFER_SIZE 65536
+
+/**
+ * Size of the buffer that a single /proc/[pid]/stat file is read into
+ */
+#define PROC_PID_STAT_BUFFER_SIZE 1024
+
+/**
+ * Number of file descriptors left free for other uses when deciding how many /proc/[pid]/stat files to keep open
+ */
+#define RESERVED_FILE_DESCRIPTORS 64
+
+/**
+ * Space reserved in the top processes output for each listed process, in bytes
+ */
+#define PROCESS_OUTPUT_LENGTH 96
+
+#ifndef FD_WRITE
+#define FD_WRITE 1
+#endif
+
+#ifndef FD_READ
+#define FD_READ 0
+#endif
+
+/**
+ * The state of a single process carried between scans of /proc, keyed by pid in a ProcessTable
+ */
+typedef struct processEntry
+{
+    /**
+     * Process id, or 0 if this slot of the table is empty
+     */
+    pid_t pid;
+    /**
+     * Owner of the process, read once when the process is first seen
+     */
+    uid_t uid;
+    /**
+     * The scan in which the process was last listed in /proc
+     */
+    unsigned int generation;
+    /**
+     * /proc/[pid]/stat kept open between scans, or -1 if it is opened for each read
+     */
+    int statFd;
+    /**
+     * Time the process started after boot, in clock ticks, used to tell a reused pid apart from the original process
+     */
+    unsigned long long startTime;
+    /**
+     * Total user and system CPU time of the process, in clock ticks, as of the last read
+     */
+    unsigned long long ticks;
+    /**
+     * CPU time used since the previous read of the process, in clock ticks
+     */
+    unsigned long long deltaTicks;
+    /**
+     * Monotonic time of the last read of the process, in seconds
+     */
+    double readSeconds;
+    /**
+     * Seconds between the two latest reads of the process, or 0 if it has only been read once
+     */
+    double deltaSeconds;
+    /**
+     * Resident set size, in pages
+     */
+    long rssPages;
+    /**
+     * Name of the executable, as shown in /proc/[pid]/stat
+     */
+    char name[PROCESS_NAME_LENGTH];
+} ProcessEntry;
+
+/**
+ * Open-addressing hash table of every process on the system, updated incrementally by scanProcesses()
+ */
+typedef struct processTable
+{
+    /**
+     * Slots of the table, a power of two in number
+     */
+    ProcessEntry *entries;
+    /**
+     * Number of slots in entries
+     */
+    size_t capacity;
+    /**
+     * Number of slots holding a process
+     */
+    size_t count;
+    /**
+     * /proc, kept open so it can be listed again and its entries opened relative to it
+     */
+    int procFd;
+    /**
+     * Reusable buffer for the entries of /proc returned by getdents64()
+     */
+    char *directoryBuffer;
+    /**
+     * Reusable buffer for the contents of a single /proc/[pid]/stat file
+     */
+    char *statBuffer;
+    /**
+     * Number of the current scan, stored in each entry listed during that scan
+     */
+    unsigned int generation;
+    /**
+     * Number of /proc/[pid]/stat files currently kept open
+     */
+    int openStatFds;
+    /**
+     * Max number of /proc/[pid]/stat files to keep open, based on the file descriptor limit
+     */
+    int maxOpenStatFds;
+    /**
+     * Monotonic time of the latest scan, in seconds
+     */
+    double scanSeconds;
+    /**
+     * Number of clock ticks per second, the unit of CPU time in /proc/[pid]/stat
+     */
+    long ticksPerSecond;
+    /**
+     * Size of a memory page in bytes, the unit of resident set size in /proc/[pid]/stat
+     */
+    long pageSize;
+} ProcessTable;
+
+/**
+ * Open /proc and set up an empty process table.
+ * @param table The table to initialize
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+extern int initProcessTable(ProcessTable *table);
+
+/**
+ * List /proc and update the table: new processes are added, processes that exited are removed, and the CPU time
+ * and memory of each process are re-read.
+ * @param table A table set up by initProcessTable()
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+extern int scanProcesses(ProcessTable *table);
+
+/**
+ * Calculate the CPU utilization of a process between its two latest reads, where 100 is one fully used core.
+ * @param table The table holding the process
+ * @param entry The process
+ * @returns Percentage CPU utilization
+ */
+extern float processCpuUsage(const ProcessTable *table, const ProcessEntry *entry);
+
+/**
+ * Close every file held by the table and release its memory.
+ * @param table A table set up by initProcessTable()
+ */
+extern void freeProcessTable(ProcessTable *table);
+
+/**
+ * Set up the table of processes read by the top processes collector.
+ * @param options The settings given by command line arguments
+ * @returns The state of the collector, or NULL if it could not be set up
+ */
+extern void *initProcessCollector(const MonitorOptions *options);
+
+/**
+ * Scan the processes and rank the ones using the most CPU and memory.
+ * @param state The state returned by initProcessCollector()
+ * @param thisSample Index of the sample, of which sample 0 only sets the baseline of the CPU times
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+extern int sampleProcessCollector(void *state, long thisSample);
+
+/**
+ * Describe the record of the latest sample as the parts of a RECORD_TYPE_PROCESSES record.
+ * @param state The state returned by initProcessCollector()
+ * @param parts Parts of the record, of which the first entry is left free for the header
+ * @param timestamp Where to store the monotonic time the processes were scanned at
+ * @returns The number of entries in parts including the header
+ */
+extern int encodeProcessCollector(void *state, struct iovec *parts, double *timestamp);
+
+/**
+ * Release the table of processes and the state of the top processes collector.
+ * @param state The state returned by initProcessCollector()
+ */
+extern void teardownProcessCollector(void *state);
+
+#endif
@@ -1,68 +1,644 @@
-#include <utmp.h>
-#include <stdio.h>
-#include <unistd.h>
-#include <stdlib.h>
-#include <string.h>
-#include <stdbool.h>
-
-#include "printUsers.h"
-
-/**
- * Handle processing and printing of connected user information.
- * @param writeToChildFds Pipes used to read input data from main
- * @param readFromChildFds Pipes used to write input data to main
- * @param incomingDataPipe Pipe used to notify parent of data ready in readFromChildFds
- */
-void printUsers(int writeToChildFds[2], int readFromChildFds[2], int incomingDataPipe[2])
-{
-    int outLen = 0;
-    char outputString[4096] = "";
-    int parentInfo, thisSample;
-
-    while (true) {
-        // get an instruction from the parent
-        read(writeToChildFds[FD_READ], &parentInfo, sizeof(int));
-        if (parentInfo != USER_START_FLAG) {
-            // TODO: Remove before submitting
-            printf("User process ended.\n");
-            break;
-        }
-
-        read(writeToChildFds[FD_READ], &thisSample, sizeof(int));
-        if (thisSample == 0) {
-            continue;
-        }
-
-        struct utmp *data = getutent();
-        while (data != NULL)
-        {
-            if (data->ut_type == USER_PROCESS)
-            {
-                snprintf(outputString, 4096, "%s\t %s (%s)\n", data->ut_user, data->ut_line, data->ut_host);
-                outLen = strlen(outputString);
-                if (outLen > 0) {
-                    write(readFromChildFds[FD_WRITE], &outLen, sizeof(int)); 
-                    write(readFromChildFds[FD_WRITE], outputString, sizeof(char) * (outLen + 1));
-                }
-            }
-            data = getutent();
-        }
-
-        outLen = 0;
-        write(readFromChildFds[FD_WRITE], &outLen, sizeof(int)); 
-
-        int temp = USER_DATA_ID; 
-        write(incomingDataPipe[FD_WRITE], &temp, sizeof(int)); // notify parent that memory data is available
-
-        // close the currently open utmp file
-        endutent();
-    }
-    exit(0);
-    close(readFromChildFds[FD_READ]);
-    close(readFromChildFds[FD_WRITE]);
-    close(writeToChildFds[FD_READ]);
-    close(writeToChildFds[FD_WRITE]);
-    close(incomingDataPipe[FD_READ]);
-    close(incomingDataPipe[FD_WRITE]);
-}
-
+#include <utmp.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <stdint.h>
+#include <pwd.h>
+#include <sys/inotify.h>
+
+#include "heapCounter.h"
+#include "parseProcessStats.h"
+#include "sampleRecord.h"
+#include "sampleTimer.h"
+#include "collectorRegistry.h"
+#include "printUsers.h"
+
+/**
+ * A logged in session read from utmp
+ */
+typedef struct userSession
+{
+    /**
+     * Id sent to the parent when the session was first seen, which identifies the session when it is removed
+     */
+    int id;
+    /**
+     * Owner of the session, looked up by name when the session is first seen, or -1 if the name is unknown
+     */
+    uid_t uid;
+    pid_t pid;
+    char user[UT_NAMESIZE + 1];
+    char line[UT_LINESIZE + 1];
+    char host[UT_HOSTSIZE + 1];
+} UserSession;
+
+/**
+ * The sessions found by a scan of utmp, sorted by compareUserSessions()
+ */
+typedef struct userSessionTable
+{
+    UserSession *sessions;
+    int count;
+    int capacity;
+} UserSessionTable;
+
+/**
+ * The sessions added and removed since the previous record, sent together in the next record
+ */
+typedef struct userSessionChanges
+{
+    UserSessionRecord *added;
+    int addedCount;
+    int addedCapacity;
+    /**
+     * Ids of the removed sessions
+     */
+    int32_t *removed;
+    int removedCount;
+    int removedCapacity;
+} UserSessionChanges;
+
+/**
+ * Watch on the directory holding utmp, which reports utmp being written, created or replaced by a rename
+ */
+typedef struct utmpWatch
+{
+    /**
+     * The inotify instance, or -1 if utmp is rescanned on every sample instead
+     */
+    int fd;
+    /**
+     * Name of utmp within the watched directory
+     */
+    const char *name;
+} UtmpWatch;
+
+/**
+ * Order sessions by terminal, then process, user and host, so that two scans can be compared in a single pass.
+ * @param a Pointer to the first UserSession
+ * @param b Pointer to the second UserSession
+ * @returns Negative if a comes first, positive if b comes first, 0 if they are the same session
+ */
+int compareUserSessions(const void *a, const void *b)
+{
+    const UserSession *first = (const UserSession *)a, *second = (const UserSession *)b;
+    int result = strcmp(first->line, second->line);
+    if (result != 0)
+        return result;
+    if (first->pid != second->pid)
+        return first->pid < second->pid ? -1 : 1;
+    result = strcmp(first->user, second->user);
+    if (result != 0)
+        return result;
+    return strcmp(first->host, second->host);
+}
+
+/**
+ * Copy a fixed size utmp field, which is not null terminated when it fills the field.
+ * @param destination Buffer of fieldLength + 1 bytes
+ * @param field The utmp field
+ * @param fieldLength Size of the field in bytes
+ */
+void copyUtmpField(char *destination, const char *field, size_t fieldLength)
+{
+    size_t length = strnlen(field, fieldLength);
+    memcpy(destination, field, length);
+    destination[length] = '\0';
+}
+
+/**
+ * Read every logged in session from utmp into a table and sort it.
+ * @param table Table to store the sessions in, replacing its contents
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+int scanUserSessions(UserSessionTable *table)
+{
+    table->count = 0;
+    setutent();
+    struct utmp *data = getutent();
+    while (data != NULL)
+    {
+        if (data->ut_type == USER_PROCESS)
+        {
+            if (table->count == table->capacity)
+            {
+                int capacity = table->capacity > 0 ? table->capacity * 2 : 64;
+                noteHeapAllocation();
+                UserSession *larger = (UserSession *)realloc(table->sessions, sizeof(UserSession) * capacity);
+                if (larger == NULL)
+                {
+                    perror("realloc");
+                    endutent();
+                    return 1;
+                }
+                table->sessions = larger;
+                table->capacity = capacity;
+            }
+            UserSession *session = table->sessions + table->count++;
+            session->id = 0;
+            session->pid = data->ut_pid;
+            copyUtmpField(session->user, data->ut_user, UT_NAMESIZE);
+            copyUtmpField(session->line, data->ut_line, UT_LINESIZE);
+            copyUtmpField(session->host, data->ut_host, UT_HOSTSIZE);
+        }
+        data = getutent();
+    }
+    // close the currently open utmp file, so a replaced utmp is opened on the next scan
+    endutent();
+    // the session array is NULL until a session is seen, and qsort() must not be given a NULL array
+    if (table->count > 1)
+        qsort(table->sessions, table->count, sizeof(UserSession), compareUserSessions);
+    return 0;
+}
+
+/**
+ * Add a session that was added or removed to the changes of the next record.
+ * @param changes The changes since the previous record
+ * @param added Whether the session was added rather than removed
+ * @param session The session that was added or removed
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+int addUserSessionChange(UserSessionChanges *changes, bool added, const UserSession *session)
+{
+    if (!added)
+    {
+        if (changes->removedCount == changes->removedCapacity)
+        {
+            int capacity = changes->removedCapacity > 0 ? changes->removedCapacity * 2 : 64;
+            noteHeapAllocation();
+            int32_t *larger = (int32_t *)realloc(changes->removed, sizeof(int32_t) * capacity);
+            if (larger == NULL)
+            {
+                perror("realloc");
+                return 1;
+            }
+            changes->removed = larger;
+            changes->removedCapacity = capacity;
+        }
+        changes->removed[changes->removedCount++] = session->id;
+        return 0;
+    }
+
+    if (changes->addedCount == changes->addedCapacity)
+    {
+        int capacity = changes->addedCapacity > 0 ? changes->addedCapacity * 2 : 64;
+        noteHeapAllocation();
+        UserSessionRecord *larger = (UserSessionRecord *)realloc(changes->added, sizeof(UserSessionRecord) * capacity);
+        if (larger == NULL)
+        {
+            perror("realloc");
+            return 1;
+        }
+        changes->added = larger;
+        changes->addedCapacity = capacity;
+    }
+    UserSessionRecord *record = changes->added + changes->addedCount++;
+    memset(record, 0, sizeof(UserSessionRecord));
+    record->id = session->id;
+    record->pid = session->pid;
+    memcpy(record->user, session->user, sizeof(record->user));
+    memcpy(record->line, session->line, sizeof(record->line));
+    memcpy(record->host, session->host, sizeof(record->host));
+    return 0;
+}
+
+/**
+ * Compare a new scan of utmp against the sessions already sent to the parent, and collect the sessions that were added or removed.
+ * Sessions that are still logged in keep their id.
+ * @param known The sessions already sent to the parent
+ * @param scanned The sessions of the new scan, whose ids are assigned
+ * @param nextId The id to assign to the next added session, advanced for each one
+ * @param changes Where to collect the changes
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+int collectUserSessionChanges(const UserSessionTable *known, UserSessionTable *scanned, int *nextId, UserSessionChanges *changes)
+{
+    int i = 0, j = 0;
+    while (i < known->count || j < scanned->count)
+    {
+        int order;
+        if (i == known->count)
+            order = 1;
+        else if (j == scanned->count)
+            order = -1;
+        else
+            order = compareUserSessions(known->sessions + i, scanned->sessions + j);
+
+        if (order < 0)
+        {
+            if (addUserSessionChange(changes, false, known->sessions + i) != 0)
+                return 1;
+            i++;
+        }
+        else if (order > 0)
+        {
+            struct passwd *account = getpwnam(scanned->sessions[j].user);
+            scanned->sessions[j].uid = account != NULL ? account->pw_uid : (uid_t)-1;
+            scanned->sessions[j].id = (*nextId)++;
+            if (addUserSessionChange(changes, true, scanned->sessions + j) != 0)
+                return 1;
+            j++;
+        }
+        else
+        {
+            scanned->sessions[j].id = known->sessions[i].id;
+            scanned->sessions[j].uid = known->sessions[i].uid;
+            i++;
+            j++;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Watch the directory holding utmp with inotify. Watching the directory rather than the file also catches utmp being
+ * created after the monitor starts or replaced by a rename.
+ * @param watch The watch to initialize. If inotify is not available, its fd is set to -1.
+ */
+void openUtmpWatch(UtmpWatch *watch)
+{
+    // _PATH_UTMP is an absolute path such as "/var/run/utmp"
+    char directory[sizeof(_PATH_UTMP)];
+    const char *slash = strrchr(_PATH_UTMP, '/');
+    watch->name = slash + 1;
+    snprintf(directory, sizeof(directory), "%.*s", (int)(slash - _PATH_UTMP), _PATH_UTMP);
+
+    watch->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watch->fd == -1)
+    {
+        return;
+    }
+    if (inotify_add_watch(watch->fd, directory, IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_TO | IN_MOVED_FROM) == -1)
+    {
+        close(watch->fd);
+        watch->fd = -1;
+    }
+}
+
+/**
+ * Drain the pending inotify events and check whether any of them concern utmp.
+ * @param watch A watch opened with openUtmpWatch()
+ * @returns true if utmp may have changed since the last call, false otherwise
+ */
+bool utmpChanged(UtmpWatch *watch)
+{
+    if (watch->fd == -1)
+    {
+        return true;
+    }
+    char events[UTMP_EVENT_BUFFER_SIZE] __attribute__((aligned(__alignof__(struct inotify_event))));
+    bool changed = false;
+    while (true)
+    {
+        ssize_t bytesRead = read(watch->fd, events, sizeof(events));
+        if (bytesRead <= 0)
+        {
+            // EAGAIN once every pending event was read
+            if (bytesRead == -1 && errno != EAGAIN && errno != EINTR)
+                changed = true;
+            break;
+        }
+        for (char *cursor = events; cursor < events + bytesRead; cursor += sizeof(struct inotify_event) + ((struct inotify_event *)cursor)->len)
+        {
+            const struct inotify_event *event = (const struct inotify_event *)cursor;
+            // events were dropped, so utmp may have changed without an event for it
+            if (event->mask & IN_Q_OVERFLOW)
+                changed = true;
+            else if (event->len > 0 && strcmp(event->name, watch->name) == 0)
+                changed = true;
+        }
+    }
+    return changed;
+}
+
+/**
+ * Find the slot of a uid in the map, which is either the slot holding the uid or the empty slot where it belongs.
+ * @param entries Slots of the map
+ * @param capacity Number of slots in the map, a power of two
+ * @param uid The user id to look for
+ * @returns Index of the slot
+ */
+size_t findUserUsageSlot(const UserUsage *entries, size_t capacity, uid_t uid)
+{
+    // Fibonacci hashing spreads consecutive uids across the map
+    size_t index = ((uint32_t)uid * 2654435761u) & (capacity - 1);
+    while (entries[index].used && entries[index].uid != uid)
+    {
+        index = (index + 1) & (capacity - 1);
+    }
+    return index;
+}
+
+/**
+ * Get the usage of a user, adding the user to the map with no usage if it is not in the map yet.
+ * @param map The map holding the usage
+ * @param uid The user id to look for
+ * @returns The usage of the user, or NULL if the map could not grow
+ */
+UserUsage *getUserUsage(UserUsageMap *map, uid_t uid)
+{
+    if ((map->count + 1) * 2 > map->capacity)
+    {
+        size_t capacity = map->capacity > 0 ? map->capacity * 2 : USER_USAGE_MAP_SIZE;
+        noteHeapAllocation();
+        UserUsage *entries = (UserUsage *)calloc(capacity, sizeof(UserUsage));
+        if (entries == NULL)
+        {
+            perror("calloc");
+            return NULL;
+        }
+        for (size_t i = 0; i < map->capacity; i++)
+        {
+            if (map->entries[i].used)
+                entries[findUserUsageSlot(entries, capacity, map->entries[i].uid)] = map->entries[i];
+        }
+        free(map->entries);
+        map->entries = entries;
+        map->capacity = capacity;
+    }
+    UserUsage *usage = map->entries + findUserUsageSlot(map->entries, map->capacity, uid);
+    if (!usage->used)
+    {
+        memset(usage, 0, sizeof(UserUsage));
+        usage->uid = uid;
+        usage->used = true;
+        map->count++;
+    }
+    return usage;
+}
+
+/**
+ * Sum the CPU utilization and resident memory of every process in the table by owner, in a single pass over the table.
+ * @param map The map to store the usage in, replacing its contents
+ * @param processes A table updated by scanProcesses(), or NULL to only empty the map
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+int aggregateUserUsage(UserUsageMap *map, const ProcessTable *processes)
+{
+    if (map->entries != NULL)
+        memset(map->entries, 0, sizeof(UserUsage) * map->capacity);
+    map->count = 0;
+    if (processes == NULL)
+        return 0;
+    for (size_t i = 0; i < processes->capacity; i++)
+    {
+        const ProcessEntry *entry = processes->entries + i;
+        if (entry->pid == 0 || entry->uid == (uid_t)-1)
+            continue;
+        UserUsage *usage = getUserUsage(map, entry->uid);
+        if (usage == NULL)
+            return 1;
+        usage->processCount++;
+        usage->cpuUsage += processCpuUsage(processes, entry);
+        usage->rssPages += entry->rssPages;
+    }
+    return 0;
+}
+
+/**
+ * Store the usage of each logged in user in records, one per user in the order of their first session.
+ * @param map Usage aggregated by aggregateUserUsage()
+ * @param sessions The logged in sessions
+ * @param pageSize Size of a memory page in bytes
+ * @param records Array of at least sessions->count records to fill in
+ * @param recordCount Where to store the number of records filled in
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+int fillUserUsageRecords(UserUsageMap *map, const UserSessionTable *sessions, long pageSize, UserUsageRecord *records, uint32_t *recordCount)
+{
+    *recordCount = 0;
+    for (int i = 0; i < sessions->count; i++)
+    {
+        const UserSession *session = sessions->sessions + i;
+        if (session->uid == (uid_t)-1)
+            continue;
+        // a user without any processes is still listed, with no usage
+        UserUsage *usage = getUserUsage(map, session->uid);
+        if (usage == NULL)
+            return 1;
+        if (usage->listed)
+            continue;
+        usage->listed = true;
+        UserUsageRecord *record = records + (*recordCount)++;
+        memset(record, 0, sizeof(UserUsageRecord));
+        record->uid = session->uid;
+        record->cpuUsage = usage->cpuUsage;
+        record->rssBytes = (uint64_t)usage->rssPages * pageSize;
+        record->processCount = usage->processCount;
+        memcpy(record->user, session->user, sizeof(record->user));
+    }
+    return 0;
+}
+
+/**
+ * Store the usage of every owner in the map in records.
+ * @param map Usage aggregated by aggregateUserUsage()
+ * @param pageSize Size of a memory page in bytes
+ * @param records Array of at least map->count records to fill in
+ * @param recordCount Where to store the number of records filled in
+ */
+void fillOwnerUsageRecords(const UserUsageMap *map, long pageSize, OwnerUsageRecord *records, uint32_t *recordCount)
+{
+    *recordCount = 0;
+    for (size_t i = 0; i < map->capacity; i++)
+    {
+        const UserUsage *usage = map->entries + i;
+        if (!usage->used)
+            continue;
+        OwnerUsageRecord *record = records + (*recordCount)++;
+        memset(record, 0, sizeof(OwnerUsageRecord));
+        record->uid = usage->uid;
+        record->cpuUsage = usage->cpuUsage;
+        record->rssBytes = (uint64_t)usage->rssPages * pageSize;
+        record->processCount = usage->processCount;
+    }
+}
+
+/**
+ * State the user collector keeps between samples
+ */
+typedef struct userCollector
+{
+    /**
+     * The sessions already sent to the parent and the sessions of the latest scan, swapped after every scan
+     */
+    UserSessionTable tables[2];
+    UserSessionTable *known, *scanned;
+    UserSessionChanges changes;
+    int nextId;
+    UtmpWatch watch;
+    /**
+     * Set until the first scan, since there is no previous scan to compare against
+     */
+    bool firstScan;
+    /**
+     * Whether the usage of each logged in user is shown, without which no process is read
+     */
+    bool showUsage;
+    /**
+     * Whether the process collector scans the processes and sends the usage of each owner, in which case this
+     * collector keeps no process table and only sends the logged in users
+     */
+    bool sharedScan;
+    /**
+     * Processes are bucketed by owner on every sample to annotate each logged in user with their usage, when the usage
+     * is shown and the process collector does not scan them
+     */
+    ProcessTable processes;
+    UserUsageMap usageMap;
+    UserUsageRecord *usageRecords;
+    int usageRecordCapacity;
+    UsersRecord record;
+    double timestamp;
+} UserCollector;
+
+/**
+ * Set up the utmp watch read by the user collector, and the process table when the usage of each user is shown and the
+ * process collector does not scan the processes.
+ * @param options The settings given by command line arguments
+ * @returns The state of the collector, or NULL if it could not be set up
+ */
+void *initUserCollector(const MonitorOptions *options)
+{
+    UserCollector *collector = (UserCollector *)calloc(1, sizeof(UserCollector));
+    if (collector == NULL)
+    {
+        perror("calloc");
+        return NULL;
+    }
+    collector->known = collector->tables;
+    collector->scanned = collector->tables + 1;
+    collector->nextId = 1;
+    collector->firstScan = true;
+    openUtmpWatch(&collector->watch);
+    // reading every /proc/[pid]/stat is the bulk of the work, so it is only done when asked for, and only once when
+    // both collectors run
+    collector->showUsage = options->showUserUsage;
+    collector->sharedScan = collector->showUsage && collectorRegistry[PROCESS_COLLECTOR].isEnabled(options);
+    collector->processes.procFd = -1;
+    if (collector->showUsage && !collector->sharedScan && initProcessTable(&collector->processes) != 0)
+    {
+        return NULL;
+    }
+    return collector;
+}
+
+/**
+ * Scan utmp when it changed and, when the usage of each logged in user is shown, the processes unless the process
+ * collector does, and total the usage of each logged in user.
+ * Sessions are kept between samples and utmp is only rescanned when inotify reports a change to it, in which case only
+ * the sessions that were added or removed are sent to the parent.
+ * @param state The state returned by initUserCollector()
+ * @param thisSample Index of the sample, of which sample 0 only sets the baseline of the CPU times
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+int sampleUserCollector(void *state, long thisSample)
+{
+    UserCollector *collector = (UserCollector *)state;
+    // the first scan of the processes gives the CPU time the next sample is measured against
+    bool ownScan = collector->showUsage && !collector->sharedScan;
+    if (ownScan && scanProcesses(&collector->processes) != 0)
+    {
+        return 1;
+    }
+    collector->timestamp = ownScan ? collector->processes.scanSeconds : getMonotonicSeconds();
+    if (thisSample == 0)
+    {
+        return 0;
+    }
+
+    // read the events before scanning, so a change during the scan is picked up by the next sample
+    UserSessionChanges *changes = &collector->changes;
+    changes->addedCount = 0;
+    changes->removedCount = 0;
+    if (utmpChanged(&collector->watch) || collector->firstScan)
+    {
+        if (scanUserSessions(collector->scanned) != 0 ||
+            collectUserSessionChanges(collector->known, collector->scanned, &collector->nextId, changes) != 0)
+        {
+            return 1;
+        }
+        UserSessionTable *latest = collector->scanned;
+        collector->scanned = collector->known;
+        collector->known = latest;
+        collector->firstScan = false;
+    }
+
+    // the usage of each user changes on every sample, so it is sent in full
+    if (collector->usageRecordCapacity < collector->known->count + 1)
+    {
+        collector->usageRecordCapacity = collector->known->count + 1;
+        noteHeapAllocation();
+        collector->usageRecords = (UserUsageRecord *)realloc(collector->usageRecords,
+                                                             sizeof(UserUsageRecord) * collector->usageRecordCapacity);
+        if (collector->usageRecords == NULL)
+        {
+            perror("realloc");
+            return 1;
+        }
+    }
+    UsersRecord *record = &collector->record;
+    memset(record, 0, sizeof(UsersRecord));
+    // with a shared scan the users are sent without usage, which the parent takes from the processes record, and
+    // without the usage shown no users are sent at all
+    if (collector->showUsage &&
+        (aggregateUserUsage(&collector->usageMap, ownScan ? &collector->processes : NULL) != 0 ||
+         fillUserUsageRecords(&collector->usageMap, collector->known, collector->processes.pageSize,
+                              collector->usageRecords, &record->userCount) != 0))
+    {
+        return 1;
+    }
+    record->sessionCount = collector->known->count;
+    record->flags = collector->sharedScan ? USERS_FLAG_SHARED_SCAN : 0;
+    record->addedCount = changes->addedCount;
+    record->removedCount = changes->removedCount;
+    return 0;
+}
+
+/**
+ * Describe the record of the latest sample as the parts of a RECORD_TYPE_USERS record.
+ * @param state The state returned by initUserCollector()
+ * @param parts Parts of the record, of which the first entry is left free for the header
+ * @param timestamp Where to store the monotonic time the processes were scanned at
+ * @returns The number of entries in parts including the header
+ */
+int encodeUserCollector(void *state, struct iovec *parts, double *timestamp)
+{
+    UserCollector *collector = (UserCollector *)state;
+    UsersRecord *record = &collector->record;
+    parts[1].iov_base = record;
+    parts[1].iov_len = sizeof(UsersRecord);
+    parts[2].iov_base = collector->usageRecords;
+    parts[2].iov_len = sizeof(UserUsageRecord) * record->userCount;
+    parts[3].iov_base = collector->changes.added;
+    parts[3].iov_len = sizeof(UserSessionRecord) * record->addedCount;
+    parts[4].iov_base = collector->changes.removed;
+    parts[4].iov_len = sizeof(int32_t) * record->removedCount;
+    *timestamp = collector->timestamp;
+    return 5;
+}
+
+/**
+ * Close the utmp watch and release the tables and state of the user collector.
+ * @param state The state returned by initUserCollector()
+ */
+void teardownUserCollector(void *state)
+{
+    UserCollector *collector = (UserCollector *)state;
+    if (collector->watch.fd != -1)
+    {
+        close(collector->watch.fd);
+    }
+    free(collector->tables[0].sessions);
+    free(collector->tables[1].sessions);
+    free(collector->changes.added);
+    free(collector->changes.removed);
+    if (collector->showUsage && !collector->sharedScan)
+        freeProcessTable(&collector->processes);
+    free(collector->usageMap.entries);
+    free(collector->usageRecords);
+    free(collector);
+}
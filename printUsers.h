@@ -1,9 +1,34 @@
 #ifndef PRINT_USERS_H
 #define PRINT_USERS_H
 
-#define USER_START_FLAG 3
-#define USER_DATA_ID 3
-#define MAX_USERS 512
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include "parseArguments.h"
+#include "parseProcessStats.h"
+#include "sampleRecord.h"
+
+/**
+ * Max length of the line printed for a single session, including the user, terminal and host
+ */
+#define USER_LINE_LENGTH 384
+
+/**
+ * Size of the buffer that inotify events on the utmp directory are read into
+ */
+#define UTMP_EVENT_BUFFER_SIZE 4096
+
+/**
+ * Space reserved in the rendered per-user usage for each logged in user, in bytes
+ */
+#define USER_USAGE_OUTPUT_LENGTH 128
+
+/**
+ * Initial number of slots in a UserUsageMap, a power of two
+ */
+#define USER_USAGE_MAP_SIZE 64
 
 #ifndef FD_WRITE
 #define FD_WRITE 1
@@ -13,6 +38,98 @@
 #define FD_READ 0
 #endif
 
-extern void printUsers(int writeToChildFds[2], int readFromChildFds[2], int incomingDataPipe[2]);
+/**
+ * The combined usage of every process owned by a single user
+ */
+typedef struct userUsage
+{
+    uid_t uid;
+    /**
+     * Whether this slot of the map holds a user
+     */
+    bool used;
+    /**
+     * Whether the user was already listed in the current output
+     */
+    bool listed;
+    /**
+     * Number of processes owned by the user
+     */
+    int processCount;
+    /**
+     * Sum of the CPU utilization of the user's processes, where 100 is one fully used core
+     */
+    float cpuUsage;
+    /**
+     * Sum of the resident set size of the user's processes, in pages
+     */
+    long rssPages;
+} UserUsage;
+
+/**
+ * Open-addressing hash table from uid to the usage of the user's processes, rebuilt on every sample
+ */
+typedef struct userUsageMap
+{
+    /**
+     * Slots of the map, a power of two in number
+     */
+    UserUsage *entries;
+    /**
+     * Number of slots in entries
+     */
+    size_t capacity;
+    /**
+     * Number of slots holding a user
+     */
+    size_t count;
+} UserUsageMap;
+
+/**
+ * Sum the CPU utilization and resident memory of every process in the table by owner, in a single pass over the table.
+ * @param map The map to store the usage in, replacing its contents
+ * @param processes A table updated by scanProcesses(), or NULL to only empty the map
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+extern int aggregateUserUsage(UserUsageMap *map, const ProcessTable *processes);
 
-#endif
\ No newline at end of file
+/**
+ * Store the usage of every owner in the map in records.
+ * @param map Usage aggregated by aggregateUserUsage()
+ * @param pageSize Size of a memory page in bytes
+ * @param records Array of at least map->count records to fill in
+ * @param recordCount Where to store the number of records filled in
+ */
+extern void fillOwnerUsageRecords(const UserUsageMap *map, long pageSize, OwnerUsageRecord *records, uint32_t *recordCount);
+
+/**
+ * Set up the utmp watch read by the user collector, and the process table unless the process collector scans the processes.
+ * @param options The settings given by command line arguments
+ * @returns The state of the collector, or NULL if it could not be set up
+ */
+extern void *initUserCollector(const MonitorOptions *options);
+
+/**
+ * Scan the processes, unless the process collector does, and utmp when it changed, and total the usage of each logged in user.
+ * @param state The state returned by initUserCollector()
+ * @param thisSample Index of the sample, of which sample 0 only sets the baseline of the CPU times
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+extern int sampleUserCollector(void *state, long thisSample);
+
+/**
+ * Describe the record of the latest sample as the parts of a RECORD_TYPE_USERS record.
+ * @param state The state returned by initUserCollector()
+ * @param parts Parts of the record, of which the first entry is left free for the header
+ * @param timestamp Where to store the monotonic time the processes were scanned at
+ * @returns The number of entries in parts including the header
+ */
+extern int encodeUserCollector(void *state, struct iovec *parts, double *timestamp);
+
+/**
+ * Close the utmp watch and release the tables and state of the user collector.
+ * @param state The state returned by initUserCollector()
+ */
+extern void teardownUserCollector(void *state);
+
+#endif
@@ -0,0 +1,275 @@
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "heapCounter.h"
+#include "procFile.h"
+
+/**
+ * Open a file for repeated reading and allocate its read buffer.
+ * @param file The ProcFile to initialize
+ * @param path Path of the file to open
+ * @param capacity Size of the read buffer in bytes. Content beyond capacity - 1 bytes is not read.
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+int openProcFile(ProcFile *file, const char *path, size_t capacity)
+{
+    file->fd = -1;
+    file->length = 0;
+    file->capacity = capacity;
+    file->buffer = (char *)malloc(sizeof(char) * capacity);
+    if (file->buffer == NULL)
+    {
+        perror("malloc");
+        return 1;
+    }
+    file->buffer[0] = '\0';
+
+    file->fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (file->fd == -1)
+    {
+        fprintf(stderr, "Encountered error opening %s: ", path);
+        perror("open");
+        free(file->buffer);
+        file->buffer = NULL;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Re-read the file from offset 0 into its buffer and null terminate the contents.
+ * @param file A ProcFile opened with openProcFile()
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+int readProcFile(ProcFile *file)
+{
+    size_t total = 0;
+    // files under /proc may be returned in several chunks, so keep reading until EOF or the buffer is full
+    while (total < file->capacity - 1)
+    {
+        ssize_t bytesRead = pread(file->fd, file->buffer + total, file->capacity - 1 - total, total);
+        if (bytesRead == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            perror("pread");
+            return 1;
+        }
+        if (bytesRead == 0)
+            break;
+        total += bytesRead;
+    }
+    file->buffer[total] = '\0';
+    file->length = total;
+    return 0;
+}
+
+/**
+ * Double the size of the read buffer, for when a read filled the buffer before reaching the data of interest.
+ * The contents of the buffer are not preserved, so the file must be read again.
+ * @param file A ProcFile opened with openProcFile()
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+int growProcFile(ProcFile *file)
+{
+    noteHeapAllocation();
+    char *larger = (char *)realloc(file->buffer, sizeof(char) * file->capacity * 2);
+    if (larger == NULL)
+    {
+        perror("realloc");
+        return 1;
+    }
+    file->buffer = larger;
+    file->capacity *= 2;
+    file->buffer[0] = '\0';
+    file->length = 0;
+    return 0;
+}
+
+/**
+ * Check whether the most recent read filled the whole buffer, meaning the end of the file may have been cut off.
+ * @param file A ProcFile opened with openProcFile()
+ * @returns true if the buffer was filled, false otherwise
+ */
+bool isProcFileTruncated(const ProcFile *file)
+{
+    return file->length == file->capacity - 1;
+}
+
+/**
+ * Close the file and release its buffer.
+ * @param file A ProcFile opened with openProcFile()
+ */
+void closeProcFile(ProcFile *file)
+{
+    if (file->fd != -1)
+    {
+        close(file->fd);
+        file->fd = -1;
+    }
+    free(file->buffer);
+    file->buffer = NULL;
+    file->length = 0;
+}
+
+/**
+ * Calculate the FNV-1a hash of a key.
+ * @param key The first character of the key
+ * @param length Length of the key
+ * @returns The hash of the key
+ */
+static uint32_t hashProcKey(const char *key, size_t length)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++)
+    {
+        hash = (hash ^ (unsigned char)key[i]) * 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * Build the lookup of keys to value slots, where the slot of each key is its index in the keys array.
+ * @param table The table to build
+ * @param keys The keys of interest, such as "MemTotal" or "pgfault"
+ * @param keyCount Number of keys, which must be well below PROC_KEY_TABLE_SIZE
+ */
+void initProcKeyTable(ProcKeyTable *table, const char *const *keys, int keyCount)
+{
+    memset(table, 0, sizeof(ProcKeyTable));
+    for (int slot = 0; slot < keyCount; slot++)
+    {
+        size_t length = strlen(keys[slot]);
+        uint32_t hash = hashProcKey(keys[slot], length);
+        size_t index = hash & (PROC_KEY_TABLE_SIZE - 1);
+        while (table->buckets[index].key != NULL)
+        {
+            index = (index + 1) & (PROC_KEY_TABLE_SIZE - 1);
+        }
+        table->buckets[index].key = keys[slot];
+        table->buckets[index].length = length;
+        table->buckets[index].hash = hash;
+        table->buckets[index].slot = slot;
+    }
+}
+
+/**
+ * Parse every "key value" line of a file, storing the value of each key of interest in its slot.
+ * A key is terminated by a colon or whitespace, so both "MemTotal:  1024 kB" and "pgfault 1024" are understood.
+ * Values of keys that are not found are set to 0.
+ * @param table Lookup built by initProcKeyTable()
+ * @param contents The null terminated contents of the file
+ * @param leadingFields Number of whitespace separated fields to skip at the start of each line before the key,
+ * such as 2 for the "Node 0" prefix of a NUMA node's meminfo
+ * @param values Array with a slot for each key of interest
+ * @param valueCount Number of slots in values
+ */
+void parseKeyedValues(const ProcKeyTable *table, const char *contents, int leadingFields, unsigned long long *values, int valueCount)
+{
+    memset(values, 0, sizeof(unsigned long long) * valueCount);
+    const char *cursor = contents;
+    while (*cursor != '\0')
+    {
+        for (int i = 0; i < leadingFields; i++)
+        {
+            skipField(&cursor);
+        }
+        while (*cursor == ' ' || *cursor == '\t')
+        {
+            cursor++;
+        }
+
+        const char *key = cursor;
+        while (*cursor != '\0' && *cursor != ':' && *cursor != ' ' && *cursor != '\t' && *cursor != '\n')
+        {
+            cursor++;
+        }
+        size_t length = cursor - key;
+        uint32_t hash = hashProcKey(key, length);
+
+        size_t index = hash & (PROC_KEY_TABLE_SIZE - 1);
+        while (table->buckets[index].key != NULL)
+        {
+            const ProcKeyBucket *bucket = table->buckets + index;
+            if (bucket->hash == hash && bucket->length == length && memcmp(bucket->key, key, length) == 0)
+            {
+                if (*cursor == ':')
+                    cursor++;
+                if (bucket->slot < valueCount)
+                    values[bucket->slot] = scanUnsigned(&cursor);
+                break;
+            }
+            index = (index + 1) & (PROC_KEY_TABLE_SIZE - 1);
+        }
+        if (!skipLine(&cursor))
+            break;
+    }
+}
+
+/**
+ * Parse the next unsigned decimal number at the cursor, skipping leading spaces and tabs, and advance the cursor past it.
+ * The cursor does not move past a newline, so a missing field parses as 0 rather than reading the next line.
+ * @param cursor Pointer to the current position within a null terminated string
+ * @returns The parsed value, or 0 if no digits were found
+ */
+unsigned long long scanUnsigned(const char **cursor)
+{
+    const char *position = *cursor;
+    while (*position == ' ' || *position == '\t')
+    {
+        position++;
+    }
+    unsigned long long value = 0;
+    while (*position >= '0' && *position <= '9')
+    {
+        value = value * 10 + (*position - '0');
+        position++;
+    }
+    *cursor = position;
+    return value;
+}
+
+/**
+ * Advance the cursor past the next whitespace separated field, skipping leading spaces and tabs.
+ * @param cursor Pointer to the current position within a null terminated string
+ */
+void skipField(const char **cursor)
+{
+    const char *position = *cursor;
+    while (*position == ' ' || *position == '\t')
+    {
+        position++;
+    }
+    while (*position != '\0' && *position != ' ' && *position != '\t' && *position != '\n')
+    {
+        position++;
+    }
+    *cursor = position;
+}
+
+/**
+ * Advance the cursor to the first character of the next line.
+ * @param cursor Pointer to the current position within a null terminated string
+ * @returns true if another line exists, false if the end of the string was reached
+ */
+bool skipLine(const char **cursor)
+{
+    const char *position = *cursor;
+    while (*position != '\0' && *position != '\n')
+    {
+        position++;
+    }
+    if (*position == '\n')
+    {
+        *cursor = position + 1;
+        return **cursor != '\0';
+    }
+    *cursor = position;
+    return false;
+}
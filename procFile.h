@@ -0,0 +1,149 @@
+#ifndef PROC_FILE_H
+#define PROC_FILE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Number of buckets in a ProcKeyTable, a power of two comfortably larger than the number of keys looked up in any file
+ */
+#define PROC_KEY_TABLE_SIZE 128
+
+/**
+ * A file under /proc or /sys that is opened once and re-read from the start on every sample with pread(),
+ * avoiding the open/close and stdio buffering costs of fopen() on each sample.
+ */
+typedef struct procFile
+{
+    /**
+     * File descriptor kept open between samples, or -1 if the file is not open
+     */
+    int fd;
+    /**
+     * Reusable buffer holding the contents of the most recent read, always null terminated
+     */
+    char *buffer;
+    /**
+     * Size of buffer in bytes
+     */
+    size_t capacity;
+    /**
+     * Number of bytes placed in buffer by the most recent read, excluding the null terminator
+     */
+    size_t length;
+} ProcFile;
+
+/**
+ * A bucket of a ProcKeyTable, holding one key of interest and the slot its value is stored in
+ */
+typedef struct procKeyBucket
+{
+    /**
+     * The key, or NULL if the bucket is empty
+     */
+    const char *key;
+    /**
+     * Length of the key
+     */
+    size_t length;
+    /**
+     * Hash of the key as computed by hashProcKey()
+     */
+    uint32_t hash;
+    /**
+     * Index in the values array where the value of this key is stored
+     */
+    int slot;
+} ProcKeyBucket;
+
+/**
+ * Lookup from the keys of a "key value" file such as /proc/meminfo or /proc/vmstat to the slots their values are stored in.
+ * The table is built once, so each line of the file costs a hash of its key and a single bucket probe rather than
+ * comparing the line against every key of interest.
+ */
+typedef struct procKeyTable
+{
+    ProcKeyBucket buckets[PROC_KEY_TABLE_SIZE];
+} ProcKeyTable;
+
+/**
+ * Open a file for repeated reading and allocate its read buffer.
+ * @param file The ProcFile to initialize
+ * @param path Path of the file to open
+ * @param capacity Size of the read buffer in bytes. Content beyond capacity - 1 bytes is not read.
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+extern int openProcFile(ProcFile *file, const char *path, size_t capacity);
+
+/**
+ * Re-read the file from offset 0 into its buffer and null terminate the contents.
+ * @param file A ProcFile opened with openProcFile()
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+extern int readProcFile(ProcFile *file);
+
+/**
+ * Double the size of the read buffer, for when a read filled the buffer before reaching the data of interest.
+ * The contents of the buffer are not preserved, so the file must be read again.
+ * @param file A ProcFile opened with openProcFile()
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+extern int growProcFile(ProcFile *file);
+
+/**
+ * Check whether the most recent read filled the whole buffer, meaning the end of the file may have been cut off.
+ * @param file A ProcFile opened with openProcFile()
+ * @returns true if the buffer was filled, false otherwise
+ */
+extern bool isProcFileTruncated(const ProcFile *file);
+
+/**
+ * Close the file and release its buffer.
+ * @param file A ProcFile opened with openProcFile()
+ */
+extern void closeProcFile(ProcFile *file);
+
+/**
+ * Build the lookup of keys to value slots, where the slot of each key is its index in the keys array.
+ * @param table The table to build
+ * @param keys The keys of interest, such as "MemTotal" or "pgfault"
+ * @param keyCount Number of keys, which must be well below PROC_KEY_TABLE_SIZE
+ */
+extern void initProcKeyTable(ProcKeyTable *table, const char *const *keys, int keyCount);
+
+/**
+ * Parse every "key value" line of a file, storing the value of each key of interest in its slot.
+ * A key is terminated by a colon or whitespace, so both "MemTotal:  1024 kB" and "pgfault 1024" are understood.
+ * Values of keys that are not found are set to 0.
+ * @param table Lookup built by initProcKeyTable()
+ * @param contents The null terminated contents of the file
+ * @param leadingFields Number of whitespace separated fields to skip at the start of each line before the key,
+ * such as 2 for the "Node 0" prefix of a NUMA node's meminfo
+ * @param values Array with a slot for each key of interest
+ * @param valueCount Number of slots in values
+ */
+extern void parseKeyedValues(const ProcKeyTable *table, const char *contents, int leadingFields, unsigned long long *values, int valueCount);
+
+/**
+ * Parse the next unsigned decimal number at the cursor, skipping leading spaces and tabs, and advance the cursor past it.
+ * The cursor does not move past a newline, so a missing field parses as 0 rather than reading the next line.
+ * @param cursor Pointer to the current position within a null terminated string
+ * @returns The parsed value, or 0 if no digits were found
+ */
+extern unsigned long long scanUnsigned(const char **cursor);
+
+/**
+ * Advance the cursor past the next whitespace separated field, skipping leading spaces and tabs.
+ * @param cursor Pointer to the current position within a null terminated string
+ */
+extern void skipField(const char **cursor);
+
+/**
+ * Advance the cursor to the first character of the next line.
+ * @param cursor Pointer to the current position within a null terminated string
+ * @returns true if another line exists, false if the end of the string was reached
+ */
+extern bool skipLine(const char **cursor);
+
+#endif
@@ -0,0 +1,340 @@
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <poll.h>
+
+#include "procFile.h"
+#include "sampleTimer.h"
+#include "sampleRecord.h"
+#include "parseArguments.h"
+#include "psiStats.h"
+
+/**
+ * Names of the resources under /proc/pressure, indexed by PSI_CPU, PSI_MEMORY and PSI_IO
+ */
+const char *const psiResourceNames[PSI_RESOURCE_COUNT] = {"cpu", "memory", "io"};
+
+/**
+ * Advance the cursor past the next '=' on the current line.
+ * @param cursor Pointer to the current position within a null terminated string
+ */
+static void skipToValue(const char **cursor)
+{
+    while (**cursor != '\0' && **cursor != '\n' && **cursor != '=')
+        (*cursor)++;
+    if (**cursor == '=')
+        (*cursor)++;
+}
+
+/**
+ * Parse a "some" or "full" line of a /proc/pressure file, such as "some avg10=1.88 avg60=1.27 avg300=1.60 total=20155662".
+ * @param cursor Pointer to the start of the line, advanced to the start of the next line
+ * @param line Where to store the values of the line
+ */
+static void parsePsiLine(const char **cursor, PsiLine *line)
+{
+    char *end;
+    skipToValue(cursor);
+    line->avg10 = strtof(*cursor, &end);
+    *cursor = end;
+    skipToValue(cursor);
+    line->avg60 = strtof(*cursor, &end);
+    *cursor = end;
+    skipToValue(cursor);
+    line->avg300 = strtof(*cursor, &end);
+    *cursor = end;
+    skipToValue(cursor);
+    line->totalUs = scanUnsigned(cursor);
+    skipLine(cursor);
+}
+
+/**
+ * Open the files under /proc/pressure.
+ * @param psi The Psi to initialize
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+int openPsi(Psi *psi)
+{
+    char path[PSI_TRIGGER_LENGTH];
+    for (int i = 0; i < PSI_RESOURCE_COUNT; i++)
+    {
+        snprintf(path, PSI_TRIGGER_LENGTH, "/proc/pressure/%s", psiResourceNames[i]);
+        if (openProcFile(psi->files + i, path, PSI_BUFFER_SIZE) != 0)
+        {
+            for (int j = 0; j < i; j++)
+                closeProcFile(psi->files + j);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Read the pressure stall information of every resource.
+ * @param psi A Psi opened with openPsi()
+ * @param samples Array of PSI_RESOURCE_COUNT samples to store the result in
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+int readPsi(Psi *psi, PsiSample *samples)
+{
+    for (int i = 0; i < PSI_RESOURCE_COUNT; i++)
+    {
+        if (readProcFile(psi->files + i) != 0)
+        {
+            return 1;
+        }
+        samples[i].seconds = getMonotonicSeconds();
+        memset(&samples[i].some, 0, sizeof(PsiLine));
+        memset(&samples[i].full, 0, sizeof(PsiLine));
+
+        // kernels before 5.13 have no "full" line for the CPU
+        const char *cursor = psi->files[i].buffer;
+        while (*cursor != '\0')
+        {
+            if (strncmp(cursor, "some", 4) == 0)
+                parsePsiLine(&cursor, &samples[i].some);
+            else if (strncmp(cursor, "full", 4) == 0)
+                parsePsiLine(&cursor, &samples[i].full);
+            else if (!skipLine(&cursor))
+                break;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Calculate the time stalled per second between two reads of a line.
+ * @param previous The line of the earlier read
+ * @param current The line of the later read
+ * @param seconds Seconds between the reads
+ * @returns Milliseconds stalled per second
+ */
+static double calculateStallRate(const PsiLine *previous, const PsiLine *current, double seconds)
+{
+    if (seconds <= 0 || current->totalUs < previous->totalUs)
+        return 0.0;
+    return (current->totalUs - previous->totalUs) / 1000.0 / seconds;
+}
+
+/**
+ * Store the averages of every resource and the time stalled per second since the previous read in a record.
+ * @param previous Array of PSI_RESOURCE_COUNT samples of the previous read
+ * @param current Array of PSI_RESOURCE_COUNT samples of the current read
+ * @param record The record to fill in
+ */
+static void fillPressureRecord(const PsiSample *previous, const PsiSample *current, PressureRecord *record)
+{
+    memset(record, 0, sizeof(PressureRecord));
+    for (int i = 0; i < PSI_RESOURCE_COUNT; i++)
+    {
+        double seconds = current[i].seconds - previous[i].seconds;
+        PressureResourceRecord *resource = record->resources + i;
+        resource->some = current[i].some;
+        resource->full = current[i].full;
+        resource->someStallRate = calculateStallRate(&previous[i].some, &current[i].some, seconds);
+        resource->fullStallRate = calculateStallRate(&previous[i].full, &current[i].full, seconds);
+    }
+}
+
+/**
+ * Close the files under /proc/pressure.
+ * @param psi A Psi opened with openPsi()
+ */
+void closePsi(Psi *psi)
+{
+    for (int i = 0; i < PSI_RESOURCE_COUNT; i++)
+    {
+        closeProcFile(psi->files + i);
+    }
+}
+
+/**
+ * Register a trigger on every resource that fires when tasks are stalled for thresholdMs within a PSI_TRIGGER_WINDOW_MS window.
+ * @param triggers The triggers to initialize
+ * @param thresholdMs Stall time that fires a trigger, in milliseconds
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+int openPsiTriggers(PsiTriggers *triggers, long thresholdMs)
+{
+    triggers->thresholdMs = thresholdMs;
+    for (int i = 0; i < PSI_RESOURCE_COUNT; i++)
+    {
+        triggers->fds[i] = -1;
+        triggers->events[i] = 0;
+    }
+    triggers->latestEvent[0] = '\0';
+
+    char path[PSI_TRIGGER_LENGTH], trigger[PSI_TRIGGER_LENGTH];
+    snprintf(trigger, PSI_TRIGGER_LENGTH, "some %ld %ld", thresholdMs * 1000, (long)PSI_TRIGGER_WINDOW_MS * 1000);
+    for (int i = 0; i < PSI_RESOURCE_COUNT; i++)
+    {
+        snprintf(path, PSI_TRIGGER_LENGTH, "/proc/pressure/%s", psiResourceNames[i]);
+        // the trigger stays registered for as long as the file descriptor it was written to is open
+        triggers->fds[i] = open(path, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+        if (triggers->fds[i] == -1 || write(triggers->fds[i], trigger, strlen(trigger) + 1) == -1)
+        {
+            fprintf(stderr, "Encountered error registering trigger \"%s\" on %s: ", trigger, path);
+            perror(triggers->fds[i] == -1 ? "open" : "write");
+            closePsiTriggers(triggers);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Fill in the poll() entries of the registered triggers.
+ * @param triggers Triggers registered by openPsiTriggers()
+ * @param pollFds Array of PSI_RESOURCE_COUNT entries to fill in
+ */
+void preparePsiPoll(const PsiTriggers *triggers, struct pollfd *pollFds)
+{
+    for (int i = 0; i < PSI_RESOURCE_COUNT; i++)
+    {
+        // poll() skips entries with a negative file descriptor
+        pollFds[i].fd = triggers->fds[i];
+        pollFds[i].events = POLLPRI;
+        pollFds[i].revents = 0;
+    }
+}
+
+/**
+ * Count and report the triggers that fired according to the results of poll(), as soon as they are seen.
+ * A trigger whose file reports an error is unregistered.
+ * @param triggers Triggers registered by openPsiTriggers()
+ * @param pollFds Array of PSI_RESOURCE_COUNT entries filled in by preparePsiPoll() and then poll()
+ * @returns Number of events reported
+ */
+int handlePsiEvents(PsiTriggers *triggers, const struct pollfd *pollFds)
+{
+    int reported = 0;
+    for (int i = 0; i < PSI_RESOURCE_COUNT; i++)
+    {
+        if (pollFds[i].fd == -1)
+            continue;
+        if (pollFds[i].revents & POLLERR)
+        {
+            fprintf(stderr, "Pressure trigger on %s was removed by the kernel\n", psiResourceNames[i]);
+            close(triggers->fds[i]);
+            triggers->fds[i] = -1;
+        }
+        else if (pollFds[i].revents & POLLPRI)
+        {
+            triggers->events[i]++;
+            snprintf(triggers->latestEvent, PSI_EVENT_LENGTH, "tasks stalled on %s for over %ld ms within %d ms (event #%lu)",
+                     psiResourceNames[i], triggers->thresholdMs, PSI_TRIGGER_WINDOW_MS, triggers->events[i]);
+            printf(">>> Pressure event: %s\n", triggers->latestEvent);
+            fflush(stdout);
+            reported++;
+        }
+    }
+    return reported;
+}
+
+/**
+ * Unregister the triggers by closing their file descriptors.
+ * @param triggers Triggers registered by openPsiTriggers()
+ */
+void closePsiTriggers(PsiTriggers *triggers)
+{
+    for (int i = 0; i < PSI_RESOURCE_COUNT; i++)
+    {
+        if (triggers->fds[i] != -1)
+        {
+            close(triggers->fds[i]);
+            triggers->fds[i] = -1;
+        }
+    }
+}
+
+/**
+ * State the pressure collector keeps between samples
+ */
+typedef struct pressureCollector
+{
+    Psi psi;
+    /**
+     * Samples of the previous and current reads, swapped after every sample
+     */
+    PsiSample samples[2][PSI_RESOURCE_COUNT];
+    PsiSample *previous, *current;
+    PressureRecord record;
+} PressureCollector;
+
+/**
+ * Open the files under /proc/pressure read by the pressure collector.
+ * @param options The settings given by command line arguments
+ * @returns The state of the collector, or NULL if it could not be set up
+ */
+void *initPressureCollector(const MonitorOptions *options)
+{
+    (void)options;
+    PressureCollector *collector = (PressureCollector *)calloc(1, sizeof(PressureCollector));
+    if (collector == NULL)
+    {
+        perror("calloc");
+        return NULL;
+    }
+    if (openPsi(&collector->psi) != 0)
+    {
+        free(collector);
+        return NULL;
+    }
+    collector->previous = collector->samples[0];
+    collector->current = collector->samples[1];
+    return collector;
+}
+
+/**
+ * Read the pressure stall information and compute the stall rates since the previous sample.
+ * @param state The state returned by initPressureCollector()
+ * @param thisSample Index of the sample, of which sample 0 only sets the baseline of the rates
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+int samplePressureCollector(void *state, long thisSample)
+{
+    PressureCollector *collector = (PressureCollector *)state;
+    if (readPsi(&collector->psi, collector->current) != 0)
+    {
+        return 1;
+    }
+    if (thisSample > 0)
+    {
+        fillPressureRecord(collector->previous, collector->current, &collector->record);
+    }
+    PsiSample *latest = collector->current;
+    collector->current = collector->previous;
+    collector->previous = latest;
+    return 0;
+}
+
+/**
+ * Describe the record of the latest sample as the parts of a RECORD_TYPE_PRESSURE record.
+ * @param state The state returned by initPressureCollector()
+ * @param parts Parts of the record, of which the first entry is left free for the header
+ * @param timestamp Where to store the monotonic time the first resource was read at
+ * @returns The number of entries in parts including the header
+ */
+int encodePressureCollector(void *state, struct iovec *parts, double *timestamp)
+{
+    PressureCollector *collector = (PressureCollector *)state;
+    parts[1].iov_base = &collector->record;
+    parts[1].iov_len = sizeof(PressureRecord);
+    *timestamp = collector->previous[0].seconds;
+    return 2;
+}
+
+/**
+ * Close the files read by the pressure collector and release its state.
+ * @param state The state returned by initPressureCollector()
+ */
+void teardownPressureCollector(void *state)
+{
+    PressureCollector *collector = (PressureCollector *)state;
+    closePsi(&collector->psi);
+    free(collector);
+}
@@ -0,0 +1,206 @@
+#ifndef PSI_STATS_H
+#define PSI_STATS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <poll.h>
+#include <sys/uio.h>
+
+#include "procFile.h"
+#include "parseArguments.h"
+
+/**
+ * Indices of the resources under /proc/pressure
+ */
+#define PSI_CPU 0
+#define PSI_MEMORY 1
+#define PSI_IO 2
+#define PSI_RESOURCE_COUNT 3
+
+/**
+ * Size of the buffer that a /proc/pressure file is read into
+ */
+#define PSI_BUFFER_SIZE 256
+
+/**
+ * Window of a PSI trigger in milliseconds. Triggers created without CAP_SYS_RESOURCE must use a multiple of 2 seconds.
+ */
+#define PSI_TRIGGER_WINDOW_MS 2000
+
+/**
+ * Max length of the trigger written to a /proc/pressure file, such as "some 150000 2000000"
+ */
+#define PSI_TRIGGER_LENGTH 64
+
+/**
+ * Space reserved in the rendered pressure stall information for each resource, in bytes
+ */
+#define PSI_OUTPUT_LENGTH 160
+
+/**
+ * Max length of the description of a pressure event, such as "tasks stalled on memory for over 150 ms within 2000 ms (event #3)"
+ */
+#define PSI_EVENT_LENGTH 128
+
+#ifndef FD_WRITE
+#define FD_WRITE 1
+#endif
+
+#ifndef FD_READ
+#define FD_READ 0
+#endif
+
+/**
+ * One line of a /proc/pressure file, for the share of time in which some or all tasks were stalled on a resource
+ */
+typedef struct psiLine
+{
+    /**
+     * Percentage of time stalled, averaged over the last 10, 60 and 300 seconds
+     */
+    float avg10, avg60, avg300;
+    /**
+     * Total time stalled since boot, in microseconds
+     */
+    unsigned long long totalUs;
+} PsiLine;
+
+/**
+ * Pressure stall information of one resource at one point in time
+ */
+typedef struct psiSample
+{
+    /**
+     * Time in which at least one task was stalled on the resource
+     */
+    PsiLine some;
+    /**
+     * Time in which all non-idle tasks were stalled on the resource at once, which the kernel reports as zero for CPU
+     */
+    PsiLine full;
+    /**
+     * Monotonic time the sample was read at, in seconds
+     */
+    double seconds;
+} PsiSample;
+
+/**
+ * The files under /proc/pressure, kept open between samples
+ */
+typedef struct psi
+{
+    ProcFile files[PSI_RESOURCE_COUNT];
+} Psi;
+
+/**
+ * PSI triggers registered on each resource, whose file descriptors become ready for POLLPRI as soon as the
+ * stall time within a window exceeds the threshold
+ */
+typedef struct psiTriggers
+{
+    /**
+     * File descriptor the trigger of each resource was written to, or -1 if it is not registered
+     */
+    int fds[PSI_RESOURCE_COUNT];
+    /**
+     * Number of events reported by each trigger
+     */
+    unsigned long events[PSI_RESOURCE_COUNT];
+    /**
+     * Description of the latest event, shown in every frame so that it outlasts the redraw of a terminal, or empty
+     * until an event happened
+     */
+    char latestEvent[PSI_EVENT_LENGTH];
+    /**
+     * Stall time within the window that fires a trigger, in milliseconds
+     */
+    long thresholdMs;
+} PsiTriggers;
+
+/**
+ * Names of the resources under /proc/pressure, indexed by PSI_CPU, PSI_MEMORY and PSI_IO
+ */
+extern const char *const psiResourceNames[PSI_RESOURCE_COUNT];
+
+/**
+ * Open the files under /proc/pressure.
+ * @param psi The Psi to initialize
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+extern int openPsi(Psi *psi);
+
+/**
+ * Read the pressure stall information of every resource.
+ * @param psi A Psi opened with openPsi()
+ * @param samples Array of PSI_RESOURCE_COUNT samples to store the result in
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+extern int readPsi(Psi *psi, PsiSample *samples);
+
+/**
+ * Close the files under /proc/pressure.
+ * @param psi A Psi opened with openPsi()
+ */
+extern void closePsi(Psi *psi);
+
+/**
+ * Register a trigger on every resource that fires when tasks are stalled for thresholdMs within a PSI_TRIGGER_WINDOW_MS window.
+ * @param triggers The triggers to initialize
+ * @param thresholdMs Stall time that fires a trigger, in milliseconds
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+extern int openPsiTriggers(PsiTriggers *triggers, long thresholdMs);
+
+/**
+ * Fill in the poll() entries of the registered triggers.
+ * @param triggers Triggers registered by openPsiTriggers()
+ * @param pollFds Array of PSI_RESOURCE_COUNT entries to fill in
+ */
+extern void preparePsiPoll(const PsiTriggers *triggers, struct pollfd *pollFds);
+
+/**
+ * Count and report the triggers that fired according to the results of poll(), as soon as they are seen.
+ * A trigger whose file reports an error is unregistered.
+ * @param triggers Triggers registered by openPsiTriggers()
+ * @param pollFds Array of PSI_RESOURCE_COUNT entries filled in by preparePsiPoll() and then poll()
+ * @returns Number of events reported
+ */
+extern int handlePsiEvents(PsiTriggers *triggers, const struct pollfd *pollFds);
+
+/**
+ * Unregister the triggers by closing their file descriptors.
+ * @param triggers Triggers registered by openPsiTriggers()
+ */
+extern void closePsiTriggers(PsiTriggers *triggers);
+
+/**
+ * Open the files under /proc/pressure read by the pressure collector.
+ * @param options The settings given by command line arguments
+ * @returns The state of the collector, or NULL if it could not be set up
+ */
+extern void *initPressureCollector(const MonitorOptions *options);
+
+/**
+ * Read the pressure stall information and compute the stall rates since the previous sample.
+ * @param state The state returned by initPressureCollector()
+ * @param thisSample Index of the sample, of which sample 0 only sets the baseline of the rates
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+extern int samplePressureCollector(void *state, long thisSample);
+
+/**
+ * Describe the record of the latest sample as the parts of a RECORD_TYPE_PRESSURE record.
+ * @param state The state returned by initPressureCollector()
+ * @param parts Parts of the record, of which the first entry is left free for the header
+ * @param timestamp Where to store the monotonic time the first resource was read at
+ * @returns The number of entries in parts including the header
+ */
+extern int encodePressureCollector(void *state, struct iovec *parts, double *timestamp);
+
+/**
+ * Close the files read by the pressure collector and release its state.
+ * @param state The state returned by initPressureCollector()
+ */
+extern void teardownPressureCollector(void *state);
+
+#endif
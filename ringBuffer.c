@@ -0,0 +1,77 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ringBuffer.h"
+
+/**
+ * Allocate the storage of a ring buffer.
+ * @param ring The ring buffer to initialize
+ * @param capacity Max number of elements held at once. Must be greater than zero.
+ * @param elementSize Size of a single element in bytes
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+int initRingBuffer(RingBuffer *ring, long capacity, size_t elementSize)
+{
+    ring->elementSize = elementSize;
+    ring->capacity = capacity;
+    ring->count = 0;
+    ring->next = 0;
+    ring->data = (char *)calloc(capacity, elementSize);
+    if (ring->data == NULL)
+    {
+        perror("calloc");
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Claim the slot for a new newest element, discarding the oldest element if the buffer is full.
+ * @param ring A ring buffer set up by initRingBuffer()
+ * @returns Pointer to the slot, which the caller fills in. It still holds the discarded element, or zero bytes if nothing was discarded.
+ */
+void *pushRingBuffer(RingBuffer *ring)
+{
+    void *slot = ring->data + ring->next * ring->elementSize;
+    ring->next = (ring->next + 1) % ring->capacity;
+    if (ring->count < ring->capacity)
+        ring->count++;
+    return slot;
+}
+
+/**
+ * Get an element counting back from the newest one.
+ * @param ring A ring buffer set up by initRingBuffer()
+ * @param age 0 for the newest element, 1 for the one before it, and so on
+ * @returns Pointer to the element, or NULL if fewer than age + 1 elements are held
+ */
+void *getRingBufferFromNewest(const RingBuffer *ring, long age)
+{
+    if (age < 0 || age >= ring->count)
+        return NULL;
+    long index = (ring->next - 1 - age + ring->capacity) % ring->capacity;
+    return ring->data + index * ring->elementSize;
+}
+
+/**
+ * Get an element counting forward from the oldest one.
+ * @param ring A ring buffer set up by initRingBuffer()
+ * @param index 0 for the oldest element, 1 for the one after it, and so on
+ * @returns Pointer to the element, or NULL if fewer than index + 1 elements are held
+ */
+void *getRingBufferFromOldest(const RingBuffer *ring, long index)
+{
+    return getRingBufferFromNewest(ring, ring->count - 1 - index);
+}
+
+/**
+ * Release the storage of a ring buffer.
+ * @param ring A ring buffer set up by initRingBuffer()
+ */
+void freeRingBuffer(RingBuffer *ring)
+{
+    free(ring->data);
+    ring->data = NULL;
+    ring->count = 0;
+    ring->next = 0;
+}
@@ -0,0 +1,72 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <stddef.h>
+
+/**
+ * Fixed-capacity history of equally sized elements. Once full, adding an element overwrites the oldest one,
+ * so memory use stays constant no matter how many elements are added.
+ */
+typedef struct ringBuffer
+{
+    /**
+     * Storage for capacity elements, allocated once by initRingBuffer()
+     */
+    char *data;
+    /**
+     * Size of a single element in bytes
+     */
+    size_t elementSize;
+    /**
+     * Max number of elements held at once
+     */
+    long capacity;
+    /**
+     * Number of elements currently held, at most capacity
+     */
+    long count;
+    /**
+     * Index in data of the slot the next element will be written to
+     */
+    long next;
+} RingBuffer;
+
+/**
+ * Allocate the storage of a ring buffer.
+ * @param ring The ring buffer to initialize
+ * @param capacity Max number of elements held at once. Must be greater than zero.
+ * @param elementSize Size of a single element in bytes
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+extern int initRingBuffer(RingBuffer *ring, long capacity, size_t elementSize);
+
+/**
+ * Claim the slot for a new newest element, discarding the oldest element if the buffer is full.
+ * @param ring A ring buffer set up by initRingBuffer()
+ * @returns Pointer to the slot, which the caller fills in. It still holds the discarded element, or zero bytes if nothing was discarded.
+ */
+extern void *pushRingBuffer(RingBuffer *ring);
+
+/**
+ * Get an element counting back from the newest one.
+ * @param ring A ring buffer set up by initRingBuffer()
+ * @param age 0 for the newest element, 1 for the one before it, and so on
+ * @returns Pointer to the element, or NULL if fewer than age + 1 elements are held
+ */
+extern void *getRingBufferFromNewest(const RingBuffer *ring, long age);
+
+/**
+ * Get an element counting forward from the oldest one.
+ * @param ring A ring buffer set up by initRingBuffer()
+ * @param index 0 for the oldest element, 1 for the one after it, and so on
+ * @returns Pointer to the element, or NULL if fewer than index + 1 elements are held
+ */
+extern void *getRingBufferFromOldest(const RingBuffer *ring, long index);
+
+/**
+ * Release the storage of a ring buffer.
+ * @param ring A ring buffer set up by initRingBuffer()
+ */
+extern void freeRingBuffer(RingBuffer *ring);
+
+#endif
@@ -0,0 +1,159 @@
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "parseArguments.h"
+#include "sampleRecord.h"
+#include "sampleExport.h"
+
+/**
+ * Writes the fields of a line one after the other, either as their names or as their values
+ */
+typedef struct exportWriter
+{
+    FILE *out;
+    int format;
+    /**
+     * Whether the names of the fields are written rather than their values, for the header of CSV
+     */
+    bool names;
+    int fieldCount;
+} ExportWriter;
+
+/**
+ * Write what comes before a field: the separator from the previous field, and the name of the field in NDJSON.
+ * @param writer The writer
+ * @param name Name of the field
+ */
+static void beginField(ExportWriter *writer, const char *name)
+{
+    if (writer->fieldCount++ > 0)
+        fputc(',', writer->out);
+    if (writer->names)
+        fputs(name, writer->out);
+    else if (writer->format == OUTPUT_FORMAT_NDJSON)
+        fprintf(writer->out, "\"%s\":", name);
+}
+
+/**
+ * Write a field holding a value that was not received, which is null in NDJSON and empty in CSV.
+ * @param writer The writer
+ */
+static void writeMissing(ExportWriter *writer)
+{
+    if (writer->format == OUTPUT_FORMAT_NDJSON)
+        fputs("null", writer->out);
+}
+
+/**
+ * Write a field holding a whole number.
+ * @param writer The writer
+ * @param name Name of the field
+ * @param present Whether the value was received
+ * @param value The value
+ */
+static void writeUnsigned(ExportWriter *writer, const char *name, bool present, uint64_t value)
+{
+    beginField(writer, name);
+    if (writer->names)
+        return;
+    if (present)
+        fprintf(writer->out, "%llu", (unsigned long long)value);
+    else
+        writeMissing(writer);
+}
+
+/**
+ * Write a field holding a real number. A value that is not finite, such as the utilization of an interval in which no
+ * CPU time passed, is written as missing since JSON has no way to write it.
+ * @param writer The writer
+ * @param name Name of the field
+ * @param present Whether the value was received
+ * @param value The value
+ * @param precision Number of digits after the decimal point
+ */
+static void writeReal(ExportWriter *writer, const char *name, bool present, double value, int precision)
+{
+    beginField(writer, name);
+    if (writer->names)
+        return;
+    if (present && isfinite(value))
+        fprintf(writer->out, "%.*f", precision, value);
+    else
+        writeMissing(writer);
+}
+
+/**
+ * Write every field of a line, in the order of the columns of CSV.
+ * @param writer The writer
+ * @param sample The values of the sample, which are not read when writing names
+ */
+static void writeFields(ExportWriter *writer, const ExportedSample *sample)
+{
+    static const ExportedSample none = {0};
+    if (writer->names)
+        sample = &none;
+    const CpuRecord *cpu = sample->cpu;
+    const MemoryRecord *memory = sample->memory;
+    const UsersRecord *users = sample->users;
+
+    writeUnsigned(writer, "sample", true, sample->sample);
+    writeReal(writer, "timestamp", true, sample->timestamp, 6);
+
+    writeUnsigned(writer, "cpu_user_ticks", cpu != NULL, cpu != NULL ? cpu->userTicks : 0);
+    writeUnsigned(writer, "cpu_nice_ticks", cpu != NULL, cpu != NULL ? cpu->niceTicks : 0);
+    writeUnsigned(writer, "cpu_system_ticks", cpu != NULL, cpu != NULL ? cpu->systemTicks : 0);
+    writeUnsigned(writer, "cpu_idle_ticks", cpu != NULL, cpu != NULL ? cpu->idleTicks : 0);
+    writeUnsigned(writer, "cpu_iowait_ticks", cpu != NULL, cpu != NULL ? cpu->iowaitTicks : 0);
+    writeUnsigned(writer, "cpu_irq_ticks", cpu != NULL, cpu != NULL ? cpu->irqTicks : 0);
+    writeUnsigned(writer, "cpu_softirq_ticks", cpu != NULL, cpu != NULL ? cpu->softirqTicks : 0);
+    writeUnsigned(writer, "cpu_steal_ticks", cpu != NULL, cpu != NULL ? cpu->stealTicks : 0);
+    writeReal(writer, "cpu_usage_percent", cpu != NULL, cpu != NULL ? cpu->usage : 0, 2);
+    writeReal(writer, "cpu_average_usage_percent", cpu != NULL, cpu != NULL ? cpu->averageUsage : 0, 2);
+
+    writeUnsigned(writer, "memory_phys_used_kb", memory != NULL, memory != NULL ? memory->physUsedKb : 0);
+    writeUnsigned(writer, "memory_phys_total_kb", memory != NULL, memory != NULL ? memory->physTotalKb : 0);
+    writeUnsigned(writer, "memory_virt_used_kb", memory != NULL, memory != NULL ? memory->virtUsedKb : 0);
+    writeUnsigned(writer, "memory_virt_total_kb", memory != NULL, memory != NULL ? memory->virtTotalKb : 0);
+    writeUnsigned(writer, "memory_available_kb", memory != NULL, memory != NULL ? memory->availableKb : 0);
+    writeUnsigned(writer, "memory_cached_kb", memory != NULL, memory != NULL ? memory->cachedKb : 0);
+    writeUnsigned(writer, "memory_buffers_kb", memory != NULL, memory != NULL ? memory->buffersKb : 0);
+    writeUnsigned(writer, "memory_shmem_kb", memory != NULL, memory != NULL ? memory->shmemKb : 0);
+    writeUnsigned(writer, "memory_slab_kb", memory != NULL, memory != NULL ? memory->slabKb : 0);
+    writeUnsigned(writer, "memory_dirty_kb", memory != NULL, memory != NULL ? memory->dirtyKb : 0);
+    writeUnsigned(writer, "memory_writeback_kb", memory != NULL, memory != NULL ? memory->writebackKb : 0);
+
+    writeUnsigned(writer, "sessions", users != NULL, users != NULL ? users->sessionCount : 0);
+}
+
+/**
+ * Write the line that starts the output of a format, which is the names of the columns for CSV and nothing for NDJSON.
+ * @param out Stream the line is written to
+ * @param format One of the OUTPUT_FORMAT_* formats other than OUTPUT_FORMAT_TEXT
+ */
+void formatExportHeader(FILE *out, int format)
+{
+    if (format != OUTPUT_FORMAT_CSV)
+        return;
+    ExportWriter writer = {out, format, true, 0};
+    writeFields(&writer, NULL);
+    fputc('\n', out);
+}
+
+/**
+ * Write a sample as a single line: a JSON object for NDJSON, or a row of the columns named by formatExportHeader() for CSV.
+ * @param out Stream the line is written to
+ * @param format One of the OUTPUT_FORMAT_* formats other than OUTPUT_FORMAT_TEXT
+ * @param sample The values of the sample
+ */
+void formatExportedSample(FILE *out, int format, const ExportedSample *sample)
+{
+    ExportWriter writer = {out, format, false, 0};
+    if (format == OUTPUT_FORMAT_NDJSON)
+        fputc('{', out);
+    writeFields(&writer, sample);
+    if (format == OUTPUT_FORMAT_NDJSON)
+        fputc('}', out);
+    fputc('\n', out);
+}
@@ -0,0 +1,43 @@
+#ifndef SAMPLE_EXPORT_H
+#define SAMPLE_EXPORT_H
+
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "sampleRecord.h"
+
+/**
+ * The raw values of a sample written as a single line by --format. Records that were not received fresh for the
+ * sample are NULL, and their fields are written as null in NDJSON and left empty in CSV.
+ */
+typedef struct exportedSample
+{
+    /**
+     * Index of the sample
+     */
+    long sample;
+    /**
+     * Monotonic time the sample was taken at, in seconds
+     */
+    double timestamp;
+    const MemoryRecord *memory;
+    const CpuRecord *cpu;
+    const UsersRecord *users;
+} ExportedSample;
+
+/**
+ * Write the line that starts the output of a format, which is the names of the columns for CSV and nothing for NDJSON.
+ * @param out Stream the line is written to
+ * @param format One of the OUTPUT_FORMAT_* formats other than OUTPUT_FORMAT_TEXT
+ */
+extern void formatExportHeader(FILE *out, int format);
+
+/**
+ * Write a sample as a single line: a JSON object for NDJSON, or a row of the columns named by formatExportHeader() for CSV.
+ * @param out Stream the line is written to
+ * @param format One of the OUTPUT_FORMAT_* formats other than OUTPUT_FORMAT_TEXT
+ * @param sample The values of the sample
+ */
+extern void formatExportedSample(FILE *out, int format, const ExportedSample *sample);
+
+#endif
@@ -0,0 +1,81 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+#include "arena.h"
+#include "collectorLink.h"
+#include "lowImpact.h"
+#include "sampleTimer.h"
+#include "sampleRecord.h"
+
+/**
+ * Send a record to the render loop, with its header and payload written at once, and notify it once the record is in
+ * the ring. Called by the collector.
+ * @param link The link of the collector
+ * @param type One of the RECORD_TYPE_* types
+ * @param sample Index of the sample the record belongs to
+ * @param timestamp Monotonic time the values were read at, in seconds
+ * @param collectSeconds Time spent taking the sample, in seconds
+ * @param parts Parts of the payload, of which the first entry is left free for the header
+ * @param partCount Number of entries in parts including the header, at most RECORD_MAX_PARTS
+ */
+void sendRecord(CollectorLink *link, int type, long sample, double timestamp, double collectSeconds,
+                struct iovec *parts, int partCount)
+{
+    RecordHeader header;
+    memset(&header, 0, sizeof(header));
+    header.version = SAMPLE_RECORD_VERSION;
+    header.type = type;
+    header.sample = sample;
+    header.timestamp = timestamp;
+    header.collectSeconds = collectSeconds;
+    header.sentAt = getMonotonicSeconds();
+    // the usage is cumulative, so the render loop shows the difference between the records of two samples
+    getThreadUsage(&header.usage);
+    for (int i = 1; i < partCount; i++)
+    {
+        header.length += parts[i].iov_len;
+    }
+    parts[0].iov_base = &header;
+    parts[0].iov_len = sizeof(header);
+
+    // the render loop reads the record as soon as it is notified, so it is only notified once the whole record is in
+    // the ring, unless the record is too large for the ring and can only be sent while the render loop reads it
+    if (sizeof(header) + header.length > link->data.capacity)
+        notifyParent(link);
+    writeVectorToParent(link, parts, partCount);
+    if (sizeof(header) + header.length <= link->data.capacity)
+        notifyParent(link);
+}
+
+/**
+ * Read a record sent by sendRecord() into memory that lives until the end of the sample. Called by the render loop.
+ * @param link The link of the collector
+ * @param type The RECORD_TYPE_* type expected from the collector
+ * @param arena Arena to allocate the payload from
+ * @param header Where to store the header of the record
+ * @param deadline Monotonic time in seconds to give up waiting for the record at, or INFINITY
+ * @returns The payload, or NULL if the collector is gone, did not send the record in time or sent a record of another
+ * version or type
+ */
+void *readRecord(CollectorLink *link, int type, Arena *arena, RecordHeader *header, double deadline)
+{
+    if (readFromCollector(link, header, sizeof(RecordHeader), deadline) <= 0)
+    {
+        return NULL;
+    }
+    if (header->version != SAMPLE_RECORD_VERSION || header->type != type || header->length > RECORD_MAX_LENGTH)
+    {
+        fprintf(stderr, "Received a record of version %u and type %u with %u bytes, expected version %d and type %d\n",
+                header->version, header->type, header->length, SAMPLE_RECORD_VERSION, type);
+        return NULL;
+    }
+    // an empty payload still gets its own memory, so NULL is only returned on failure
+    void *payload = allocateArena(arena, header->length > 0 ? header->length : 1);
+    if (payload == NULL || (header->length > 0 && readFromCollector(link, payload, header->length, deadline) <= 0))
+    {
+        return NULL;
+    }
+    return payload;
+}
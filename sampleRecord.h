@@ -0,0 +1,371 @@
+#ifndef SAMPLE_RECORD_H
+#define SAMPLE_RECORD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/uio.h>
+#include <utmp.h>
+
+#include "arena.h"
+#include "collectorLink.h"
+#include "lowImpact.h"
+#include "vmstatStats.h"
+#include "psiStats.h"
+#include "parseProcessStats.h"
+
+/**
+ * Version of the record layout, bumped whenever a record or its header changes
+ */
+#define SAMPLE_RECORD_VERSION 7
+
+/**
+ * Types of records, one per collector
+ */
+#define RECORD_TYPE_MEMORY 1
+#define RECORD_TYPE_CPU 2
+#define RECORD_TYPE_USERS 3
+#define RECORD_TYPE_PROCESSES 4
+#define RECORD_TYPE_PRESSURE 5
+
+/**
+ * Largest payload accepted by readRecord(), which guards against a corrupt length
+ */
+#define RECORD_MAX_LENGTH (256 * 1024 * 1024)
+
+/**
+ * Max number of parts a record is sent in, including its header
+ */
+#define RECORD_MAX_PARTS 8
+
+/**
+ * Flag of a UsersRecord whose UserUsageRecords carry no usage, which is left to the OwnerUsageRecords of the
+ * RECORD_TYPE_PROCESSES record so that /proc is scanned once per sample rather than by both collectors
+ */
+#define USERS_FLAG_SHARED_SCAN 1
+
+/**
+ * Flags of a MemoryRecord or CpuRecord
+ */
+#define RECORD_FLAG_CGROUP 1
+#define RECORD_FLAG_CGROUP_LIMITED 2
+#define RECORD_FLAG_CGROUP_MISSING 4
+
+/**
+ * Sent ahead of every record. Records only travel between the collectors and the render loop of a single monitor, so
+ * every field is in the native byte order and layout.
+ */
+typedef struct recordHeader
+{
+    /**
+     * SAMPLE_RECORD_VERSION of the collector that sent the record
+     */
+    uint16_t version;
+    /**
+     * One of the RECORD_TYPE_* types
+     */
+    uint16_t type;
+    /**
+     * Number of bytes of the payload following the header
+     */
+    uint32_t length;
+    /**
+     * Index of the sample the record belongs to
+     */
+    int64_t sample;
+    /**
+     * Monotonic time the collector read the values at, in seconds
+     */
+    double timestamp;
+    /**
+     * CPU time, context switches and heap allocations of the collector since it started, measured as the record is sent
+     */
+    ThreadUsage usage;
+    /**
+     * Time the collector spent taking the sample, in seconds
+     */
+    double collectSeconds;
+    /**
+     * Monotonic time the collector started sending the record at, in seconds
+     */
+    double sentAt;
+} RecordHeader;
+
+/**
+ * Memory of a NUMA node, following a MemoryRecord
+ */
+typedef struct numaMemoryRecord
+{
+    /**
+     * MemTotal, MemUsed and FilePages of the node, in kilobytes
+     */
+    uint64_t totalKb, usedKb, filePagesKb;
+    /**
+     * numa_miss and numa_foreign since the previous sample, in pages per second
+     */
+    double missRate, foreignRate;
+    /**
+     * Number N of the nodeN directory
+     */
+    int32_t id;
+} NumaMemoryRecord;
+
+/**
+ * Payload of a RECORD_TYPE_MEMORY record, followed by numaNodeCount NumaMemoryRecords and then the null terminated
+ * cgroup name of cgroupNameLength characters
+ */
+typedef struct memoryRecord
+{
+    /**
+     * Paging and swap rates, indexed by the PAGING_RATE_* slots
+     */
+    double pagingRates[PAGING_RATE_COUNT];
+    /**
+     * Physical and virtual memory in use and in total, in kilobytes as /proc/meminfo reports them
+     */
+    uint64_t physUsedKb, physTotalKb, virtUsedKb, virtTotalKb;
+    /**
+     * Memory that can be given to new allocations without swapping, in kilobytes
+     */
+    uint64_t availableKb;
+    /**
+     * Page cache, buffers, shared memory and kernel slab, in kilobytes
+     */
+    uint64_t cachedKb, buffersKb, shmemKb, slabKb;
+    /**
+     * Anonymous memory of the cgroup and its memory limit, in kilobytes, only set with RECORD_FLAG_CGROUP
+     */
+    uint64_t anonKb, limitKb;
+    /**
+     * Pages waiting to be written back and being written back, in kilobytes
+     */
+    uint64_t dirtyKb, writebackKb;
+    /**
+     * RECORD_FLAG_* flags
+     */
+    uint32_t flags;
+    uint32_t numaNodeCount;
+    uint32_t cgroupNameLength;
+} MemoryRecord;
+
+/**
+ * Utilization of a single core, following a CpuRecord
+ */
+typedef struct coreRecord
+{
+    /**
+     * The N of the cpuN line in /proc/stat
+     */
+    int32_t id;
+    float usage;
+} CoreRecord;
+
+/**
+ * Utilization of the CPUs of a NUMA node, following a CpuRecord
+ */
+typedef struct numaCpuRecord
+{
+    /**
+     * Number N of the nodeN directory
+     */
+    int32_t id;
+    /**
+     * Number of CPUs attached to the node, and the number of them that were online and averaged
+     */
+    int32_t cpuCount, usageCount;
+    /**
+     * Average utilization of the online CPUs of the node
+     */
+    float usage;
+} NumaCpuRecord;
+
+/**
+ * Payload of a RECORD_TYPE_CPU record, followed by coreRecordCount CoreRecords, numaNodeCount NumaCpuRecords and then
+ * the null terminated cgroup name of cgroupNameLength characters
+ */
+typedef struct cpuRecord
+{
+    /**
+     * Number of CPUs worth of time the cgroup may use, or 0 if it has no quota, only set with RECORD_FLAG_CGROUP
+     */
+    double cgroupLimitCpus;
+    /**
+     * Periods of the cgroup, the periods in which it was throttled and the time it was throttled for in microseconds
+     */
+    uint64_t cgroupPeriods, cgroupThrottledPeriods, cgroupThrottledUsec;
+    /**
+     * Time the host spent in each state since boot, from the cpu line of /proc/stat, in clock ticks
+     */
+    uint64_t userTicks, niceTicks, systemTicks, idleTicks, iowaitTicks, irqTicks, softirqTicks, stealTicks;
+    /**
+     * Utilization since the first sample and since the previous sample, with 100 representing 100%
+     */
+    float averageUsage, usage;
+    /**
+     * Number of packages, online logical CPUs and physical cores
+     */
+    int32_t processorCount, coreCount, physicalCoreCount;
+    /**
+     * RECORD_FLAG_* flags
+     */
+    uint32_t flags;
+    uint32_t coreRecordCount;
+    uint32_t numaNodeCount;
+    uint32_t cgroupNameLength;
+} CpuRecord;
+
+/**
+ * The combined usage of the processes of a logged in user, following a UsersRecord
+ */
+typedef struct userUsageRecord
+{
+    /**
+     * Sum of the resident set size of the user's processes, in bytes
+     */
+    uint64_t rssBytes;
+    /**
+     * Sum of the CPU utilization of the user's processes, where 100 is one fully used core
+     */
+    float cpuUsage;
+    int32_t processCount;
+    uint32_t uid;
+    char user[UT_NAMESIZE + 1];
+} UserUsageRecord;
+
+/**
+ * A session that was added since the previous record, following a UsersRecord
+ */
+typedef struct userSessionRecord
+{
+    /**
+     * Id that identifies the session when it is removed
+     */
+    int32_t id;
+    int32_t pid;
+    char user[UT_NAMESIZE + 1];
+    char line[UT_LINESIZE + 1];
+    char host[UT_HOSTSIZE + 1];
+} UserSessionRecord;
+
+/**
+ * Payload of a RECORD_TYPE_USERS record, followed by userCount UserUsageRecords, addedCount UserSessionRecords and
+ * the int32_t ids of the removedCount sessions that were removed
+ */
+typedef struct usersRecord
+{
+    /**
+     * Number of sessions logged in once the changes are applied
+     */
+    uint32_t sessionCount;
+    /**
+     * USERS_FLAG_* flags
+     */
+    uint32_t flags;
+    uint32_t userCount;
+    uint32_t addedCount;
+    uint32_t removedCount;
+} UsersRecord;
+
+/**
+ * A process listed among the top processes, following a ProcessesRecord
+ */
+typedef struct processRecord
+{
+    /**
+     * Resident set size, in bytes
+     */
+    uint64_t rssBytes;
+    /**
+     * CPU utilization, where 100 is one fully used core
+     */
+    float cpuUsage;
+    int32_t pid;
+    char name[PROCESS_NAME_LENGTH];
+} ProcessRecord;
+
+/**
+ * The combined usage of the processes of a single owner, following the ProcessRecords of a ProcessesRecord
+ */
+typedef struct ownerUsageRecord
+{
+    /**
+     * Sum of the resident set size of the owner's processes, in bytes
+     */
+    uint64_t rssBytes;
+    /**
+     * Sum of the CPU utilization of the owner's processes, where 100 is one fully used core
+     */
+    float cpuUsage;
+    int32_t processCount;
+    uint32_t uid;
+} OwnerUsageRecord;
+
+/**
+ * Payload of a RECORD_TYPE_PROCESSES record, followed by listedCount ProcessRecords ranked by CPU, listedCount
+ * ProcessRecords ranked by memory and then ownerCount OwnerUsageRecords
+ */
+typedef struct processesRecord
+{
+    /**
+     * Number of processes on the system
+     */
+    uint32_t processCount;
+    uint32_t listedCount;
+    /**
+     * Number of owners whose usage is sent for the user collector, which is 0 unless the users section is shown
+     */
+    uint32_t ownerCount;
+} ProcessesRecord;
+
+/**
+ * Pressure stall information of one resource, as part of a PressureRecord
+ */
+typedef struct pressureResourceRecord
+{
+    /**
+     * Averages and total stall time of the "some" and "full" lines
+     */
+    PsiLine some, full;
+    /**
+     * Time stalled since the previous sample, in milliseconds per second
+     */
+    double someStallRate, fullStallRate;
+} PressureResourceRecord;
+
+/**
+ * Payload of a RECORD_TYPE_PRESSURE record
+ */
+typedef struct pressureRecord
+{
+    /**
+     * Every resource, indexed by PSI_CPU, PSI_MEMORY and PSI_IO
+     */
+    PressureResourceRecord resources[PSI_RESOURCE_COUNT];
+} PressureRecord;
+
+/**
+ * Send a record to the render loop, with its header and payload written at once, and notify it once the record is in
+ * the ring. Called by the collector.
+ * @param link The link of the collector
+ * @param type One of the RECORD_TYPE_* types
+ * @param sample Index of the sample the record belongs to
+ * @param timestamp Monotonic time the values were read at, in seconds
+ * @param collectSeconds Time spent taking the sample, in seconds
+ * @param parts Parts of the payload, of which the first entry is left free for the header
+ * @param partCount Number of entries in parts including the header, at most RECORD_MAX_PARTS
+ */
+extern void sendRecord(CollectorLink *link, int type, long sample, double timestamp, double collectSeconds,
+                       struct iovec *parts, int partCount);
+
+/**
+ * Read a record sent by sendRecord() into memory that lives until the end of the sample. Called by the render loop.
+ * @param link The link of the collector
+ * @param type The RECORD_TYPE_* type expected from the collector
+ * @param arena Arena to allocate the payload from
+ * @param header Where to store the header of the record
+ * @param deadline Monotonic time in seconds to give up waiting for the record at, or INFINITY
+ * @returns The payload, or NULL if the collector is gone, did not send the record in time or sent a record of another
+ * version or type
+ */
+extern void *readRecord(CollectorLink *link, int type, Arena *arena, RecordHeader *header, double deadline);
+
+#endif
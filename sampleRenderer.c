@@ -0,0 +1,789 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "heapCounter.h"
+#include "arena.h"
+#include "cgroupStats.h"
+#include "numaStats.h"
+#include "vmstatStats.h"
+#include "psiStats.h"
+#include "sessionStore.h"
+#include "parseArguments.h"
+#include "parseMemoryStats.h"
+#include "parseCpuStats.h"
+#include "parseProcessStats.h"
+#include "printUsers.h"
+#include "sampleRecord.h"
+#include "sampleRenderer.h"
+
+/**
+ * Set up a renderer that has not seen any records.
+ * @param renderer The renderer to initialize
+ * @param options The settings given by command line arguments
+ * @param memoryHistory Ring buffer the memory usage line of each sample is pushed to
+ * @param cpuHistory Ring buffer the CPU usage line of each sample is pushed to
+ * @param sessions The sessions kept by the parent between samples
+ */
+void initSampleRenderer(SampleRenderer *renderer, const MonitorOptions *options, RingBuffer *memoryHistory,
+                        RingBuffer *cpuHistory, UserSessionStore *sessions)
+{
+    memset(renderer, 0, sizeof(SampleRenderer));
+    renderer->showGraphics = options->showGraphics;
+    renderer->memoryHistory = memoryHistory;
+    renderer->cpuHistory = cpuHistory;
+    renderer->sessions = sessions;
+}
+
+/**
+ * Release the records a renderer keeps between samples.
+ * @param renderer A renderer set up by initSampleRenderer()
+ */
+void freeSampleRenderer(SampleRenderer *renderer)
+{
+    free(renderer->sharedUsers);
+    free(renderer->owners);
+    free(renderer->ownerSlots);
+    renderer->sharedUsers = NULL;
+    renderer->owners = NULL;
+    renderer->ownerSlots = NULL;
+}
+
+/**
+ * Mark every string of a rendered sample as not received.
+ * @param rendered The rendered sample to clear
+ */
+void clearRenderedSample(RenderedSample *rendered)
+{
+    rendered->memoryBreakdown = NULL;
+    rendered->pagingRates = NULL;
+    rendered->numaMemory = NULL;
+    rendered->averageCpuUsage = NULL;
+    rendered->coreCpuUsage = NULL;
+    rendered->numaCpuUsage = NULL;
+    rendered->topProcesses = NULL;
+    rendered->pressureInfo = NULL;
+    rendered->userUsage = NULL;
+}
+
+/**
+ * Check the length of a record's payload against the length its counts call for.
+ * @param header Header of the record
+ * @param length Number of bytes the payload should have
+ * @returns true if the lengths match, false otherwise
+ */
+static bool recordLengthMatches(const RecordHeader *header, size_t length)
+{
+    if (header->length == length)
+        return true;
+    fprintf(stderr, "Received a record of type %u with %u bytes, expected %zu\n", header->type, header->length, length);
+    return false;
+}
+
+/**
+ * Copy records into a buffer kept between samples, which only grows when more records arrive than ever before.
+ * @param buffer The buffer, which may be NULL
+ * @param capacity Number of records the buffer holds, updated if it grows
+ * @param records The records to copy
+ * @param count Number of records to copy
+ * @param size Size of a record in bytes
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+static int keepRecords(void **buffer, uint32_t *capacity, const void *records, uint32_t count, size_t size)
+{
+    if (count > *capacity)
+    {
+        noteHeapAllocation();
+        void *larger = realloc(*buffer, size * count);
+        if (larger == NULL)
+        {
+            perror("realloc");
+            return 1;
+        }
+        *buffer = larger;
+        *capacity = count;
+    }
+    if (count > 0)
+        memcpy(*buffer, records, size * count);
+    return 0;
+}
+
+/**
+ * Allocate an empty string from the sample arena.
+ * @param arena Arena to allocate from
+ * @param length Size of the string in bytes, including its null terminator
+ * @returns The string, or NULL if the heap is exhausted
+ */
+static char *allocateString(Arena *arena, size_t length)
+{
+    char *string = (char *)allocateArena(arena, length);
+    if (string != NULL)
+        string[0] = '\0';
+    return string;
+}
+
+/**
+ * Convert kilobytes, as the memory collector sends them, to gigabytes.
+ * @param kilobytes The amount of memory in kilobytes
+ * @returns The amount of memory in gigabytes
+ */
+static double kilobytesToGigabytes(uint64_t kilobytes)
+{
+    return kilobytes / (double)(GIGABYTE_BYTE_SIZE / KILOBYTE_BYTE_SIZE);
+}
+
+/**
+ * Convert kilobytes, as the memory collector sends them, to megabytes.
+ * @param kilobytes The amount of memory in kilobytes
+ * @returns The amount of memory in megabytes
+ */
+static double kilobytesToMegabytes(uint64_t kilobytes)
+{
+    return kilobytes / (double)KILOBYTE_BYTE_SIZE;
+}
+
+/**
+ * Write a string representing the change in memory usage using graphical bars into the given buffer.
+ * @param previous The previous record, or NULL if this is the first sample
+ * @param current The current record
+ * @param deltaChange Buffer of GRAPHICS_MAX_BAR_COUNT + GRAPHICS_MAX_NUM_COUNT bytes to write the graphical display to
+ */
+static void calculateDelta(const MemoryRecord *previous, const MemoryRecord *current, char *deltaChange)
+{
+    double virtUsed = kilobytesToGigabytes(current->virtUsedKb);
+    if (previous == NULL)
+    {
+        // First entry
+        snprintf(deltaChange, GRAPHICS_MAX_BAR_COUNT, "|o 0.00 (%.2f)", virtUsed);
+        return;
+    }
+
+    // initialize the string to start with | and end with null terminator
+    deltaChange[0] = '|';
+    for (int i = 1; i < GRAPHICS_MAX_BAR_COUNT + GRAPHICS_MAX_NUM_COUNT - 1; i++)
+    {
+        deltaChange[i] = ' ';
+    }
+    deltaChange[GRAPHICS_MAX_BAR_COUNT + GRAPHICS_MAX_NUM_COUNT - 1] = '\0';
+
+    // calculate the net change in gigabytes, in absolute and percentage difference
+    float delta = virtUsed - kilobytesToGigabytes(previous->virtUsedKb);
+    float deltaPercentage = delta / kilobytesToGigabytes(current->virtTotalKb);
+
+    // the maximum number of relative change bars we can display, while leaving space for starting bar (|), ending symbol (* or @) and null terminator
+    int maxChangeBars = GRAPHICS_MAX_BAR_COUNT - 3;
+
+    // if change was positive (more memory is being used)
+    if (deltaPercentage > 0)
+    {
+        int bars = (int)(deltaPercentage * maxChangeBars);
+        for (int i = 1; i <= bars; i++)
+        {
+            deltaChange[i] = '#';
+        }
+        deltaChange[bars + 1] = '*';
+        deltaChange[bars + 2] = '\0';
+    }
+    // if change was positive (less memory being used)
+    else if (deltaPercentage < 0)
+    {
+        int bars = (int)(-deltaPercentage * maxChangeBars);
+        for (int i = 1; i <= bars; i++)
+        {
+            deltaChange[i] = ':';
+        }
+        deltaChange[bars + 1] = '@';
+        deltaChange[bars + 2] = '\0';
+    }
+    else // change of zero
+    {
+        snprintf(deltaChange, GRAPHICS_MAX_BAR_COUNT, "|o 0.00 (%.2f)", virtUsed);
+        return;
+    }
+
+    char deltaNum[GRAPHICS_MAX_NUM_COUNT] = "";
+    // print the change in memory numerically
+    snprintf(deltaNum, GRAPHICS_MAX_NUM_COUNT, " %.2f (%.2f)", delta, virtUsed);
+
+    // add the numerical stats at the end of the graphical representation
+    strncat(deltaChange, deltaNum, GRAPHICS_MAX_NUM_COUNT);
+}
+
+/**
+ * Write the breakdown of the memory in use into the given buffer.
+ * @param record The memory record
+ * @param cgroupName Path of the cgroup the record was measured for
+ * @param output Buffer to write the breakdown to
+ * @param outputLength Size of output in bytes
+ */
+static void renderMemoryBreakdown(const MemoryRecord *record, const char *cgroupName, char *output, size_t outputLength)
+{
+    size_t written = 0;
+    if (record->flags & RECORD_FLAG_CGROUP_MISSING)
+    {
+        written = snprintf(output, outputLength, "Cgroup %s has no memory controller, showing host memory\n", cgroupName);
+    }
+    if (!(record->flags & RECORD_FLAG_CGROUP))
+    {
+        snprintf(output + written, outputLength - written, "Available: %.2f GB, Cached: %.2f GB, Buffers: %.2f GB, Shmem: %.2f GB, Slab: %.2f GB, Dirty: %.1f MB, Writeback: %.1f MB\n",
+                 kilobytesToGigabytes(record->availableKb), kilobytesToGigabytes(record->cachedKb), kilobytesToGigabytes(record->buffersKb),
+                 kilobytesToGigabytes(record->shmemKb), kilobytesToGigabytes(record->slabKb), kilobytesToMegabytes(record->dirtyKb),
+                 kilobytesToMegabytes(record->writebackKb));
+    }
+    else if (record->flags & RECORD_FLAG_CGROUP_LIMITED)
+    {
+        snprintf(output, outputLength, "Cgroup %s: Limit: %.2f GB, Available: %.2f GB, Anon: %.2f GB, File: %.2f GB, Shmem: %.2f GB, Slab: %.2f GB, Dirty: %.1f MB, Writeback: %.1f MB\n",
+                 cgroupName, kilobytesToGigabytes(record->limitKb), kilobytesToGigabytes(record->availableKb), kilobytesToGigabytes(record->anonKb),
+                 kilobytesToGigabytes(record->cachedKb), kilobytesToGigabytes(record->shmemKb), kilobytesToGigabytes(record->slabKb),
+                 kilobytesToMegabytes(record->dirtyKb), kilobytesToMegabytes(record->writebackKb));
+    }
+    else
+    {
+        snprintf(output, outputLength, "Cgroup %s: Limit: none, Anon: %.2f GB, File: %.2f GB, Shmem: %.2f GB, Slab: %.2f GB, Dirty: %.1f MB, Writeback: %.1f MB\n",
+                 cgroupName, kilobytesToGigabytes(record->anonKb), kilobytesToGigabytes(record->cachedKb), kilobytesToGigabytes(record->shmemKb),
+                 kilobytesToGigabytes(record->slabKb), kilobytesToMegabytes(record->dirtyKb), kilobytesToMegabytes(record->writebackKb));
+    }
+}
+
+/**
+ * Write the memory usage and the numa_miss and numa_foreign rates of every node into the given buffer, one node per line.
+ * @param nodes The records of the nodes
+ * @param nodeCount Number of nodes
+ * @param output Buffer to write the information to
+ * @param outputLength Size of output in bytes, at least nodeCount * NUMA_MEMORY_OUTPUT_LENGTH
+ */
+static void renderNumaMemory(const NumaMemoryRecord *nodes, uint32_t nodeCount, char *output, size_t outputLength)
+{
+    size_t written = 0;
+    output[0] = '\0';
+    for (uint32_t i = 0; i < nodeCount && written < outputLength; i++)
+    {
+        // meminfo values are in kilobytes
+        double total = nodes[i].totalKb / 1048576.0;
+        double used = nodes[i].usedKb / 1048576.0;
+        written += snprintf(output + written, outputLength - written,
+                            "\tnode%-3d %.2f GB / %.2f GB used (%.1f%%), File: %.2f GB, Miss: %.1f/s, Foreign: %.1f/s\n",
+                            nodes[i].id, used, total, total > 0 ? used / total * 100 : 0.0, nodes[i].filePagesKb / 1048576.0,
+                            nodes[i].missRate, nodes[i].foreignRate);
+    }
+}
+
+/**
+ * Render a RECORD_TYPE_MEMORY record: its usage line, pushed to the memory history, breakdown, paging rates and the memory of each NUMA node.
+ * @param renderer The renderer
+ * @param header Header of the record
+ * @param payload Payload of the record
+ * @param rendered Where to store the rendered strings
+ * @param arena Arena the strings are allocated from
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+int renderMemoryRecord(SampleRenderer *renderer, const RecordHeader *header, const void *payload,
+                       RenderedSample *rendered, Arena *arena)
+{
+    const MemoryRecord *record = (const MemoryRecord *)payload;
+    if (!recordLengthMatches(header, header->length < sizeof(MemoryRecord) ? sizeof(MemoryRecord)
+                                                                           : sizeof(MemoryRecord) + sizeof(NumaMemoryRecord) * record->numaNodeCount + record->cgroupNameLength + 1))
+    {
+        return 1;
+    }
+    const NumaMemoryRecord *nodes = (const NumaMemoryRecord *)(record + 1);
+    const char *cgroupName = (const char *)(nodes + record->numaNodeCount);
+
+    char *historyLine = (char *)pushRingBuffer(renderer->memoryHistory);
+    size_t historyLineLength = renderer->memoryHistory->elementSize;
+    if (renderer->showGraphics)
+    {
+        char memoryGraphics[GRAPHICS_MAX_BAR_COUNT + GRAPHICS_MAX_NUM_COUNT];
+        calculateDelta(renderer->hasPreviousMemory ? &renderer->previousMemory : NULL, record, memoryGraphics);
+        snprintf(historyLine, historyLineLength, "%.2f GB / %.2f GB -- %.2f GB / %.2f GB \t%s\n",
+                 kilobytesToGigabytes(record->physUsedKb), kilobytesToGigabytes(record->physTotalKb),
+                 kilobytesToGigabytes(record->virtUsedKb), kilobytesToGigabytes(record->virtTotalKb), memoryGraphics);
+    }
+    else
+    {
+        snprintf(historyLine, historyLineLength, "%.2f GB / %.2f GB -- %.2f GB / %.2f GB\n",
+                 kilobytesToGigabytes(record->physUsedKb), kilobytesToGigabytes(record->physTotalKb),
+                 kilobytesToGigabytes(record->virtUsedKb), kilobytesToGigabytes(record->virtTotalKb));
+    }
+    renderer->previousMemory = *record;
+    renderer->hasPreviousMemory = true;
+
+    size_t breakdownLength = MEMORY_OUTPUT_LENGTH * 2 + record->cgroupNameLength * 2;
+    size_t pagingLength = PAGING_RATE_COUNT * PAGING_OUTPUT_LENGTH;
+    rendered->memoryBreakdown = allocateString(arena, breakdownLength);
+    rendered->pagingRates = allocateString(arena, pagingLength);
+    if (rendered->memoryBreakdown == NULL || rendered->pagingRates == NULL)
+    {
+        return 1;
+    }
+    renderMemoryBreakdown(record, cgroupName, rendered->memoryBreakdown, breakdownLength);
+    renderPagingRates(record->pagingRates, renderer->showGraphics, rendered->pagingRates, pagingLength);
+
+    if (record->numaNodeCount > 0)
+    {
+        size_t numaLength = (size_t)record->numaNodeCount * NUMA_MEMORY_OUTPUT_LENGTH;
+        rendered->numaMemory = allocateString(arena, numaLength);
+        if (rendered->numaMemory == NULL)
+        {
+            return 1;
+        }
+        renderNumaMemory(nodes, record->numaNodeCount, rendered->numaMemory, numaLength);
+    }
+    return 0;
+}
+
+/**
+ * Write a string representing the specified change in CPU utilization graphically into the given buffer.
+ * The display begins with a [ character, followed by a number of | characters proportional to the CPU utilization level
+ * @param cpuUsage The value of CPU utilization to be displayed. 100 = 100%.
+ * @param deltaChange Buffer of GRAPHICS_MAX_CPU_BAR_COUNT + GRAPHICS_MAX_CPU_NUM_COUNT bytes to write the graphical display to
+ */
+static void renderCPUUsage(float cpuUsage, char *deltaChange)
+{
+    deltaChange[0] = '[';
+    for (int i = 1; i < GRAPHICS_MAX_CPU_BAR_COUNT + GRAPHICS_MAX_CPU_NUM_COUNT - 1; i++)
+    {
+        deltaChange[i] = ' ';
+    }
+    deltaChange[GRAPHICS_MAX_CPU_BAR_COUNT + GRAPHICS_MAX_CPU_NUM_COUNT - 1] = '\0';
+
+    // the bar is clamped to the buffer, which a utilization that is not a number would otherwise overrun
+    float barUsage = cpuUsage > 0 ? cpuUsage : 0;
+    if (barUsage > 100)
+        barUsage = 100;
+    int bars = barUsage / 100.0 * GRAPHICS_MAX_CPU_BAR_COUNT;
+    for (int i = 1; i <= (int)(bars); i++)
+    {
+        deltaChange[i] = '|';
+    }
+    deltaChange[bars + 1] = '\0';
+
+    char deltaNum[GRAPHICS_MAX_CPU_NUM_COUNT] = "";
+    snprintf(deltaNum, GRAPHICS_MAX_CPU_NUM_COUNT, " %.2f%%", cpuUsage);
+
+    strncat(deltaChange, deltaNum, GRAPHICS_MAX_CPU_NUM_COUNT);
+}
+
+/**
+ * Write a human readable listing of the utilization of each core into the given buffer.
+ * Without graphics the cores are listed several per line, and with graphics each core gets its own line with a bar
+ * of | characters proportional to its utilization.
+ * @param cores The utilization of each core
+ * @param coreCount Number of cores
+ * @param showGraphics Command line argument for whether to show CPU use graphics
+ * @param output Buffer where the listing is written
+ * @param outputLength Size of output in bytes
+ */
+static void renderCoreUsage(const CoreRecord *cores, uint32_t coreCount, bool showGraphics, char *output, size_t outputLength)
+{
+    size_t written = 0;
+    output[0] = '\0';
+    for (uint32_t i = 0; i < coreCount && written < outputLength; i++)
+    {
+        if (showGraphics)
+        {
+            char bar[GRAPHICS_MAX_CORE_BAR_COUNT + 1];
+            int bars = cores[i].usage / 100.0 * GRAPHICS_MAX_CORE_BAR_COUNT;
+            if (bars > GRAPHICS_MAX_CORE_BAR_COUNT)
+                bars = GRAPHICS_MAX_CORE_BAR_COUNT;
+            memset(bar, ' ', GRAPHICS_MAX_CORE_BAR_COUNT);
+            memset(bar, '|', bars);
+            bar[GRAPHICS_MAX_CORE_BAR_COUNT] = '\0';
+            written += snprintf(output + written, outputLength - written, "\tcpu%-4d [%s] %6.2f%%\n", cores[i].id, bar, cores[i].usage);
+        }
+        else
+        {
+            // separate cores with tabs and end each row with a newline
+            bool endOfRow = (i + 1) % CORES_PER_ROW == 0 || i + 1 == coreCount;
+            written += snprintf(output + written, outputLength - written, "%scpu%-4d %6.2f%%%s",
+                                i % CORES_PER_ROW == 0 ? "\t" : "  ", cores[i].id, cores[i].usage, endOfRow ? "\n" : "");
+        }
+    }
+}
+
+/**
+ * Write the average utilization of the CPUs of every node into the given buffer, one node per line.
+ * @param nodes The records of the nodes
+ * @param nodeCount Number of nodes
+ * @param output Buffer to write the information to
+ * @param outputLength Size of output in bytes, at least nodeCount * NUMA_CPU_OUTPUT_LENGTH
+ */
+static void renderNumaCpuUsage(const NumaCpuRecord *nodes, uint32_t nodeCount, char *output, size_t outputLength)
+{
+    size_t written = 0;
+    output[0] = '\0';
+    for (uint32_t i = 0; i < nodeCount && written < outputLength; i++)
+    {
+        // memory-only nodes have no CPUs to report
+        if (nodes[i].cpuCount == 0)
+            continue;
+        written += snprintf(output + written, outputLength - written, "\tnode%-3d %6.2f%% across %d of %d CPUs\n",
+                            nodes[i].id, nodes[i].usage, nodes[i].usageCount, nodes[i].cpuCount);
+    }
+}
+
+/**
+ * Render a RECORD_TYPE_CPU record: its counts, average and usage line, pushed to the CPU history, and the usage of each core and NUMA node.
+ * @param renderer The renderer
+ * @param header Header of the record
+ * @param payload Payload of the record
+ * @param rendered Where to store the rendered strings
+ * @param arena Arena the strings are allocated from
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+int renderCpuRecord(SampleRenderer *renderer, const RecordHeader *header, const void *payload,
+                    RenderedSample *rendered, Arena *arena)
+{
+    const CpuRecord *record = (const CpuRecord *)payload;
+    if (!recordLengthMatches(header, header->length < sizeof(CpuRecord) ? sizeof(CpuRecord)
+                                                                        : sizeof(CpuRecord) + sizeof(CoreRecord) * record->coreRecordCount +
+                                                                              sizeof(NumaCpuRecord) * record->numaNodeCount + record->cgroupNameLength + 1))
+    {
+        return 1;
+    }
+    const CoreRecord *cores = (const CoreRecord *)(record + 1);
+    const NumaCpuRecord *nodes = (const NumaCpuRecord *)(cores + record->coreRecordCount);
+    const char *cgroupName = (const char *)(nodes + record->numaNodeCount);
+
+    rendered->processorCount = record->processorCount;
+    rendered->coreCount = record->coreCount;
+    rendered->physicalCoreCount = record->physicalCoreCount;
+
+    // average since start
+    size_t averageLength = MEMORY_OUTPUT_LENGTH + record->cgroupNameLength;
+    rendered->averageCpuUsage = allocateString(arena, averageLength);
+    if (rendered->averageCpuUsage == NULL)
+    {
+        return 1;
+    }
+    char *average = rendered->averageCpuUsage;
+    int written = snprintf(average, averageLength, "\tAverage Usage = %.4f%%\n", record->averageUsage);
+    if (record->flags & RECORD_FLAG_CGROUP)
+    {
+        written += snprintf(average + written, averageLength - written, "\tCgroup %s: Limit: ", cgroupName);
+        if (record->cgroupLimitCpus > 0)
+            written += snprintf(average + written, averageLength - written, "%.2f CPUs", record->cgroupLimitCpus);
+        else
+            written += snprintf(average + written, averageLength - written, "none");
+        snprintf(average + written, averageLength - written, ", Throttled: %llu of %llu periods (%.1f ms)\n",
+                 (unsigned long long)record->cgroupThrottledPeriods, (unsigned long long)record->cgroupPeriods,
+                 record->cgroupThrottledUsec / 1000.0);
+    }
+    else if (record->flags & RECORD_FLAG_CGROUP_MISSING)
+    {
+        snprintf(average + written, averageLength - written, "\tCgroup %s has no CPU controller, showing host CPU\n", cgroupName);
+    }
+
+    // print the change in cpu % usage from the previous sample, or only the % usage if this is the first sample
+    float absChange = renderer->hasPreviousCpu ? record->usage - renderer->previousCpuUsage : 0.0;
+    char *historyLine = (char *)pushRingBuffer(renderer->cpuHistory);
+    size_t historyLineLength = renderer->cpuHistory->elementSize;
+    if (renderer->showGraphics)
+    {
+        char cpuGraphics[GRAPHICS_MAX_CPU_BAR_COUNT + GRAPHICS_MAX_CPU_NUM_COUNT];
+        renderCPUUsage(record->usage, cpuGraphics);
+        snprintf(historyLine, historyLineLength, "%.2f%% (%.2f) \t%s\n", record->usage, absChange, cpuGraphics);
+    }
+    else
+    {
+        snprintf(historyLine, historyLineLength, "%.2f%% (%.2f)\n", record->usage, absChange);
+    }
+    renderer->previousCpuUsage = record->usage;
+    renderer->hasPreviousCpu = true;
+
+    if (record->coreRecordCount > 0)
+    {
+        size_t coreLength = (size_t)record->coreRecordCount * CORE_OUTPUT_LENGTH;
+        rendered->coreCpuUsage = allocateString(arena, coreLength);
+        if (rendered->coreCpuUsage == NULL)
+        {
+            return 1;
+        }
+        renderCoreUsage(cores, record->coreRecordCount, renderer->showGraphics, rendered->coreCpuUsage, coreLength);
+    }
+    if (record->numaNodeCount > 0)
+    {
+        size_t numaLength = (size_t)record->numaNodeCount * NUMA_CPU_OUTPUT_LENGTH;
+        rendered->numaCpuUsage = allocateString(arena, numaLength);
+        if (rendered->numaCpuUsage == NULL)
+        {
+            return 1;
+        }
+        renderNumaCpuUsage(nodes, record->numaNodeCount, rendered->numaCpuUsage, numaLength);
+    }
+    return 0;
+}
+
+/**
+ * Get the home slot of a uid in the owner index.
+ * @param uid The user id
+ * @param capacity Number of slots in the index, a power of two
+ * @returns Index of the first slot to probe
+ */
+static size_t hashOwner(uint32_t uid, size_t capacity)
+{
+    // Fibonacci hashing spreads consecutive uids across the index
+    return (uid * 2654435761u) & (capacity - 1);
+}
+
+/**
+ * Index the owners kept by the renderer by uid, so that each user is joined to its owner in a single lookup.
+ * @param renderer The renderer holding the owners
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+static int indexOwners(SampleRenderer *renderer)
+{
+    // the index is kept at most half full so that probe sequences stay short
+    uint32_t capacity = renderer->ownerSlotCapacity > 0 ? renderer->ownerSlotCapacity : 64;
+    while (capacity < renderer->ownerCount * 2)
+        capacity *= 2;
+    if (capacity != renderer->ownerSlotCapacity)
+    {
+        noteHeapAllocation();
+        uint32_t *slots = (uint32_t *)realloc(renderer->ownerSlots, sizeof(uint32_t) * capacity);
+        if (slots == NULL)
+        {
+            perror("realloc");
+            return 1;
+        }
+        renderer->ownerSlots = slots;
+        renderer->ownerSlotCapacity = capacity;
+    }
+    memset(renderer->ownerSlots, 0, sizeof(uint32_t) * capacity);
+    for (uint32_t i = 0; i < renderer->ownerCount; i++)
+    {
+        // each uid is sent once, so the first empty slot of its probe sequence is its own
+        size_t index = hashOwner(renderer->owners[i].uid, capacity);
+        while (renderer->ownerSlots[index] != 0)
+            index = (index + 1) & (capacity - 1);
+        renderer->ownerSlots[index] = i + 1;
+    }
+    return 0;
+}
+
+/**
+ * Find the usage of the owner with the given uid in the owners kept by the renderer.
+ * @param renderer The renderer holding the owners, indexed by indexOwners()
+ * @param uid The user id to look for
+ * @returns The usage of the owner, or NULL if the user owns no process
+ */
+static const OwnerUsageRecord *findOwner(const SampleRenderer *renderer, uint32_t uid)
+{
+    if (renderer->ownerSlotCapacity == 0)
+        return NULL;
+    size_t index = hashOwner(uid, renderer->ownerSlotCapacity);
+    while (renderer->ownerSlots[index] != 0)
+    {
+        const OwnerUsageRecord *owner = renderer->owners + renderer->ownerSlots[index] - 1;
+        if (owner->uid == uid)
+            return owner;
+        index = (index + 1) & (renderer->ownerSlotCapacity - 1);
+    }
+    return NULL;
+}
+
+/**
+ * Render the usage of each logged in user, one line per user.
+ * @param users The logged in users
+ * @param userCount Number of users
+ * @param renderer The renderer whose owners replace the usage carried by users, or NULL to show the usage carried by
+ * users
+ * @param rendered Where to store the rendered string
+ * @param arena Arena the string is allocated from
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+static int renderUserUsage(const UserUsageRecord *users, uint32_t userCount, const SampleRenderer *renderer,
+                           RenderedSample *rendered, Arena *arena)
+{
+    size_t usageLength = (size_t)(userCount + 1) * USER_USAGE_OUTPUT_LENGTH;
+    rendered->userUsage = allocateString(arena, usageLength);
+    if (rendered->userUsage == NULL)
+    {
+        return 1;
+    }
+    size_t written = 0;
+    for (uint32_t i = 0; i < userCount && written < usageLength; i++)
+    {
+        UserUsageRecord usage = users[i];
+        if (renderer != NULL)
+        {
+            // a user without any processes is still listed, with no usage
+            const OwnerUsageRecord *owner = findOwner(renderer, usage.uid);
+            usage.cpuUsage = owner != NULL ? owner->cpuUsage : 0;
+            usage.rssBytes = owner != NULL ? owner->rssBytes : 0;
+            usage.processCount = owner != NULL ? owner->processCount : 0;
+        }
+        written += snprintf(rendered->userUsage + written, usageLength - written, "\t%-16s CPU %6.2f%%, RSS %8.1f MB, %d processes\n",
+                            usage.user, usage.cpuUsage, usage.rssBytes / 1048576.0, usage.processCount);
+    }
+    return 0;
+}
+
+/**
+ * Apply the session changes of a RECORD_TYPE_USERS record to the sessions kept between samples, and render the usage of each user.
+ * @param renderer The renderer
+ * @param header Header of the record
+ * @param payload Payload of the record
+ * @param rendered Where to store the rendered strings
+ * @param arena Arena the strings are allocated from
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+int renderUsersRecord(SampleRenderer *renderer, const RecordHeader *header, const void *payload,
+                      RenderedSample *rendered, Arena *arena)
+{
+    UserSessionStore *sessions = renderer->sessions;
+    const UsersRecord *record = (const UsersRecord *)payload;
+    if (!recordLengthMatches(header, header->length < sizeof(UsersRecord) ? sizeof(UsersRecord)
+                                                                          : sizeof(UsersRecord) + sizeof(UserUsageRecord) * record->userCount +
+                                                                                sizeof(UserSessionRecord) * record->addedCount + sizeof(int32_t) * record->removedCount))
+    {
+        return 1;
+    }
+    const UserUsageRecord *users = (const UserUsageRecord *)(record + 1);
+    const UserSessionRecord *added = (const UserSessionRecord *)(users + record->userCount);
+    const int32_t *removed = (const int32_t *)(added + record->addedCount);
+
+    // ids of added sessions are always newer than those of removed ones, so removing first keeps the store in order
+    for (uint32_t i = 0; i < record->removedCount; i++)
+    {
+        removeUserSession(sessions, removed[i]);
+    }
+    for (uint32_t i = 0; i < record->addedCount; i++)
+    {
+        char line[USER_LINE_LENGTH];
+        int lineLength = snprintf(line, USER_LINE_LENGTH, "%s\t %s (%s)\n", added[i].user, added[i].line, added[i].host);
+        if (lineLength >= USER_LINE_LENGTH)
+            lineLength = USER_LINE_LENGTH - 1;
+        // if the store could not grow, the session is not shown
+        char *storedLine = addUserSession(sessions, added[i].id, lineLength);
+        if (storedLine != NULL)
+            memcpy(storedLine, line, lineLength + 1);
+    }
+
+    if (!(record->flags & USERS_FLAG_SHARED_SCAN))
+    {
+        return renderUserUsage(users, record->userCount, NULL, rendered, arena);
+    }
+    // the usage comes with the processes record, which may arrive before or after this one
+    if (keepRecords((void **)&renderer->sharedUsers, &renderer->sharedUserCapacity, users, record->userCount, sizeof(UserUsageRecord)) != 0)
+    {
+        return 1;
+    }
+    renderer->sharedUserCount = record->userCount;
+    renderer->hasSharedUsers = true;
+    return renderUserUsage(renderer->sharedUsers, renderer->sharedUserCount, renderer, rendered, arena);
+}
+
+/**
+ * Append a table of the given processes to the output string.
+ * @param processes The processes to list, in order
+ * @param count Number of processes to list
+ * @param output Buffer where the table is appended
+ * @param outputLength Size of output in bytes
+ * @returns The new length of the string in output
+ */
+static size_t renderProcessList(const ProcessRecord *processes, uint32_t count, char *output, size_t outputLength)
+{
+    size_t written = strlen(output);
+    written += snprintf(output + written, outputLength - written, "\t%8s %8s %10s  %s\n", "PID", "CPU%", "RSS (MB)", "NAME");
+    for (uint32_t i = 0; i < count && written < outputLength; i++)
+    {
+        written += snprintf(output + written, outputLength - written, "\t%8d %7.2f%% %10.1f  %.*s\n",
+                            processes[i].pid, processes[i].cpuUsage, processes[i].rssBytes / (1024.0 * 1024),
+                            PROCESS_NAME_LENGTH, processes[i].name);
+    }
+    return written;
+}
+
+/**
+ * Render a RECORD_TYPE_PROCESSES record as a table of the top processes by CPU and another by memory.
+ * @param renderer The renderer
+ * @param header Header of the record
+ * @param payload Payload of the record
+ * @param rendered Where to store the rendered strings
+ * @param arena Arena the strings are allocated from
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+int renderProcessesRecord(SampleRenderer *renderer, const RecordHeader *header, const void *payload, RenderedSample *rendered, Arena *arena)
+{
+    const ProcessesRecord *record = (const ProcessesRecord *)payload;
+    if (!recordLengthMatches(header, header->length < sizeof(ProcessesRecord) ? sizeof(ProcessesRecord)
+                                                                              : sizeof(ProcessesRecord) + sizeof(ProcessRecord) * record->listedCount * 2 +
+                                                                                    sizeof(OwnerUsageRecord) * record->ownerCount))
+    {
+        return 1;
+    }
+    const ProcessRecord *byCpu = (const ProcessRecord *)(record + 1);
+    const ProcessRecord *byMemory = byCpu + record->listedCount;
+
+    size_t outputLength = ((size_t)record->listedCount * 2 + 4) * PROCESS_OUTPUT_LENGTH;
+    char *output = allocateString(arena, outputLength);
+    if (output == NULL)
+    {
+        return 1;
+    }
+    snprintf(output, outputLength, "Top %u of %u processes by CPU:\n", record->listedCount, record->processCount);
+    size_t written = renderProcessList(byCpu, record->listedCount, output, outputLength);
+    snprintf(output + written, outputLength - written, "Top %u of %u processes by memory:\n", record->listedCount, record->processCount);
+    renderProcessList(byMemory, record->listedCount, output, outputLength);
+    rendered->topProcesses = output;
+
+    if (record->ownerCount == 0)
+    {
+        return 0;
+    }
+    const OwnerUsageRecord *owners = (const OwnerUsageRecord *)(byMemory + record->listedCount);
+    if (keepRecords((void **)&renderer->owners, &renderer->ownerCapacity, owners, record->ownerCount, sizeof(OwnerUsageRecord)) != 0)
+    {
+        return 1;
+    }
+    renderer->ownerCount = record->ownerCount;
+    if (indexOwners(renderer) != 0)
+    {
+        return 1;
+    }
+    if (!renderer->hasSharedUsers)
+    {
+        return 0;
+    }
+    return renderUserUsage(renderer->sharedUsers, renderer->sharedUserCount, renderer, rendered, arena);
+}
+
+/**
+ * Render a RECORD_TYPE_PRESSURE record, one line per resource.
+ * @param renderer The renderer
+ * @param header Header of the record
+ * @param payload Payload of the record
+ * @param rendered Where to store the rendered strings
+ * @param arena Arena the strings are allocated from
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+int renderPressureRecord(SampleRenderer *renderer, const RecordHeader *header, const void *payload, RenderedSample *rendered, Arena *arena)
+{
+    const PressureRecord *record = (const PressureRecord *)payload;
+    if (!recordLengthMatches(header, sizeof(PressureRecord)))
+    {
+        return 1;
+    }
+
+    size_t outputLength = PSI_RESOURCE_COUNT * PSI_OUTPUT_LENGTH;
+    char *output = allocateString(arena, outputLength);
+    if (output == NULL)
+    {
+        return 1;
+    }
+    size_t written = 0;
+    for (int i = 0; i < PSI_RESOURCE_COUNT && written < outputLength; i++)
+    {
+        const PressureResourceRecord *resource = record->resources + i;
+        written += snprintf(output + written, outputLength - written,
+                            "\t%-7s some %6.2f %6.2f %6.2f (%7.1f ms/s)   full %6.2f %6.2f %6.2f (%7.1f ms/s)\n",
+                            psiResourceNames[i],
+                            resource->some.avg10, resource->some.avg60, resource->some.avg300, resource->someStallRate,
+                            resource->full.avg10, resource->full.avg60, resource->full.avg300, resource->fullStallRate);
+    }
+    rendered->pressureInfo = output;
+    return 0;
+}
@@ -0,0 +1,156 @@
+#ifndef SAMPLE_RENDERER_H
+#define SAMPLE_RENDERER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "arena.h"
+#include "ringBuffer.h"
+#include "sessionStore.h"
+#include "parseArguments.h"
+#include "sampleRecord.h"
+
+/**
+ * The text of a sample rendered from the records of the collectors, which lives in the sample arena.
+ * Strings of records that were not received are NULL.
+ */
+typedef struct renderedSample
+{
+    /**
+     * Number of packages, online logical CPUs and physical cores
+     */
+    int processorCount, coreCount, physicalCoreCount;
+    char *memoryBreakdown;
+    char *pagingRates;
+    char *numaMemory;
+    char *averageCpuUsage;
+    char *coreCpuUsage;
+    char *numaCpuUsage;
+    char *topProcesses;
+    char *pressureInfo;
+    char *userUsage;
+} RenderedSample;
+
+/**
+ * Turns the records of the collectors into text, keeping what it needs of earlier records to show the change between samples
+ */
+typedef struct sampleRenderer
+{
+    bool showGraphics;
+    /**
+     * Usage lines of the most recent samples, kept by the caller for the following samples
+     */
+    RingBuffer *memoryHistory, *cpuHistory;
+    /**
+     * The sessions kept by the parent, in the order they were added
+     */
+    UserSessionStore *sessions;
+    /**
+     * The memory record of the previous sample, valid once hasPreviousMemory is set
+     */
+    MemoryRecord previousMemory;
+    bool hasPreviousMemory;
+    /**
+     * The CPU utilization of the previous sample, valid once hasPreviousCpu is set
+     */
+    float previousCpuUsage;
+    bool hasPreviousCpu;
+    /**
+     * When the process collector scans the processes for the user collector, the logged in users of the latest users
+     * record and the usage of every owner of the latest processes record, joined by whichever of them arrives last
+     */
+    UserUsageRecord *sharedUsers;
+    uint32_t sharedUserCount, sharedUserCapacity;
+    bool hasSharedUsers;
+    OwnerUsageRecord *owners;
+    uint32_t ownerCount, ownerCapacity;
+    /**
+     * Open-addressing index of owners by uid, of which each slot holds the index of an owner plus one, or 0 if empty
+     */
+    uint32_t *ownerSlots;
+    uint32_t ownerSlotCapacity;
+} SampleRenderer;
+
+/**
+ * Set up a renderer that has not seen any records.
+ * @param renderer The renderer to initialize
+ * @param options The settings given by command line arguments
+ * @param memoryHistory Ring buffer the memory usage line of each sample is pushed to
+ * @param cpuHistory Ring buffer the CPU usage line of each sample is pushed to
+ * @param sessions The sessions kept by the parent between samples
+ */
+extern void initSampleRenderer(SampleRenderer *renderer, const MonitorOptions *options, RingBuffer *memoryHistory,
+                               RingBuffer *cpuHistory, UserSessionStore *sessions);
+
+/**
+ * Release the records a renderer keeps between samples.
+ * @param renderer A renderer set up by initSampleRenderer()
+ */
+extern void freeSampleRenderer(SampleRenderer *renderer);
+
+/**
+ * Mark every string of a rendered sample as not received.
+ * @param rendered The rendered sample to clear
+ */
+extern void clearRenderedSample(RenderedSample *rendered);
+
+/**
+ * Render a RECORD_TYPE_MEMORY record: its usage line, pushed to the memory history, breakdown, paging rates and the memory of each NUMA node.
+ * @param renderer The renderer
+ * @param header Header of the record
+ * @param payload Payload of the record
+ * @param rendered Where to store the rendered strings
+ * @param arena Arena the strings are allocated from
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+extern int renderMemoryRecord(SampleRenderer *renderer, const RecordHeader *header, const void *payload,
+                              RenderedSample *rendered, Arena *arena);
+
+/**
+ * Render a RECORD_TYPE_CPU record: its counts, average and usage line, pushed to the CPU history, and the usage of each core and NUMA node.
+ * @param renderer The renderer
+ * @param header Header of the record
+ * @param payload Payload of the record
+ * @param rendered Where to store the rendered strings
+ * @param arena Arena the strings are allocated from
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+extern int renderCpuRecord(SampleRenderer *renderer, const RecordHeader *header, const void *payload,
+                           RenderedSample *rendered, Arena *arena);
+
+/**
+ * Apply the session changes of a RECORD_TYPE_USERS record to the sessions kept between samples, and render the usage of each user.
+ * @param renderer The renderer
+ * @param header Header of the record
+ * @param payload Payload of the record
+ * @param rendered Where to store the rendered strings
+ * @param arena Arena the strings are allocated from
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+extern int renderUsersRecord(SampleRenderer *renderer, const RecordHeader *header, const void *payload,
+                             RenderedSample *rendered, Arena *arena);
+
+/**
+ * Render a RECORD_TYPE_PROCESSES record as a table of the top processes by CPU and another by memory, along with the
+ * usage of each logged in user when the record carries the usage of each owner.
+ * @param renderer The renderer
+ * @param header Header of the record
+ * @param payload Payload of the record
+ * @param rendered Where to store the rendered strings
+ * @param arena Arena the strings are allocated from
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+extern int renderProcessesRecord(SampleRenderer *renderer, const RecordHeader *header, const void *payload, RenderedSample *rendered, Arena *arena);
+
+/**
+ * Render a RECORD_TYPE_PRESSURE record, one line per resource.
+ * @param renderer The renderer
+ * @param header Header of the record
+ * @param payload Payload of the record
+ * @param rendered Where to store the rendered strings
+ * @param arena Arena the strings are allocated from
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+extern int renderPressureRecord(SampleRenderer *renderer, const RecordHeader *header, const void *payload, RenderedSample *rendered, Arena *arena);
+
+#endif
@@ -0,0 +1,95 @@
+#include <unistd.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/timerfd.h>
+
+#include "sampleTimer.h"
+
+/**
+ * Start a periodic timer whose first deadline is one period from now.
+ * @param timer The timer to start
+ * @param periodMs Time between consecutive deadlines, in milliseconds
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+int startSampleTimer(SampleTimer *timer, long periodMs)
+{
+    timer->periodMs = periodMs;
+    timer->missedDeadlines = 0;
+    timer->fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (timer->fd == -1)
+    {
+        perror("timerfd_create");
+        return 1;
+    }
+
+    struct timespec now;
+    if (clock_gettime(CLOCK_MONOTONIC, &now) == -1)
+    {
+        perror("clock_gettime");
+        return 1;
+    }
+
+    // the kernel advances an absolute periodic timer by exactly one period per expiration, so deadlines never drift
+    struct itimerspec schedule;
+    schedule.it_interval.tv_sec = periodMs / MILLISECONDS_PER_SECOND;
+    schedule.it_interval.tv_nsec = (periodMs % MILLISECONDS_PER_SECOND) * NANOSECONDS_PER_MILLISECOND;
+    schedule.it_value.tv_sec = now.tv_sec + schedule.it_interval.tv_sec;
+    schedule.it_value.tv_nsec = now.tv_nsec + schedule.it_interval.tv_nsec;
+    if (schedule.it_value.tv_nsec >= MILLISECONDS_PER_SECOND * NANOSECONDS_PER_MILLISECOND)
+    {
+        schedule.it_value.tv_sec++;
+        schedule.it_value.tv_nsec -= MILLISECONDS_PER_SECOND * NANOSECONDS_PER_MILLISECOND;
+    }
+    if (timerfd_settime(timer->fd, TFD_TIMER_ABSTIME, &schedule, NULL) == -1)
+    {
+        perror("timerfd_settime");
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Block until the next deadline passes. If more than one deadline passed since the last wait, the extra deadlines are
+ * added to timer->missedDeadlines and the wait returns immediately, so the schedule is kept rather than shifted.
+ * @param timer A timer started by startSampleTimer()
+ * @returns 0 once a deadline has passed, or -1 if the wait failed or was interrupted by a signal, with errno set
+ */
+int waitForSampleTimer(SampleTimer *timer)
+{
+    uint64_t expirations = 0;
+    if (read(timer->fd, &expirations, sizeof(uint64_t)) != sizeof(uint64_t))
+    {
+        return -1;
+    }
+    if (expirations > 1)
+    {
+        timer->missedDeadlines += expirations - 1;
+    }
+    return 0;
+}
+
+/**
+ * Get the current time of the monotonic clock, for measuring the time between two reads of a counter.
+ * @returns The time in seconds
+ */
+double getMonotonicSeconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/**
+ * Stop the timer and release its file descriptor.
+ * @param timer A timer started by startSampleTimer()
+ */
+void stopSampleTimer(SampleTimer *timer)
+{
+    if (timer->fd != -1)
+    {
+        close(timer->fd);
+        timer->fd = -1;
+    }
+}
@@ -0,0 +1,62 @@
+#ifndef SAMPLE_TIMER_H
+#define SAMPLE_TIMER_H
+
+/**
+ * Number of nanoseconds in a millisecond
+ */
+#define NANOSECONDS_PER_MILLISECOND 1000000L
+
+/**
+ * Number of milliseconds in a second
+ */
+#define MILLISECONDS_PER_SECOND 1000L
+
+/**
+ * Periodic timer that fires on absolute deadlines of CLOCK_MONOTONIC, so the time spent collecting and printing
+ * each sample does not push back the deadlines of later samples.
+ */
+typedef struct sampleTimer
+{
+    /**
+     * timerfd that becomes readable once a deadline has passed
+     */
+    int fd;
+    /**
+     * Time between consecutive deadlines, in milliseconds
+     */
+    long periodMs;
+    /**
+     * Number of deadlines that passed without being waited on, because a sample took longer than the period
+     */
+    unsigned long missedDeadlines;
+} SampleTimer;
+
+/**
+ * Start a periodic timer whose first deadline is one period from now.
+ * @param timer The timer to start
+ * @param periodMs Time between consecutive deadlines, in milliseconds
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+extern int startSampleTimer(SampleTimer *timer, long periodMs);
+
+/**
+ * Block until the next deadline passes. If more than one deadline passed since the last wait, the extra deadlines are
+ * added to timer->missedDeadlines and the wait returns immediately, so the schedule is kept rather than shifted.
+ * @param timer A timer started by startSampleTimer()
+ * @returns 0 once a deadline has passed, or -1 if the wait failed or was interrupted by a signal, with errno set
+ */
+extern int waitForSampleTimer(SampleTimer *timer);
+
+/**
+ * Get the current time of the monotonic clock, for measuring the time between two reads of a counter.
+ * @returns The time in seconds
+ */
+extern double getMonotonicSeconds(void);
+
+/**
+ * Stop the timer and release its file descriptor.
+ * @param timer A timer started by startSampleTimer()
+ */
+extern void stopSampleTimer(SampleTimer *timer);
+
+#endif
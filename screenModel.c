@@ -0,0 +1,509 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+#include "heapCounter.h"
+#include "screenModel.h"
+
+/**
+ * Escape sequences that turn line wrapping off and back on around a frame that was wrapped to the screen, so that
+ * a row as wide as the screen does not move the cursor to the next row
+ */
+#define SCREEN_WRAP_OFF "\033[?7l"
+#define SCREEN_WRAP_ON "\033[?7h"
+
+/**
+ * Distance between the tab stops of a terminal, in columns
+ */
+#define SCREEN_TAB_WIDTH 8
+
+/**
+ * Grow a buffer to hold at least the given number of bytes, keeping its contents.
+ * @param buffer The buffer, which may be NULL
+ * @param capacity Number of bytes the buffer holds, updated if it grows
+ * @param needed Number of bytes needed
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+static int reserveBuffer(char **buffer, size_t *capacity, size_t needed)
+{
+    if (needed <= *capacity)
+        return 0;
+    size_t larger = *capacity > 0 ? *capacity : 4096;
+    while (larger < needed)
+        larger *= 2;
+    noteHeapAllocation();
+    char *grown = (char *)realloc(*buffer, larger);
+    if (grown == NULL)
+    {
+        perror("realloc");
+        return 1;
+    }
+    *buffer = grown;
+    *capacity = larger;
+    return 0;
+}
+
+/**
+ * Set up a screen model that has not drawn any frame.
+ * @param screen The screen model to initialize
+ * @param incremental Whether frames may be drawn by updating the rows of the previous frame. Set if stdout is a terminal.
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+int initScreenModel(ScreenModel *screen, bool incremental)
+{
+    memset(screen, 0, sizeof(ScreenModel));
+    screen->incremental = incremental;
+    return 0;
+}
+
+/**
+ * Find where each row of a frame starts.
+ * @param frame Text of the frame
+ * @param length Number of bytes of frame
+ * @param rows Where to store the offset of each row, followed by length. Must have room for the number of rows plus one.
+ * @returns The number of rows
+ */
+static int findRows(const char *frame, size_t length, size_t *rows)
+{
+    int count = 0;
+    size_t start = 0;
+    while (start < length)
+    {
+        rows[count++] = start;
+        const char *newline = (const char *)memchr(frame + start, '\n', length - start);
+        start = newline != NULL ? (size_t)(newline - frame) + 1 : length;
+    }
+    rows[count] = length;
+    return count;
+}
+
+/**
+ * Find where a row of a frame ends once lines wider than the screen are wrapped. Tabs move to the next tab stop and
+ * the continuation bytes of UTF-8 characters take no column.
+ * @param frame Text of the frame
+ * @param length Number of bytes of frame
+ * @param start Offset of the first byte of the row
+ * @param columns Width of the screen in columns
+ * @param end Where to store the offset one past the last byte of text of the row
+ * @returns The offset of the next row
+ */
+static size_t wrapRow(const char *frame, size_t length, size_t start, int columns, size_t *end)
+{
+    int column = 0;
+    size_t i = start;
+    for (; i < length && frame[i] != '\n'; i++)
+    {
+        int width = 1;
+        if (frame[i] == '\t')
+            width = SCREEN_TAB_WIDTH - column % SCREEN_TAB_WIDTH;
+        else if (((unsigned char)frame[i] & 0xC0) == 0x80)
+            width = 0;
+        // a row always takes at least one character, however narrow the screen
+        if (column > 0 && column + width > columns)
+        {
+            *end = i;
+            return i;
+        }
+        column += width;
+    }
+    *end = i;
+    return i < length ? i + 1 : length;
+}
+
+/**
+ * Find the span a row of a frame belongs to.
+ * @param spans The spans of the frame
+ * @param spanCount Number of spans
+ * @param offset Offset of the first byte of the row
+ * @returns The index of the span, or -1 if the row is not in any span
+ */
+static int findSpan(const ScreenSpan *spans, int spanCount, size_t offset)
+{
+    for (int i = 0; i < spanCount; i++)
+    {
+        if (offset >= spans[i].start && offset < spans[i].end)
+            return i;
+    }
+    return -1;
+}
+
+/**
+ * Fit a frame to the screen into the fitted text of the screen model. Lines wider than the screen are wrapped, and
+ * if the frame is then taller than the screen less one row, so that drawing it never scrolls the screen, rows are
+ * left out: first the blank rows at the end of the spans, then the oldest rows of whichever span has the most rows
+ * left, and finally the rows at the bottom of the frame.
+ * @param screen The screen model, holding the size of the screen
+ * @param frame Text of the frame
+ * @param length Number of bytes of frame
+ * @param spans Spans of the frame that may be clipped
+ * @param spanCount Number of spans
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+static int fitFrame(ScreenModel *screen, const char *frame, size_t length, const ScreenSpan *spans, int spanCount)
+{
+    int columns = screen->screenColumns > 0 ? screen->screenColumns : INT_MAX;
+    if (spans == NULL || spanCount < 0)
+        spanCount = 0;
+    if (spanCount > SCREEN_MAX_SPANS)
+        spanCount = SCREEN_MAX_SPANS;
+    int spanRows[SCREEN_MAX_SPANS] = {0}, blankRows[SCREEN_MAX_SPANS] = {0};
+    int totalRows = 0;
+    for (size_t start = 0; start < length;)
+    {
+        size_t end;
+        size_t next = wrapRow(frame, length, start, columns, &end);
+        int span = findSpan(spans, spanCount, start);
+        if (span >= 0)
+        {
+            spanRows[span]++;
+            blankRows[span] = end == start ? blankRows[span] + 1 : 0;
+        }
+        totalRows++;
+        start = next;
+    }
+
+    // decide how many rows to leave out of each span, from its end and from its start
+    int keptRows = screen->screenRows - 1;
+    int excess = totalRows - keptRows;
+    int droppedEnd[SCREEN_MAX_SPANS] = {0}, droppedStart[SCREEN_MAX_SPANS] = {0};
+    for (int i = 0; i < spanCount && excess > 0; i++)
+    {
+        droppedEnd[i] = blankRows[i] < excess ? blankRows[i] : excess;
+        excess -= droppedEnd[i];
+    }
+    while (excess > 0)
+    {
+        int most = -1, mostRows = 0;
+        for (int i = 0; i < spanCount; i++)
+        {
+            int rows = spanRows[i] - droppedEnd[i] - droppedStart[i];
+            if (rows > mostRows)
+            {
+                most = i;
+                mostRows = rows;
+            }
+        }
+        if (most < 0)
+            break;
+        droppedStart[most]++;
+        excess--;
+    }
+
+    // each row gets a newline of its own, which a wrapped line did not have
+    if (reserveBuffer(&screen->fitted, &screen->fittedCapacity, length * 2 + 1) != 0)
+    {
+        return 1;
+    }
+    screen->fittedLength = 0;
+    int rowInSpan[SCREEN_MAX_SPANS] = {0};
+    int rows = 0;
+    for (size_t start = 0; start < length && rows < keptRows;)
+    {
+        size_t end;
+        size_t next = wrapRow(frame, length, start, columns, &end);
+        int span = findSpan(spans, spanCount, start);
+        bool kept = true;
+        if (span >= 0)
+        {
+            int row = rowInSpan[span]++;
+            kept = row >= droppedStart[span] && row < spanRows[span] - droppedEnd[span];
+        }
+        if (kept)
+        {
+            memcpy(screen->fitted + screen->fittedLength, frame + start, end - start);
+            screen->fittedLength += end - start;
+            screen->fitted[screen->fittedLength++] = '\n';
+            rows++;
+        }
+        start = next;
+    }
+    return 0;
+}
+
+/**
+ * Count the rows of a frame.
+ * @param frame Text of the frame
+ * @param length Number of bytes of frame
+ * @returns The number of rows, where text after the last newline makes a row of its own
+ */
+static int countRows(const char *frame, size_t length)
+{
+    int count = 0;
+    for (size_t i = 0; i < length; i++)
+    {
+        if (frame[i] == '\n')
+            count++;
+    }
+    if (length > 0 && frame[length - 1] != '\n')
+        count++;
+    return count;
+}
+
+/**
+ * Get the text of a row without its newline.
+ * @param frame Text of the frame
+ * @param rows Offsets of the rows of the frame, as found by findRows()
+ * @param row Index of the row
+ * @param length Where to store the length of the text
+ * @returns The start of the text
+ */
+static const char *rowText(const char *frame, const size_t *rows, int row, size_t *length)
+{
+    size_t end = rows[row + 1];
+    if (end > rows[row] && frame[end - 1] == '\n')
+        end--;
+    *length = end - rows[row];
+    return frame + rows[row];
+}
+
+/**
+ * Check whether a row of the previous frame holds the same text as a row of the current frame.
+ * @param screen The screen model, holding the rows of both frames
+ * @param frame Text of the current frame
+ * @param previousRow Index of the row in the previous frame
+ * @param currentRow Index of the row in the current frame
+ * @returns true if the rows are the same, false otherwise
+ */
+static bool rowsEqual(const ScreenModel *screen, const char *frame, int previousRow, int currentRow)
+{
+    size_t previousLength, currentLength;
+    const char *previousText = rowText(screen->previous, screen->previousRows, previousRow, &previousLength);
+    const char *currentText = rowText(frame, screen->currentRows, currentRow, &currentLength);
+    return previousLength == currentLength && memcmp(previousText, currentText, currentLength) == 0;
+}
+
+/**
+ * Append bytes to the output of the screen model, which has been reserved to fit them.
+ * @param screen The screen model
+ * @param text The bytes to append
+ * @param length Number of bytes of text
+ */
+static void appendOutput(ScreenModel *screen, const char *text, size_t length)
+{
+    memcpy(screen->output + screen->outputLength, text, length);
+    screen->outputLength += length;
+}
+
+/**
+ * Append a formatted escape sequence to the output of the screen model, which has been reserved to fit it.
+ * @param screen The screen model
+ * @param format Format of the sequence, taking two rows
+ * @param first First row, counted from 1
+ * @param second Second row, counted from 1
+ */
+static void appendEscape(ScreenModel *screen, const char *format, int first, int second)
+{
+    screen->outputLength += snprintf(screen->output + screen->outputLength, SCREEN_ROW_ESCAPE_LENGTH, format, first, second);
+}
+
+/**
+ * Append the sequences that move to a row of the screen, clear it and write a row of the current frame on it.
+ * The row is cleared first since tabs move the cursor over the previous text without erasing it.
+ * @param screen The screen model
+ * @param frame Text of the current frame
+ * @param row Index of the row, which is drawn on the same row of the screen
+ */
+static void appendRow(ScreenModel *screen, const char *frame, int row)
+{
+    size_t length;
+    const char *text = rowText(frame, screen->currentRows, row, &length);
+    appendEscape(screen, "\033[%d;%dH\033[K", row + 1, 1);
+    appendOutput(screen, text, length);
+}
+
+/**
+ * Append the sequences that update the screen from the previous frame to the current one.
+ * @param screen The screen model
+ * @param frame Text of the current frame
+ */
+static void appendChanges(ScreenModel *screen, const char *frame)
+{
+    int commonRows = screen->previousRowCount < screen->currentRowCount ? screen->previousRowCount : screen->currentRowCount;
+    int row = 0;
+    while (row < commonRows)
+    {
+        if (rowsEqual(screen, frame, row, row))
+        {
+            row++;
+            continue;
+        }
+        int first = row;
+        while (row < commonRows && !rowsEqual(screen, frame, row, row))
+            row++;
+        int last = row - 1;
+
+        // a block whose rows all moved up by one is scrolled within a scroll region, so only its new last row is drawn
+        bool shifted = last > first;
+        for (int i = first; i < last && shifted; i++)
+            shifted = rowsEqual(screen, frame, i + 1, i);
+        if (shifted)
+        {
+            appendEscape(screen, "\033[%d;%dr", first + 1, last + 1);
+            appendEscape(screen, "\033[%d;%dH\n", last + 1, 1);
+            appendOutput(screen, "\033[r", strlen("\033[r"));
+            appendRow(screen, frame, last);
+            continue;
+        }
+        for (int i = first; i <= last; i++)
+            appendRow(screen, frame, i);
+    }
+    for (; row < screen->currentRowCount; row++)
+        appendRow(screen, frame, row);
+
+    // clear rows the previous frame or anything printed after it left below the current frame
+    appendEscape(screen, "\033[%d;%dH\033[J", screen->currentRowCount + 1, 1);
+}
+
+/**
+ * Write a frame to stdout with a single write(), so that a reader of a pipe or file gets it whole and the frame costs
+ * one system call. Whatever stdio still holds for stdout is flushed first to keep the output in order. The write is
+ * only repeated for what is left if it was interrupted or cut short.
+ * @param text Text of the frame
+ * @param length Number of bytes of text
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+int writeFrameText(const char *text, size_t length)
+{
+    if (fflush(stdout) != 0)
+    {
+        perror("fflush");
+        return 1;
+    }
+    while (length > 0)
+    {
+        ssize_t written = write(STDOUT_FILENO, text, length);
+        if (written == -1 && errno == EINTR)
+            continue;
+        if (written == -1)
+        {
+            perror("write: frame");
+            return 1;
+        }
+        text += written;
+        length -= written;
+    }
+    return 0;
+}
+
+/**
+ * Draw a frame on stdout. Only the rows that differ from the previous frame are redrawn, and rows that moved up by
+ * one, such as a history that is full, are scrolled rather than redrawn, so the output stays the same size however
+ * many rows the frame has. On a terminal, a frame taller than the screen is clipped to fit it: blank rows at the end
+ * of the spans go first, then their oldest rows, and then the rows at the bottom of the frame. The frame is drawn in
+ * full the first time, after the screen was invalidated or resized, and always if the screen model is not incremental.
+ * @param screen The screen model
+ * @param frame Text of the frame, one row per line
+ * @param length Number of bytes of frame
+ * @param spans Spans of the frame that may be clipped, in any order, or NULL if there are none
+ * @param spanCount Number of spans
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+int drawScreenFrame(ScreenModel *screen, const char *frame, size_t length, const ScreenSpan *spans, int spanCount)
+{
+    // on a terminal the frame is wrapped and clipped to the screen, so that each row is a row of the screen
+    bool fits = false;
+    struct winsize size;
+    if (screen->incremental && ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0 && size.ws_row > 1)
+    {
+        if (size.ws_row != screen->screenRows || size.ws_col != screen->screenColumns)
+            screen->valid = false;
+        screen->screenRows = size.ws_row;
+        screen->screenColumns = size.ws_col;
+        if (fitFrame(screen, frame, length, spans, spanCount) != 0)
+        {
+            return 1;
+        }
+        frame = screen->fitted;
+        length = screen->fittedLength;
+        fits = true;
+    }
+
+    int rowCount = countRows(frame, length);
+    if (rowCount + 1 > screen->rowCapacity)
+    {
+        int capacity = rowCount + 1;
+        noteHeapAllocation();
+        size_t *previousRows = (size_t *)realloc(screen->previousRows, sizeof(size_t) * capacity);
+        if (previousRows != NULL)
+            screen->previousRows = previousRows;
+        noteHeapAllocation();
+        size_t *currentRows = (size_t *)realloc(screen->currentRows, sizeof(size_t) * capacity);
+        if (currentRows != NULL)
+            screen->currentRows = currentRows;
+        if (previousRows == NULL || currentRows == NULL)
+        {
+            perror("realloc");
+            return 1;
+        }
+        screen->rowCapacity = capacity;
+    }
+    screen->currentRowCount = findRows(frame, length, screen->currentRows);
+
+    size_t escapeLength = (size_t)(screen->currentRowCount + 4) * SCREEN_ROW_ESCAPE_LENGTH;
+    if (reserveBuffer(&screen->output, &screen->outputCapacity, length + escapeLength) != 0)
+    {
+        return 1;
+    }
+    screen->outputLength = 0;
+    if (fits)
+        appendOutput(screen, SCREEN_WRAP_OFF, strlen(SCREEN_WRAP_OFF));
+    if (screen->valid && fits)
+    {
+        appendChanges(screen, frame);
+    }
+    else
+    {
+        appendOutput(screen, SCREEN_CLEAR, strlen(SCREEN_CLEAR));
+        appendOutput(screen, frame, length);
+    }
+    if (fits)
+        appendOutput(screen, SCREEN_WRAP_ON, strlen(SCREEN_WRAP_ON));
+
+    if (writeFrameText(screen->output, screen->outputLength) != 0)
+    {
+        return 1;
+    }
+
+    // keep the frame to compare the next one against
+    if (reserveBuffer(&screen->previous, &screen->previousCapacity, length) != 0)
+    {
+        screen->valid = false;
+        return 1;
+    }
+    memcpy(screen->previous, frame, length);
+    screen->previousLength = length;
+    size_t *rows = screen->previousRows;
+    screen->previousRows = screen->currentRows;
+    screen->currentRows = rows;
+    screen->previousRowCount = screen->currentRowCount;
+    screen->valid = screen->incremental && fits;
+    return 0;
+}
+
+/**
+ * Note that something else was written to the screen since the previous frame, so the next frame is drawn in full.
+ * @param screen The screen model
+ */
+void invalidateScreenModel(ScreenModel *screen)
+{
+    screen->valid = false;
+}
+
+/**
+ * Release the buffers of a screen model.
+ * @param screen A screen model set up by initScreenModel()
+ */
+void freeScreenModel(ScreenModel *screen)
+{
+    free(screen->fitted);
+    free(screen->previous);
+    free(screen->previousRows);
+    free(screen->currentRows);
+    free(screen->output);
+    memset(screen, 0, sizeof(ScreenModel));
+}
@@ -0,0 +1,121 @@
+#ifndef SCREEN_MODEL_H
+#define SCREEN_MODEL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Escape sequence that clears the terminal and its scrollback and moves the cursor to the top left, which starts every
+ * frame that is redrawn in full
+ */
+#define SCREEN_CLEAR "\033[2J\033[3J\033[2J\033[H"
+
+/**
+ * Max length of the escape sequences written for a single row of a frame, on top of the text of the row
+ */
+#define SCREEN_ROW_ESCAPE_LENGTH 64
+
+/**
+ * Max number of spans of a frame that may be clipped, any further spans are drawn whole
+ */
+#define SCREEN_MAX_SPANS 8
+
+/**
+ * Bytes of a frame holding whole lines that may be left out when the frame is taller than the screen, such as a
+ * history whose oldest lines are the least interesting
+ */
+typedef struct screenSpan
+{
+    /**
+     * Offset of the first byte of the span, and one past its last byte, in the frame text
+     */
+    size_t start, end;
+} ScreenSpan;
+
+/**
+ * The frame last drawn on the terminal, kept so that the next frame only redraws the rows that changed.
+ * Lines wider than the terminal are wrapped onto as many rows as they need before the frame is compared, and line
+ * wrapping is turned off while a frame is drawn, so each row of the model is exactly one row of the terminal.
+ */
+typedef struct screenModel
+{
+    /**
+     * Whether frames may be drawn by updating the rows of the previous frame, which needs a terminal
+     */
+    bool incremental;
+    /**
+     * Whether the previous frame is still on the screen exactly as it was drawn
+     */
+    bool valid;
+    /**
+     * Size of the terminal when the previous frame was drawn
+     */
+    int screenRows, screenColumns;
+    /**
+     * Text of the current frame once wrapped and clipped to the screen
+     */
+    char *fitted;
+    size_t fittedLength, fittedCapacity;
+    /**
+     * Text of the previous frame
+     */
+    char *previous;
+    size_t previousLength, previousCapacity;
+    /**
+     * Offset in the frame text of the start of each row, plus one past the end of the text, for the previous and
+     * current frames
+     */
+    size_t *previousRows, *currentRows;
+    int previousRowCount, currentRowCount, rowCapacity;
+    /**
+     * Escape sequences and text that update the screen from the previous frame to the current one
+     */
+    char *output;
+    size_t outputLength, outputCapacity;
+} ScreenModel;
+
+/**
+ * Set up a screen model that has not drawn any frame.
+ * @param screen The screen model to initialize
+ * @param incremental Whether frames may be drawn by updating the rows of the previous frame. Set if stdout is a terminal.
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+extern int initScreenModel(ScreenModel *screen, bool incremental);
+
+/**
+ * Write a frame to stdout with a single write(), so that a reader of a pipe or file gets it whole and the frame costs
+ * one system call. Whatever stdio still holds for stdout is flushed first to keep the output in order.
+ * @param text Text of the frame
+ * @param length Number of bytes of text
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+extern int writeFrameText(const char *text, size_t length);
+
+/**
+ * Draw a frame on stdout. Only the rows that differ from the previous frame are redrawn, and rows that moved up by
+ * one, such as a history that is full, are scrolled rather than redrawn, so the output stays the same size however
+ * many rows the frame has. On a terminal, a frame taller than the screen is clipped to fit it: blank rows at the end
+ * of the spans go first, then their oldest rows, and then the rows at the bottom of the frame. The frame is drawn in
+ * full the first time, after the screen was invalidated or resized, and always if the screen model is not incremental.
+ * @param screen The screen model
+ * @param frame Text of the frame, one row per line
+ * @param length Number of bytes of frame
+ * @param spans Spans of the frame that may be clipped, in any order, or NULL if there are none
+ * @param spanCount Number of spans
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+extern int drawScreenFrame(ScreenModel *screen, const char *frame, size_t length, const ScreenSpan *spans, int spanCount);
+
+/**
+ * Note that something else was written to the screen since the previous frame, so the next frame is drawn in full.
+ * @param screen The screen model
+ */
+extern void invalidateScreenModel(ScreenModel *screen);
+
+/**
+ * Release the buffers of a screen model.
+ * @param screen A screen model set up by initScreenModel()
+ */
+extern void freeScreenModel(ScreenModel *screen);
+
+#endif
@@ -0,0 +1,148 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "collectorRegistry.h"
+#include "selfStats.h"
+
+/**
+ * Number of microseconds in a second
+ */
+#define MICROSECONDS_PER_SECOND 1e6
+
+/**
+ * Find the bucket a latency falls in.
+ * @param seconds The latency, in seconds
+ * @returns Index of the bucket
+ */
+static int latencyBucket(double seconds)
+{
+    double microseconds = seconds * MICROSECONDS_PER_SECOND;
+    if (microseconds < 1)
+        return 0;
+    if (microseconds >= (double)(1ULL << (LATENCY_BUCKET_COUNT - 1)))
+        return LATENCY_BUCKET_COUNT - 1;
+    // the bucket is one past the position of the highest set bit
+    return 64 - __builtin_clzll((uint64_t)microseconds);
+}
+
+/**
+ * Upper bound of the latencies a bucket counts.
+ * @param bucket Index of the bucket
+ * @returns The bound in seconds
+ */
+static double bucketUpperBound(int bucket)
+{
+    return (double)(1ULL << bucket) / MICROSECONDS_PER_SECOND;
+}
+
+/**
+ * Add a latency to a histogram.
+ * @param histogram The histogram
+ * @param seconds The latency, in seconds
+ */
+void recordLatency(LatencyHistogram *histogram, double seconds)
+{
+    if (seconds < 0)
+        seconds = 0;
+    histogram->counts[latencyBucket(seconds)]++;
+    histogram->total++;
+    if (seconds > histogram->maxSeconds)
+        histogram->maxSeconds = seconds;
+}
+
+/**
+ * Estimate a percentile of the latencies in a histogram by the upper bound of the bucket it falls in.
+ * @param histogram The histogram
+ * @param fraction The percentile as a fraction, such as 0.99
+ * @returns The latency in seconds, no larger than the largest recorded, or 0 if the histogram is empty
+ */
+double latencyPercentile(const LatencyHistogram *histogram, double fraction)
+{
+    if (histogram->total == 0)
+        return 0;
+    uint64_t rank = (uint64_t)ceil(fraction * histogram->total);
+    if (rank == 0)
+        rank = 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < LATENCY_BUCKET_COUNT; i++)
+    {
+        seen += histogram->counts[i];
+        if (seen >= rank)
+        {
+            double bound = bucketUpperBound(i);
+            return bound < histogram->maxSeconds ? bound : histogram->maxSeconds;
+        }
+    }
+    return histogram->maxSeconds;
+}
+
+/**
+ * Print the name, p50, p99 and max of a stage, if it recorded a latency.
+ * @param out Stream to print to
+ * @param name Name of the collector the stage belongs to, or NULL for a stage of the render loop
+ * @param stage Name of the stage
+ * @param histogram The latencies of the stage
+ */
+static void printStage(FILE *out, const char *name, const char *stage, const LatencyHistogram *histogram)
+{
+    if (histogram->total == 0)
+        return;
+    char label[64];
+    snprintf(label, sizeof(label), "%s%s%s", name != NULL ? name : "", name != NULL ? " " : "", stage);
+    fprintf(out, "\t%-20s p50 %9.1f us  p99 %9.1f us  max %9.1f us  (%llu)\n", label,
+           latencyPercentile(histogram, 0.5) * MICROSECONDS_PER_SECOND,
+           latencyPercentile(histogram, 0.99) * MICROSECONDS_PER_SECOND,
+           histogram->maxSeconds * MICROSECONDS_PER_SECOND, (unsigned long long)histogram->total);
+}
+
+/**
+ * Print p50, p99 and max of every stage that recorded a latency, as the footer of a sample.
+ * @param out Stream the frame is written to
+ * @param stats The latencies of the monitor
+ */
+void printSelfStats(FILE *out, const SelfStats *stats)
+{
+    fprintf(out, "### Self stats ### (latency of each stage, number of samples)\n");
+    for (int i = 0; i < COLLECTOR_COUNT; i++)
+        printStage(out, collectorRegistry[i].name, "collect", stats->collect + i);
+    for (int i = 0; i < COLLECTOR_COUNT; i++)
+        printStage(out, collectorRegistry[i].name, "transfer", stats->transfer + i);
+    printStage(out, NULL, "render", &stats->render);
+}
+
+/**
+ * Print the non-empty buckets of a stage, if it recorded a latency.
+ * @param name Name of the collector the stage belongs to, or NULL for a stage of the render loop
+ * @param stage Name of the stage
+ * @param histogram The latencies of the stage
+ */
+static void dumpStage(const char *name, const char *stage, const LatencyHistogram *histogram)
+{
+    if (histogram->total == 0)
+        return;
+    printStage(stdout, name, stage, histogram);
+    for (int i = 0; i < LATENCY_BUCKET_COUNT; i++)
+    {
+        if (histogram->counts[i] == 0)
+            continue;
+        if (i == LATENCY_BUCKET_COUNT - 1)
+            printf("\t\t>= %9.0f us: %llu\n", bucketUpperBound(i - 1) * MICROSECONDS_PER_SECOND, (unsigned long long)histogram->counts[i]);
+        else
+            printf("\t\t< %10.0f us: %llu\n", bucketUpperBound(i) * MICROSECONDS_PER_SECOND, (unsigned long long)histogram->counts[i]);
+    }
+}
+
+/**
+ * Print every stage that recorded a latency along with the count of each of its non-empty buckets, once the monitor stops.
+ * @param stats The latencies of the monitor
+ */
+void dumpSelfStats(const SelfStats *stats)
+{
+    printf("### Self stats histograms ### (latency of each stage, number of samples, then samples per bucket)\n");
+    for (int i = 0; i < COLLECTOR_COUNT; i++)
+        dumpStage(collectorRegistry[i].name, "collect", stats->collect + i);
+    for (int i = 0; i < COLLECTOR_COUNT; i++)
+        dumpStage(collectorRegistry[i].name, "transfer", stats->transfer + i);
+    dumpStage(NULL, "render", &stats->render);
+}
@@ -0,0 +1,79 @@
+#ifndef SELF_STATS_H
+#define SELF_STATS_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "collectorRegistry.h"
+
+/**
+ * Number of buckets of a latency histogram. Bucket 0 counts latencies below 1 microsecond, bucket i latencies from
+ * 2^(i-1) up to 2^i microseconds, and the last bucket every latency beyond that.
+ */
+#define LATENCY_BUCKET_COUNT 32
+
+/**
+ * Histogram of the latencies of a stage of the monitor, in log-scale buckets so that recording a latency is constant
+ * time and the histogram never grows
+ */
+typedef struct latencyHistogram
+{
+    uint64_t counts[LATENCY_BUCKET_COUNT];
+    /**
+     * Number of latencies recorded
+     */
+    uint64_t total;
+    /**
+     * Largest latency recorded, in seconds
+     */
+    double maxSeconds;
+} LatencyHistogram;
+
+/**
+ * Latencies of every stage the monitor goes through on a sample
+ */
+typedef struct selfStats
+{
+    /**
+     * Time each collector spends taking a sample, as reported with its records
+     */
+    LatencyHistogram collect[COLLECTOR_COUNT];
+    /**
+     * Time from each collector sending a record to the render loop having read all of it
+     */
+    LatencyHistogram transfer[COLLECTOR_COUNT];
+    /**
+     * Time the render loop spends turning the records of a sample into text and printing the frame
+     */
+    LatencyHistogram render;
+} SelfStats;
+
+/**
+ * Add a latency to a histogram.
+ * @param histogram The histogram
+ * @param seconds The latency, in seconds
+ */
+extern void recordLatency(LatencyHistogram *histogram, double seconds);
+
+/**
+ * Estimate a percentile of the latencies in a histogram by the upper bound of the bucket it falls in.
+ * @param histogram The histogram
+ * @param fraction The percentile as a fraction, such as 0.99
+ * @returns The latency in seconds, no larger than the largest recorded, or 0 if the histogram is empty
+ */
+extern double latencyPercentile(const LatencyHistogram *histogram, double fraction);
+
+/**
+ * Print p50, p99 and max of every stage that recorded a latency, as the footer of a sample.
+ * @param out Stream the frame is written to
+ * @param stats The latencies of the monitor
+ */
+extern void printSelfStats(FILE *out, const SelfStats *stats);
+
+/**
+ * Print every stage that recorded a latency along with the count of each of its non-empty buckets, once the monitor stops.
+ * @param stats The latencies of the monitor
+ */
+extern void dumpSelfStats(const SelfStats *stats);
+
+#endif
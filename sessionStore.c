@@ -0,0 +1,188 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "heapCounter.h"
+#include "arena.h"
+#include "sessionStore.h"
+
+/**
+ * Number of bytes a line takes up in the arena, including its null terminator and the padding after it.
+ * @param lineLength Length of the line, excluding its null terminator
+ * @returns The size in bytes
+ */
+static size_t sessionLineSize(size_t lineLength)
+{
+    return (lineLength + 1 + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+}
+
+/**
+ * Drop the removed sessions and copy the lines of the remaining sessions into a fresh arena with room for them twice
+ * over, so the store is compacted again only after as many bytes have been added.
+ * @param store A store set up by initUserSessionStore()
+ * @param extraBytes Bytes to make room for on top of the remaining lines
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+static int compactUserSessionStore(UserSessionStore *store, size_t extraBytes)
+{
+    size_t capacity = (store->lineBytes + extraBytes) * 2;
+    if (capacity < SESSION_STORE_ARENA_SIZE)
+        capacity = SESSION_STORE_ARENA_SIZE;
+    if (reserveArena(&store->spareLines, capacity) != 0)
+    {
+        return 1;
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < store->count; i++)
+    {
+        if (store->sessions[i].line == NULL)
+            continue;
+        size_t length = strlen(store->sessions[i].line);
+        char *line = (char *)allocateArena(&store->spareLines, length + 1);
+        if (line == NULL)
+            return 1;
+        memcpy(line, store->sessions[i].line, length + 1);
+        store->sessions[kept].id = store->sessions[i].id;
+        store->sessions[kept].line = line;
+        kept++;
+    }
+    store->count = kept;
+    store->removed = 0;
+
+    Arena temp = store->lines;
+    store->lines = store->spareLines;
+    store->spareLines = temp;
+    return 0;
+}
+
+/**
+ * Allocate the storage of an empty session store.
+ * @param store The store to initialize
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+int initUserSessionStore(UserSessionStore *store)
+{
+    store->count = 0;
+    store->removed = 0;
+    store->lineBytes = 0;
+    store->capacity = SESSION_STORE_INITIAL_CAPACITY;
+    store->sessions = (UserSessionLine *)malloc(sizeof(UserSessionLine) * store->capacity);
+    if (store->sessions == NULL)
+    {
+        perror("malloc");
+        return 1;
+    }
+    if (initArena(&store->lines, SESSION_STORE_ARENA_SIZE) != 0)
+    {
+        free(store->sessions);
+        return 1;
+    }
+    if (initArena(&store->spareLines, SESSION_STORE_ARENA_SIZE) != 0)
+    {
+        freeArena(&store->lines);
+        free(store->sessions);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Add a session after every other session.
+ * @param store A store set up by initUserSessionStore()
+ * @param id Id of the session, greater than the id of any session added before
+ * @param lineLength Length of the line of the session, excluding its null terminator
+ * @returns Buffer of lineLength + 1 bytes for the line, or NULL if the store could not grow
+ */
+char *addUserSession(UserSessionStore *store, int id, size_t lineLength)
+{
+    // move to a larger arena rather than letting the arena take the line from the heap
+    size_t size = sessionLineSize(lineLength);
+    if (store->lines.capacity - store->lines.used < size && compactUserSessionStore(store, size) != 0)
+    {
+        return NULL;
+    }
+    if (store->count == store->capacity)
+    {
+        noteHeapAllocation();
+        UserSessionLine *larger = (UserSessionLine *)realloc(store->sessions, sizeof(UserSessionLine) * store->capacity * 2);
+        if (larger == NULL)
+        {
+            perror("realloc");
+            return NULL;
+        }
+        store->sessions = larger;
+        store->capacity *= 2;
+    }
+
+    char *line = (char *)allocateArena(&store->lines, lineLength + 1);
+    if (line == NULL)
+    {
+        return NULL;
+    }
+    line[0] = '\0';
+    store->sessions[store->count].id = id;
+    store->sessions[store->count].line = line;
+    store->count++;
+    store->lineBytes += size;
+    return line;
+}
+
+/**
+ * Remove a session. Nothing happens if no session has the given id.
+ * @param store A store set up by initUserSessionStore()
+ * @param id Id of the session
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+int removeUserSession(UserSessionStore *store, int id)
+{
+    // removed sessions keep their id until compaction, so the slots stay sorted
+    size_t low = 0, high = store->count;
+    while (low < high)
+    {
+        size_t middle = low + (high - low) / 2;
+        if (store->sessions[middle].id < id)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    if (low == store->count || store->sessions[low].id != id || store->sessions[low].line == NULL)
+    {
+        return 0;
+    }
+
+    store->lineBytes -= sessionLineSize(strlen(store->sessions[low].line));
+    store->sessions[low].line = NULL;
+    store->removed++;
+    if (store->removed * 2 > store->count)
+    {
+        return compactUserSessionStore(store, 0);
+    }
+    return 0;
+}
+
+/**
+ * Count the sessions that have not been removed.
+ * @param store A store set up by initUserSessionStore()
+ * @returns The number of sessions
+ */
+size_t countUserSessions(const UserSessionStore *store)
+{
+    return store->count - store->removed;
+}
+
+/**
+ * Release the storage of a session store.
+ * @param store A store set up by initUserSessionStore()
+ */
+void freeUserSessionStore(UserSessionStore *store)
+{
+    freeArena(&store->lines);
+    freeArena(&store->spareLines);
+    free(store->sessions);
+    store->sessions = NULL;
+    store->count = 0;
+    store->capacity = 0;
+    store->removed = 0;
+    store->lineBytes = 0;
+}
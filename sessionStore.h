@@ -0,0 +1,104 @@
+#ifndef SESSION_STORE_H
+#define SESSION_STORE_H
+
+#include <stddef.h>
+
+#include "arena.h"
+
+/**
+ * Initial number of sessions a UserSessionStore has room for
+ */
+#define SESSION_STORE_INITIAL_CAPACITY 64
+
+/**
+ * Initial size of the arena holding the lines of a UserSessionStore, in bytes
+ */
+#define SESSION_STORE_ARENA_SIZE 16384
+
+/**
+ * A session as kept by the parent, which only changes when the user child reports it added or removed
+ */
+typedef struct userSessionLine
+{
+    /**
+     * Id the user child assigned to the session when it was first seen
+     */
+    int id;
+    /**
+     * The line printed for the session, or NULL if the session was removed and its slot not yet reclaimed
+     */
+    char *line;
+} UserSessionLine;
+
+/**
+ * The sessions kept by the parent between samples, in the order they were added.
+ * The user child hands out ids in increasing order, so the sessions are sorted by id and a removed session is found
+ * by binary search. Removed sessions are left as holes that are reclaimed together, along with the space of their lines,
+ * once they make up half of the store.
+ */
+typedef struct userSessionStore
+{
+    /**
+     * Slots of the store, including removed sessions, sorted by id
+     */
+    UserSessionLine *sessions;
+    /**
+     * Number of slots in use, including removed sessions
+     */
+    size_t count;
+    /**
+     * Number of slots sessions has room for, which doubles when full
+     */
+    size_t capacity;
+    /**
+     * Number of slots holding a removed session
+     */
+    size_t removed;
+    /**
+     * Bytes of the lines of the sessions that have not been removed, used to size the arena when the store is compacted
+     */
+    size_t lineBytes;
+    /**
+     * Arena the lines are stored in, and the arena the lines are copied to when the store is compacted
+     */
+    Arena lines, spareLines;
+} UserSessionStore;
+
+/**
+ * Allocate the storage of an empty session store.
+ * @param store The store to initialize
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+extern int initUserSessionStore(UserSessionStore *store);
+
+/**
+ * Add a session after every other session.
+ * @param store A store set up by initUserSessionStore()
+ * @param id Id of the session, greater than the id of any session added before
+ * @param lineLength Length of the line of the session, excluding its null terminator
+ * @returns Buffer of lineLength + 1 bytes for the line, or NULL if the store could not grow
+ */
+extern char *addUserSession(UserSessionStore *store, int id, size_t lineLength);
+
+/**
+ * Remove a session. Nothing happens if no session has the given id.
+ * @param store A store set up by initUserSessionStore()
+ * @param id Id of the session
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+extern int removeUserSession(UserSessionStore *store, int id);
+
+/**
+ * Count the sessions that have not been removed.
+ * @param store A store set up by initUserSessionStore()
+ * @returns The number of sessions
+ */
+extern size_t countUserSessions(const UserSessionStore *store);
+
+/**
+ * Release the storage of a session store.
+ * @param store A store set up by initUserSessionStore()
+ */
+extern void freeUserSessionStore(UserSessionStore *store);
+
+#endif
@@ -0,0 +1,202 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <limits.h>
+#include <math.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <linux/memfd.h>
+
+#include "spscRing.h"
+#include "sampleTimer.h"
+
+/**
+ * Sleep until the value at the address is no longer the expected value, a wake up arrives or the timeout passes.
+ * The check and the sleep are a single step, so a change made just before sleeping is not missed.
+ * @param address The value to wait on
+ * @param expected The value seen before deciding to sleep
+ * @param timeout Longest time to sleep, or NULL to sleep until the value changes
+ */
+void waitOnAddress(_Atomic uint32_t *address, uint32_t expected, const struct timespec *timeout)
+{
+    // returns at once with EAGAIN if the value already changed, and may wake spuriously, so callers check again in a loop
+    syscall(SYS_futex, (uint32_t *)address, FUTEX_WAIT, expected, timeout, NULL, 0);
+}
+
+/**
+ * Wake every thread or process sleeping in waitOnAddress() on the address.
+ * @param address The value slept on
+ */
+void wakeAddress(_Atomic uint32_t *address)
+{
+    syscall(SYS_futex, (uint32_t *)address, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+/**
+ * Map memory backed by a memfd that stays shared with child processes forked afterwards.
+ * @param name Name of the memfd, shown in /proc/<pid>/maps
+ * @param size Size of the memory in bytes
+ * @returns The zero filled memory, or NULL if it could not be mapped
+ */
+void *mapSharedMemory(const char *name, size_t size)
+{
+    int fd = syscall(SYS_memfd_create, name, MFD_CLOEXEC);
+    if (fd == -1)
+    {
+        perror("memfd_create");
+        return NULL;
+    }
+    if (ftruncate(fd, size) == -1)
+    {
+        perror("ftruncate");
+        close(fd);
+        return NULL;
+    }
+    // the mapping keeps the memory alive, so the descriptor is not needed past this point
+    void *memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED)
+    {
+        perror("mmap");
+        return NULL;
+    }
+    return memory;
+}
+
+/**
+ * Unmap memory mapped by mapSharedMemory().
+ * @param memory The memory
+ * @param size Size of the memory in bytes
+ */
+void unmapSharedMemory(void *memory, size_t size)
+{
+    munmap(memory, size);
+}
+
+/**
+ * Map the counters and storage of an empty ring into shared memory.
+ * @param ring The ring to initialize
+ * @param capacity Size of the storage in bytes, a power of two
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+int initSpscRing(SpscRing *ring, uint32_t capacity)
+{
+    // the memfd starts zero filled, so every counter starts at 0
+    char *memory = (char *)mapSharedMemory("spscRing", sizeof(SpscRingControl) + capacity);
+    if (memory == NULL)
+    {
+        ring->control = NULL;
+        ring->data = NULL;
+        return 1;
+    }
+    ring->control = (SpscRingControl *)memory;
+    ring->capacity = capacity;
+    ring->data = memory + sizeof(SpscRingControl);
+    return 0;
+}
+
+/**
+ * Append bytes to the ring, sleeping whenever the ring is full until the consumer makes room. Only the producer may call this.
+ * @param ring A ring set up by initSpscRing()
+ * @param buffer The bytes to append
+ * @param size Number of bytes to append, which may be larger than the ring
+ */
+void writeSpscRing(SpscRing *ring, const void *buffer, size_t size)
+{
+    const char *bytes = (const char *)buffer;
+    uint32_t head = atomic_load_explicit(&ring->control->head, memory_order_relaxed);
+    while (size > 0)
+    {
+        uint32_t tail = atomic_load_explicit(&ring->control->tail, memory_order_acquire);
+        uint32_t space = ring->capacity - (head - tail);
+        if (space == 0)
+        {
+            // announce the sleep before checking tail again inside the futex, so the consumer either sees the flag or
+            // this side sees the new tail
+            atomic_store(&ring->control->producerWaiting, 1);
+            waitOnAddress(&ring->control->tail, tail, NULL);
+            continue;
+        }
+
+        size_t count = size < space ? size : space;
+        uint32_t offset = head & (ring->capacity - 1);
+        size_t first = count < ring->capacity - offset ? count : ring->capacity - offset;
+        memcpy(ring->data + offset, bytes, first);
+        memcpy(ring->data, bytes + first, count - first);
+        head += count;
+        bytes += count;
+        size -= count;
+
+        atomic_store(&ring->control->head, head);
+        if (atomic_exchange(&ring->control->consumerWaiting, 0))
+        {
+            wakeAddress(&ring->control->head);
+        }
+    }
+}
+
+/**
+ * Take bytes from the ring, sleeping whenever the ring is empty until the producer appends more or the deadline passes.
+ * Only the consumer may call this.
+ * @param ring A ring set up by initSpscRing()
+ * @param buffer Where to store the bytes
+ * @param size Number of bytes to take, which may be larger than the ring
+ * @param deadline Monotonic time in seconds to stop waiting for more bytes at, or INFINITY to wait for all of them
+ * @returns Number of bytes taken, which is less than size only if the deadline passed
+ */
+size_t readSpscRing(SpscRing *ring, void *buffer, size_t size, double deadline)
+{
+    char *bytes = (char *)buffer;
+    size_t taken = 0;
+    uint32_t tail = atomic_load_explicit(&ring->control->tail, memory_order_relaxed);
+    while (size > 0)
+    {
+        uint32_t head = atomic_load_explicit(&ring->control->head, memory_order_acquire);
+        uint32_t available = head - tail;
+        if (available == 0)
+        {
+            struct timespec timeout;
+            if (!isinf(deadline))
+            {
+                // bytes already in the ring are taken even past the deadline, which only limits the sleeping
+                double remaining = deadline - getMonotonicSeconds();
+                if (remaining <= 0)
+                    break;
+                timeout.tv_sec = (time_t)remaining;
+                timeout.tv_nsec = (long)((remaining - timeout.tv_sec) * 1e9);
+            }
+            atomic_store(&ring->control->consumerWaiting, 1);
+            waitOnAddress(&ring->control->head, head, isinf(deadline) ? NULL : &timeout);
+            continue;
+        }
+
+        size_t count = size < available ? size : available;
+        uint32_t offset = tail & (ring->capacity - 1);
+        size_t first = count < ring->capacity - offset ? count : ring->capacity - offset;
+        memcpy(bytes, ring->data + offset, first);
+        memcpy(bytes + first, ring->data, count - first);
+        tail += count;
+        bytes += count;
+        size -= count;
+        taken += count;
+
+        atomic_store(&ring->control->tail, tail);
+        if (atomic_exchange(&ring->control->producerWaiting, 0))
+        {
+            wakeAddress(&ring->control->tail);
+        }
+    }
+    return taken;
+}
+
+/**
+ * Unmap the counters and storage of a ring.
+ * @param ring A ring set up by initSpscRing()
+ */
+void freeSpscRing(SpscRing *ring)
+{
+    unmapSharedMemory(ring->control, sizeof(SpscRingControl) + ring->capacity);
+    ring->control = NULL;
+    ring->data = NULL;
+}
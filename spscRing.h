@@ -0,0 +1,128 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <time.h>
+
+/**
+ * Size of the ring buffers between the render loop and each collector in bytes, a power of two
+ */
+#define SPSC_RING_SIZE 65536
+
+/**
+ * Size the counters of a ring are aligned to, so that the producer and the consumer do not write to the same cache line
+ */
+#define SPSC_CACHE_LINE_SIZE 64
+
+/**
+ * Counters of a ring, which live in shared memory along with its storage so that a forked child process sees the same ring
+ */
+typedef struct spscRingControl
+{
+    /**
+     * Total number of bytes written by the producer, wrapping around at 2^32
+     */
+    _Alignas(SPSC_CACHE_LINE_SIZE) _Atomic uint32_t head;
+    /**
+     * Whether the producer is asleep waiting for tail to move
+     */
+    _Atomic uint32_t producerWaiting;
+    /**
+     * Total number of bytes read by the consumer, wrapping around at 2^32
+     */
+    _Alignas(SPSC_CACHE_LINE_SIZE) _Atomic uint32_t tail;
+    /**
+     * Whether the consumer is asleep waiting for head to move
+     */
+    _Atomic uint32_t consumerWaiting;
+} SpscRingControl;
+
+/**
+ * Lock-free byte stream with a single producer and a single consumer, which may be threads of one process or a parent
+ * and a child process forked after the ring was set up.
+ * The producer only advances head and the consumer only advances tail, so neither takes a lock. A side that finds
+ * the ring empty (consumer) or full (producer) sleeps on a futex until the other side moves its counter, and the other
+ * side only makes the wake up system call when it sees that a side is asleep.
+ */
+typedef struct spscRing
+{
+    /**
+     * Counters of the ring, at the start of the shared mapping
+     */
+    SpscRingControl *control;
+    /**
+     * Size of data in bytes, a power of two
+     */
+    uint32_t capacity;
+    /**
+     * Storage of the bytes in the ring, following the counters in the shared mapping
+     */
+    char *data;
+} SpscRing;
+
+/**
+ * Map memory backed by a memfd that stays shared with child processes forked afterwards.
+ * @param name Name of the memfd, shown in /proc/<pid>/maps
+ * @param size Size of the memory in bytes
+ * @returns The zero filled memory, or NULL if it could not be mapped
+ */
+extern void *mapSharedMemory(const char *name, size_t size);
+
+/**
+ * Unmap memory mapped by mapSharedMemory().
+ * @param memory The memory
+ * @param size Size of the memory in bytes
+ */
+extern void unmapSharedMemory(void *memory, size_t size);
+
+/**
+ * Map the counters and storage of an empty ring into shared memory.
+ * @param ring The ring to initialize
+ * @param capacity Size of the storage in bytes, a power of two
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+extern int initSpscRing(SpscRing *ring, uint32_t capacity);
+
+/**
+ * Append bytes to the ring, sleeping whenever the ring is full until the consumer makes room. Only the producer may call this.
+ * @param ring A ring set up by initSpscRing()
+ * @param buffer The bytes to append
+ * @param size Number of bytes to append, which may be larger than the ring
+ */
+extern void writeSpscRing(SpscRing *ring, const void *buffer, size_t size);
+
+/**
+ * Take bytes from the ring, sleeping whenever the ring is empty until the producer appends more or the deadline passes.
+ * Only the consumer may call this.
+ * @param ring A ring set up by initSpscRing()
+ * @param buffer Where to store the bytes
+ * @param size Number of bytes to take, which may be larger than the ring
+ * @param deadline Monotonic time in seconds to stop waiting for more bytes at, or INFINITY to wait for all of them
+ * @returns Number of bytes taken, which is less than size only if the deadline passed
+ */
+extern size_t readSpscRing(SpscRing *ring, void *buffer, size_t size, double deadline);
+
+/**
+ * Unmap the counters and storage of a ring.
+ * @param ring A ring set up by initSpscRing()
+ */
+extern void freeSpscRing(SpscRing *ring);
+
+/**
+ * Sleep until the value at the address is no longer the expected value, a wake up arrives or the timeout passes.
+ * The check and the sleep are a single step, so a change made just before sleeping is not missed.
+ * @param address The value to wait on
+ * @param expected The value seen before deciding to sleep
+ * @param timeout Longest time to sleep, or NULL to sleep until the value changes
+ */
+extern void waitOnAddress(_Atomic uint32_t *address, uint32_t expected, const struct timespec *timeout);
+
+/**
+ * Wake every thread or process sleeping in waitOnAddress() on the address.
+ * @param address The value slept on
+ */
+extern void wakeAddress(_Atomic uint32_t *address);
+
+#endif
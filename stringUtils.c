@@ -2,6 +2,8 @@
 #include <stdbool.h>
 #include <stdio.h>
 
+#include "stringUtils.h"
+
 /**
  * Check if a substring exists in a string. 
  * @param haystack string to search in
@@ -18,5 +20,14 @@ bool startsWith(const char *haystack, const char *needle)
 */
 void printDivider()
 {
-    printf("---------------------------------------\n");
+    fprintDivider(stdout);
+}
+
+/**
+ * Write a single row of divider text to separate sections to a stream.
+ * @param out The stream to write to
+*/
+void fprintDivider(FILE *out)
+{
+    fputs("---------------------------------------\n", out);
 }
\ No newline at end of file
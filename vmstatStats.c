@@ -0,0 +1,151 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+
+#include "procFile.h"
+#include "sampleTimer.h"
+#include "vmstatStats.h"
+
+/**
+ * Keys of /proc/vmstat read on every sample, in the order of the VMSTAT_* slots
+ */
+static const char *const vmstatKeys[VMSTAT_KEY_COUNT] = {
+    "pgfault", "pgmajfault", "pswpin", "pswpout",
+    "pgscan_kswapd", "pgscan_direct", "pgscan_khugepaged",
+    "pgsteal_kswapd", "pgsteal_direct", "pgsteal_khugepaged"};
+
+/**
+ * Labels of the paging rates, in the order of the PAGING_RATE_* slots
+ */
+static const char *const pagingRateLabels[PAGING_RATE_COUNT] = {
+    "faults", "major faults", "swap ins", "swap outs", "pages scanned", "pages stolen"};
+
+/**
+ * Open /proc/vmstat and build the lookup of the counters read from it.
+ * @param vmstat The Vmstat to initialize
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+int openVmstat(Vmstat *vmstat)
+{
+    if (openProcFile(&vmstat->file, "/proc/vmstat", VMSTAT_BUFFER_SIZE) != 0)
+    {
+        return 1;
+    }
+    initProcKeyTable(&vmstat->keys, vmstatKeys, VMSTAT_KEY_COUNT);
+    return 0;
+}
+
+/**
+ * Read the paging and swap counters of /proc/vmstat.
+ * @param vmstat A Vmstat opened with openVmstat()
+ * @param sample Where to store the counters
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+int readVmstat(Vmstat *vmstat, VmstatSample *sample)
+{
+    // the number of counters depends on the kernel, so the buffer grows on the first read until all of them fit
+    while (true)
+    {
+        if (readProcFile(&vmstat->file) != 0)
+        {
+            return 1;
+        }
+        if (!isProcFileTruncated(&vmstat->file))
+        {
+            break;
+        }
+        if (growProcFile(&vmstat->file) != 0)
+        {
+            return 1;
+        }
+    }
+    sample->seconds = getMonotonicSeconds();
+    parseKeyedValues(&vmstat->keys, vmstat->file.buffer, 0, sample->values, VMSTAT_KEY_COUNT);
+    return 0;
+}
+
+/**
+ * Calculate the per second rate of a counter between two reads.
+ * @param previous The earlier value of the counter
+ * @param current The later value of the counter
+ * @param seconds Seconds between the reads
+ * @returns The rate, or 0 if the counter went backwards
+ */
+static double calculateRate(unsigned long long previous, unsigned long long current, double seconds)
+{
+    return current >= previous ? (current - previous) / seconds : 0.0;
+}
+
+/**
+ * Calculate the per second paging and swap rates between two reads. Page scans and steals are summed over kswapd,
+ * direct reclaim and khugepaged.
+ * @param previous The earlier read
+ * @param current The later read
+ * @param rates Array of PAGING_RATE_COUNT rates to store the result in
+ */
+void calculatePagingRates(const VmstatSample *previous, const VmstatSample *current, double *rates)
+{
+    double seconds = current->seconds - previous->seconds;
+    if (seconds <= 0)
+    {
+        memset(rates, 0, sizeof(double) * PAGING_RATE_COUNT);
+        return;
+    }
+    const unsigned long long *before = previous->values, *after = current->values;
+    rates[PAGING_RATE_FAULTS] = calculateRate(before[VMSTAT_PGFAULT], after[VMSTAT_PGFAULT], seconds);
+    rates[PAGING_RATE_MAJOR_FAULTS] = calculateRate(before[VMSTAT_PGMAJFAULT], after[VMSTAT_PGMAJFAULT], seconds);
+    rates[PAGING_RATE_SWAP_INS] = calculateRate(before[VMSTAT_PSWPIN], after[VMSTAT_PSWPIN], seconds);
+    rates[PAGING_RATE_SWAP_OUTS] = calculateRate(before[VMSTAT_PSWPOUT], after[VMSTAT_PSWPOUT], seconds);
+    rates[PAGING_RATE_SCANNED] = calculateRate(before[VMSTAT_PGSCAN_KSWAPD] + before[VMSTAT_PGSCAN_DIRECT] + before[VMSTAT_PGSCAN_KHUGEPAGED],
+                                               after[VMSTAT_PGSCAN_KSWAPD] + after[VMSTAT_PGSCAN_DIRECT] + after[VMSTAT_PGSCAN_KHUGEPAGED], seconds);
+    rates[PAGING_RATE_STOLEN] = calculateRate(before[VMSTAT_PGSTEAL_KSWAPD] + before[VMSTAT_PGSTEAL_DIRECT] + before[VMSTAT_PGSTEAL_KHUGEPAGED],
+                                              after[VMSTAT_PGSTEAL_KSWAPD] + after[VMSTAT_PGSTEAL_DIRECT] + after[VMSTAT_PGSTEAL_KHUGEPAGED], seconds);
+}
+
+/**
+ * Write the paging and swap rates into the given buffer, on one line or, with graphics, one line per rate alongside
+ * a bar that grows with the order of magnitude of the rate.
+ * @param rates Array of PAGING_RATE_COUNT rates
+ * @param showGraphics Whether to draw a bar for each rate
+ * @param output Buffer to write the rates to
+ * @param outputLength Size of output in bytes, at least PAGING_RATE_COUNT * PAGING_OUTPUT_LENGTH
+ */
+void renderPagingRates(const double *rates, bool showGraphics, char *output, size_t outputLength)
+{
+    size_t written = 0;
+    if (!showGraphics)
+    {
+        written += snprintf(output, outputLength, "Paging (per sec):");
+        for (int i = 0; i < PAGING_RATE_COUNT && written < outputLength; i++)
+        {
+            written += snprintf(output + written, outputLength - written, "%s %s %.1f", i == 0 ? "" : ",", pagingRateLabels[i], rates[i]);
+        }
+        if (written < outputLength)
+            snprintf(output + written, outputLength - written, "\n");
+        return;
+    }
+
+    // rates span many orders of magnitude, so each bar grows with the logarithm of the rate
+    char bar[GRAPHICS_MAX_PAGING_BAR_COUNT + 1];
+    written += snprintf(output, outputLength, "Paging (per sec):\n");
+    for (int i = 0; i < PAGING_RATE_COUNT && written < outputLength; i++)
+    {
+        int bars = (int)(log10(rates[i] + 1) * GRAPHICS_PAGING_BARS_PER_DECADE);
+        if (bars > GRAPHICS_MAX_PAGING_BAR_COUNT)
+            bars = GRAPHICS_MAX_PAGING_BAR_COUNT;
+        memset(bar, '#', bars);
+        memset(bar + bars, ' ', GRAPHICS_MAX_PAGING_BAR_COUNT - bars);
+        bar[GRAPHICS_MAX_PAGING_BAR_COUNT] = '\0';
+        written += snprintf(output + written, outputLength - written, "\t%-14s [%s] %.1f\n", pagingRateLabels[i], bar, rates[i]);
+    }
+}
+
+/**
+ * Close /proc/vmstat.
+ * @param vmstat A Vmstat opened with openVmstat()
+ */
+void closeVmstat(Vmstat *vmstat)
+{
+    closeProcFile(&vmstat->file);
+}
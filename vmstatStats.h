@@ -0,0 +1,119 @@
+#ifndef VMSTAT_STATS_H
+#define VMSTAT_STATS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "procFile.h"
+
+/**
+ * Size of the buffer that /proc/vmstat is first read into, which grows if the file does not fit
+ */
+#define VMSTAT_BUFFER_SIZE 8192
+
+/**
+ * Slots of the counters read from /proc/vmstat, in pages or events since boot
+ */
+#define VMSTAT_PGFAULT 0
+#define VMSTAT_PGMAJFAULT 1
+#define VMSTAT_PSWPIN 2
+#define VMSTAT_PSWPOUT 3
+#define VMSTAT_PGSCAN_KSWAPD 4
+#define VMSTAT_PGSCAN_DIRECT 5
+#define VMSTAT_PGSCAN_KHUGEPAGED 6
+#define VMSTAT_PGSTEAL_KSWAPD 7
+#define VMSTAT_PGSTEAL_DIRECT 8
+#define VMSTAT_PGSTEAL_KHUGEPAGED 9
+#define VMSTAT_KEY_COUNT 10
+
+/**
+ * Slots of the per second rates calculated from consecutive reads of /proc/vmstat
+ */
+#define PAGING_RATE_FAULTS 0
+#define PAGING_RATE_MAJOR_FAULTS 1
+#define PAGING_RATE_SWAP_INS 2
+#define PAGING_RATE_SWAP_OUTS 3
+#define PAGING_RATE_SCANNED 4
+#define PAGING_RATE_STOLEN 5
+#define PAGING_RATE_COUNT 6
+
+/**
+ * Max number of bars in the graphical display of a paging rate
+ */
+#define GRAPHICS_MAX_PAGING_BAR_COUNT 21
+
+/**
+ * Number of bars added to the graphical display of a paging rate each time the rate grows tenfold
+ */
+#define GRAPHICS_PAGING_BARS_PER_DECADE 3
+
+/**
+ * Space reserved for each line of paging rate output, in bytes
+ */
+#define PAGING_OUTPUT_LENGTH 96
+
+/**
+ * The counters of /proc/vmstat at one point in time
+ */
+typedef struct vmstatSample
+{
+    /**
+     * Counters indexed by the VMSTAT_* slots
+     */
+    unsigned long long values[VMSTAT_KEY_COUNT];
+    /**
+     * Monotonic time the counters were read at, in seconds
+     */
+    double seconds;
+} VmstatSample;
+
+/**
+ * /proc/vmstat kept open between samples, with the lookup of the counters read from it
+ */
+typedef struct vmstat
+{
+    ProcFile file;
+    ProcKeyTable keys;
+} Vmstat;
+
+/**
+ * Open /proc/vmstat and build the lookup of the counters read from it.
+ * @param vmstat The Vmstat to initialize
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+extern int openVmstat(Vmstat *vmstat);
+
+/**
+ * Read the paging and swap counters of /proc/vmstat.
+ * @param vmstat A Vmstat opened with openVmstat()
+ * @param sample Where to store the counters
+ * @returns 0 if operation was successful, 1 otherwise
+ */
+extern int readVmstat(Vmstat *vmstat, VmstatSample *sample);
+
+/**
+ * Calculate the per second paging and swap rates between two reads. Page scans and steals are summed over kswapd,
+ * direct reclaim and khugepaged.
+ * @param previous The earlier read
+ * @param current The later read
+ * @param rates Array of PAGING_RATE_COUNT rates to store the result in
+ */
+extern void calculatePagingRates(const VmstatSample *previous, const VmstatSample *current, double *rates);
+
+/**
+ * Write the paging and swap rates into the given buffer, on one line or, with graphics, one line per rate alongside
+ * a bar that grows with the order of magnitude of the rate.
+ * @param rates Array of PAGING_RATE_COUNT rates
+ * @param showGraphics Whether to draw a bar for each rate
+ * @param output Buffer to write the rates to
+ * @param outputLength Size of output in bytes, at least PAGING_RATE_COUNT * PAGING_OUTPUT_LENGTH
+ */
+extern void renderPagingRates(const double *rates, bool showGraphics, char *output, size_t outputLength);
+
+/**
+ * Close /proc/vmstat.
+ * @param vmstat A Vmstat opened with openVmstat()
+ */
+extern void closeVmstat(Vmstat *vmstat);
+
+#endif